@@ -0,0 +1,8 @@
+// Camera uniforms shared by the vertex shaders, included with #include "Camera.glsl"
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+vec4 WorldToClip(vec3 worldPosition) {
+    return projectionMatrix * viewMatrix * vec4(worldPosition, 1.0);
+}
@@ -0,0 +1,21 @@
+// Model matrix of the vertex shaders, included with #include "Instancing.glsl" in place of a modelMatrix uniform.
+// Variants built with INSTANCED or MULTI_DRAW read it per instance from RenderQueue's instance buffer
+// (see Object::RenderBatch).
+
+#if defined(INSTANCED) || defined(MULTI_DRAW)
+layout(std430, binding = 0) readonly buffer InstanceData {
+    mat4 instanceModelMatrices[];
+};
+
+#ifdef MULTI_DRAW
+// Each indirect draw command points at the matrix of its first instance with its baseInstance
+#define modelMatrix instanceModelMatrices[gl_BaseInstance + gl_InstanceID]
+#else
+// Index of the batch's first matrix in the buffer
+uniform int instanceBase;
+
+#define modelMatrix instanceModelMatrices[instanceBase + gl_InstanceID]
+#endif
+#else
+uniform mat4 modelMatrix;
+#endif
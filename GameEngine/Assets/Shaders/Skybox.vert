@@ -3,13 +3,12 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "Camera.glsl"
 
 void main()
 {
     // Having z equal w will always result in a depth of 1.0f
-    gl_Position = projection * view * vec4(aPos, 1.0f);
+    gl_Position = WorldToClip(aPos);
     // We want to flip the z axis due to the different coordinate systems (left hand vs right hand)
     TexCoords = aPos;
 }
\ No newline at end of file
@@ -1,6 +1,6 @@
 #version 460 core
 
-uniform sampler2D Texture;  // Normal map texture
+uniform sampler2D Texture;  // Normal map texture, BC5 compressed (X and Y only)
 
 out vec4 FragColor;
 
@@ -8,8 +8,9 @@ in vec2 Uv;
 in vec3 Normal;  // Surface normal
 
 void main() {
-    // Fetch the normal from the normal map (ensure it's in the correct space)
-    vec3 normalMap = normalize(texture(Texture, Uv).xyz * 2.0 - 1.0); // Normalized in the range [-1, 1]
+    // Fetch the normal from the normal map; BC5 stores X and Y, so Z is rebuilt from the unit length
+    vec2 normalXY = texture(Texture, Uv).xy * 2.0 - 1.0; // In the range [-1, 1]
+    vec3 normalMap = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
 
     // Combine the original normal with the normal from the normal map
     vec3 combinedNormal = normalize(normalize(Normal) + normalMap); // Blend the normals
@@ -4,9 +4,9 @@ layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec2 aUv;
 layout(location = 2) in vec3 aNormals;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+#include "Instancing.glsl"
+
+#include "Camera.glsl"
 
 out vec2 Uv;
 out vec3 Normal;
@@ -14,5 +14,5 @@ out vec3 Normal;
 void main() {
     Uv = aUv;
     Normal = aNormals;
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(aPos, 1.0);
+    gl_Position = WorldToClip((modelMatrix * vec4(aPos, 1.0)).xyz);
 }
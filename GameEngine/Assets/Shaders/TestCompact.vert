@@ -0,0 +1,37 @@
+#version 460 core
+
+// Test.vert for the compact VertexFormat::PositionUvNormalQuantized/PositionUvNormalHalf encodings
+
+layout(location = 0) in vec4 aPos;
+layout(location = 1) in vec2 aUv;
+layout(location = 2) in vec4 aNormals;
+
+#include "Instancing.glsl"
+
+#include "Camera.glsl"
+
+// Mesh::positionScale/positionOffset
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+out vec2 Uv;
+out vec3 Normal;
+
+vec3 DecodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    Uv = aUv;
+    Normal = DecodeOctahedral(aNormals.xy);
+#ifdef MULTI_DRAW
+    vec3 position = aPos.xyz; // Dequantized by the model matrix, as draws of different meshes share the uniforms
+#else
+    vec3 position = aPos.xyz * positionScale + positionOffset;
+#endif
+    gl_Position = WorldToClip((modelMatrix * vec4(position, 1.0)).xyz);
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "Assets/AssetRegistry.h"
+#include "Assets/TextureStreamer.h"
+#include "Assets/BlockCompressor.h"
+#include "Assets/ShaderVariants.h"
+#include "Assets/AssetService.h"
\ No newline at end of file
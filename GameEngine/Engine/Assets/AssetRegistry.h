@@ -0,0 +1,223 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include "../FileSystem/File.h"
+
+/// <summary>
+/// Kinds of assets tracked by AssetRegistry.
+/// </summary>
+enum class AssetType {
+    Texture,
+    ShaderSource,
+    ShaderProgram,
+    Mesh,     // CPU side mesh data
+    Geometry, // Uploaded GeometryContainer
+    Count
+};
+
+/// <summary>
+/// Live assets of one type and the memory they hold.
+/// </summary>
+struct AssetMemoryStats {
+    size_t count = 0;
+    size_t bytes = 0;
+};
+
+/// <summary>
+/// Requests answered by an asset that was already loaded or loading.
+/// </summary>
+struct AssetRegistryStats {
+    size_t requests = 0;
+    size_t pathHits = 0;    // Same canonical path and parameters
+    size_t contentHits = 0; // Different path, identical file content
+};
+
+/// <summary>
+/// Central table of loaded assets. Entries are keyed by canonical path and by content hash, always
+/// together with the asset type and load parameters, and are held weakly: an asset lives exactly as
+/// long as something references it. Resources created through Track are counted per type and destroyed
+/// on the render thread (see CollectGarbage) once their last reference drops.
+/// </summary>
+class AssetRegistry {
+public:
+    static const char* GetTypeName(AssetType type) {
+        switch (type) {
+            case AssetType::Texture: return "Texture";
+            case AssetType::ShaderSource: return "ShaderSource";
+            case AssetType::ShaderProgram: return "ShaderProgram";
+            case AssetType::Mesh: return "Mesh";
+            case AssetType::Geometry: return "Geometry";
+            default: return "Unknown";
+        }
+    }
+
+    /// Key of a request for the file at path, loaded with the given parameters.
+    static std::string PathKey(AssetType type, const std::string& path, uint64_t parameters) {
+        return "path:" + std::to_string(static_cast<int>(type)) + ":" + std::to_string(parameters) + ":" + File::canonicalPath(path);
+    }
+
+    /// Key of an asset with the given content hash, loaded with the given parameters.
+    static std::string ContentKey(AssetType type, uint64_t contentHash, uint64_t parameters) {
+        return "content:" + std::to_string(static_cast<int>(type)) + ":" + std::to_string(parameters) + ":" + std::to_string(contentHash);
+    }
+
+    /// <summary>
+    /// Returns the live entry under a path key, or registers a new one made by create.
+    /// </summary>
+    /// <param name="created">Set to true when the returned entry is new.</param>
+    template <typename Entry>
+    static std::shared_ptr<Entry> Acquire(const std::string& key, const std::function<std::shared_ptr<Entry>()>& create, bool& created) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.requests;
+        std::weak_ptr<void>& slot = entries[key];
+        if (auto existing = slot.lock()) {
+            ++stats.pathHits;
+            created = false;
+            return std::static_pointer_cast<Entry>(existing);
+        }
+
+        auto entry = create();
+        slot = entry;
+        created = true;
+        return entry;
+    }
+
+    /// <summary>
+    /// Registers an entry under a content key unless a live entry already holds that content.
+    /// </summary>
+    /// <returns>The live entry holding the content, which is entry itself if it was registered.</returns>
+    template <typename Entry>
+    static std::shared_ptr<Entry> Claim(const std::string& key, const std::shared_ptr<Entry>& entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::weak_ptr<void>& slot = entries[key];
+        if (auto existing = slot.lock()) {
+            if (existing != entry) ++stats.contentHits;
+            return std::static_pointer_cast<Entry>(existing);
+        }
+
+        slot = entry;
+        return entry;
+    }
+
+    /// <summary>
+    /// Removes a key if it still refers to entry, e.g. a content key whose asset was reloaded with new content.
+    /// </summary>
+    static void Forget(const std::string& key, const void* entry) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(key);
+        if (found != entries.end() && found->second.lock().get() == entry) entries.erase(found);
+    }
+
+    /// <summary>
+    /// Takes ownership of a loaded resource. Its memory is counted under type until the last reference
+    /// drops; the resource is then destroyed by the next CollectGarbage call, on the render thread,
+    /// whichever thread released it.
+    /// </summary>
+    template <typename T>
+    static std::shared_ptr<T> Track(std::unique_ptr<T> resource, AssetType type, size_t bytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            memory[static_cast<size_t>(type)].count++;
+            memory[static_cast<size_t>(type)].bytes += bytes;
+            sizes[resource.get()] = bytes;
+        }
+        return std::shared_ptr<T>(resource.release(), [type](T* released) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto size = sizes.find(released);
+            memory[static_cast<size_t>(type)].count--;
+            memory[static_cast<size_t>(type)].bytes -= size->second;
+            sizes.erase(size);
+            releases.push_back([released]() { delete released; });
+        });
+    }
+
+    /// <summary>
+    /// Updates the memory counted for a tracked resource whose size changed, e.g. a streamed texture.
+    /// </summary>
+    static void UpdateSize(const void* resource, AssetType type, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto size = sizes.find(resource);
+        if (size == sizes.end()) return;
+        memory[static_cast<size_t>(type)].bytes += bytes;
+        memory[static_cast<size_t>(type)].bytes -= size->second;
+        size->second = bytes;
+    }
+
+    /// <summary>
+    /// Exchanges the memory counted for two tracked resources of one type whose contents were swapped.
+    /// </summary>
+    static void SwapSizes(const void* first, const void* second) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto a = sizes.find(first);
+        auto b = sizes.find(second);
+        if (a != sizes.end() && b != sizes.end()) std::swap(a->second, b->second);
+    }
+
+    /// <summary>
+    /// Destroys released resources and forgets expired entries. Must run on the render thread.
+    /// </summary>
+    /// <returns>The number of resources destroyed.</returns>
+    static size_t CollectGarbage() {
+        std::vector<std::function<void()>> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.swap(releases);
+            if (!pending.empty()) {
+                for (auto it = entries.begin(); it != entries.end();) {
+                    it = it->second.expired() ? entries.erase(it) : std::next(it);
+                }
+            }
+        }
+        for (auto& release : pending) release();
+        return pending.size();
+    }
+
+    static AssetMemoryStats GetMemoryStats(AssetType type) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return memory[static_cast<size_t>(type)];
+    }
+
+    static AssetRegistryStats GetStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    /// Prints the live assets and memory of every type.
+    static void PrintMemoryReport(std::ostream& out = std::cout) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << "Asset memory:" << std::endl;
+        for (size_t i = 0; i < static_cast<size_t>(AssetType::Count); ++i) {
+            out << "  " << std::left << std::setw(14) << GetTypeName(static_cast<AssetType>(i))
+                << std::right << std::setw(6) << memory[i].count << " assets "
+                << std::fixed << std::setprecision(2) << std::setw(10) << memory[i].bytes / (1024.0 * 1024.0) << " MB" << std::endl;
+        }
+        out << "  " << stats.requests << " requests, " << stats.pathHits << " path hits, "
+            << stats.contentHits << " content hits" << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<void>> entries;
+    static AssetMemoryStats memory[static_cast<size_t>(AssetType::Count)];
+    static AssetRegistryStats stats;
+    static std::vector<std::function<void()>> releases;
+    static std::unordered_map<const void*, size_t> sizes; // Counted bytes of every tracked resource
+};
+
+std::mutex AssetRegistry::mutex;
+std::unordered_map<std::string, std::weak_ptr<void>> AssetRegistry::entries;
+AssetMemoryStats AssetRegistry::memory[static_cast<size_t>(AssetType::Count)];
+AssetRegistryStats AssetRegistry::stats;
+std::vector<std::function<void()>> AssetRegistry::releases;
+std::unordered_map<const void*, size_t> AssetRegistry::sizes;
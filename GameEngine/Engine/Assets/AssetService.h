@@ -0,0 +1,795 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <filesystem>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include "../Core.h"
+#include "../FileSystem.h"
+#include "../Objects/Mesh.h"
+#include "../Objects/GeometryContainer.h"
+#include "AssetRegistry.h"
+#include "TextureStreamer.h"
+#include "BlockCompressor.h"
+
+/// <summary>
+/// Loading state of an asset handle.
+/// </summary>
+enum class AssetStatus {
+    Loading,
+    Ready,
+    Failed
+};
+
+/// <summary>
+/// Shared reference to an asset loaded by AssetService. Copies refer to the same asset.
+/// The asset becomes available on the render thread once its GL upload has run;
+/// until then Get() returns nullptr.
+/// </summary>
+template <typename T>
+class AssetHandle {
+public:
+    AssetHandle() = default;
+
+    bool IsValid() const { return state != nullptr; }
+
+    AssetStatus GetStatus() const { return state ? state->status.load(std::memory_order_acquire) : AssetStatus::Failed; }
+
+    bool IsReady() const { return GetStatus() == AssetStatus::Ready; }
+
+    bool IsFailed() const { return GetStatus() == AssetStatus::Failed; }
+
+    /// The asset, or nullptr while it is loading or if it failed.
+    T* Get() const { return IsReady() ? state->value.get() : nullptr; }
+
+    /// Shared ownership of the asset, e.g. to keep a GeometryContainer alive in an Object; empty until ready.
+    std::shared_ptr<T> Share() const { return IsReady() ? state->value : nullptr; }
+
+    const std::string& GetPath() const { return state->path; }
+
+    /// Resolves with the asset once it is ready, or with nullptr if loading failed.
+    /// Do not block on it from the render thread, which runs the uploads; use AssetService::Wait instead.
+    std::shared_future<std::shared_ptr<T>> GetFuture() const { return state->future; }
+
+    /// <summary>
+    /// Runs the callback on the render thread once the asset is ready, or right away if it already is.
+    /// Callbacks of failed assets never run. Must be called from the render thread.
+    /// </summary>
+    void OnReady(std::function<void(T&)> callback) const {
+        if (!state || IsFailed()) return;
+        if (IsReady()) {
+            callback(*state->value);
+        } else {
+            state->callbacks.push_back(std::move(callback));
+        }
+    }
+
+private:
+    friend class AssetService;
+
+    struct State {
+        std::string path;
+        std::atomic<AssetStatus> status{AssetStatus::Loading};
+        std::shared_ptr<T> value;
+        std::promise<std::shared_ptr<T>> promise;
+        std::shared_future<std::shared_ptr<T>> future = promise.get_future().share();
+        std::vector<std::function<void(T&)>> callbacks; // Render thread only
+        std::vector<std::shared_ptr<State>> dependents; // Requests sharing this content; render thread only
+        std::string contentKey;                         // Content key this asset was registered under, if any
+
+        // Hot reloads (see AssetService::hotReload); render thread only
+        std::shared_ptr<State> reloadTarget;            // Set on a reload: the asset whose contents it replaces
+        uint64_t reloadSerial = 0;                      // Number of the latest reload of an asset, or of this reload
+        std::chrono::steady_clock::time_point reloadStart;
+    };
+
+    explicit AssetHandle(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+    std::shared_ptr<State> state;
+};
+
+/// <summary>
+/// GL uploads run by the last AssetService::ProcessUploads call.
+/// </summary>
+struct AssetUploadStats {
+    size_t uploads = 0;
+    size_t pending = 0;
+    double milliseconds = 0.0;
+};
+
+/// <summary>
+/// Hot reloads since startup.
+/// </summary>
+struct AssetReloadStats {
+    size_t reloads = 0;
+    size_t failures = 0;          // Reloads that failed and left the previous version in use
+    double lastMilliseconds = 0.0; // From the change being seen to the new version being swapped in
+};
+
+/// <summary>
+/// Loads assets on a pool of worker threads. Asset files are read in batches by the AsyncFileReader, in the
+/// order of the IoPriority of their requests, and each file's bytes are handed to a worker as they arrive.
+/// CPU work (image decode, mesh import) runs on the workers; only the final GL step is queued for the render thread,
+/// which drains the queue within uploadBudgetMs per frame (see Renderer::Render).
+/// Independent assets therefore load in parallel and streaming content in mid-game does not stall a frame
+/// for longer than one upload.
+/// Requests go through AssetRegistry: a path that is already loaded or loading returns the existing asset,
+/// and a file whose content matches a live asset shares it instead of being decoded and uploaded again.
+/// With hotReload set, assets whose files change on disk are loaded again the same way and the new version
+/// is swapped into the existing object between frames, so pointers and handles to it stay valid. If the new
+/// version fails to load, compile or link, the previous one stays in use.
+/// </summary>
+class AssetService {
+public:
+    /// Time the render thread may spend on queued uploads per frame. At least one upload runs per frame.
+    static double uploadBudgetMs;
+
+    /// Worker threads started on first use; 0 uses all hardware threads but one (at least one worker).
+    static unsigned workerCount;
+
+    static AssetUploadStats lastUploadStats;
+
+    /// When true, the loose files of assets requested from now on are watched (see FileWatcher) and the assets
+    /// reloaded when they change. Meant for development; set it before loading.
+    static bool hotReload;
+
+    static AssetReloadStats reloadStats;
+
+    /// <summary>
+    /// Decodes an image and builds its mips on a worker (or reads them from the TextureCache), then uploads
+    /// them as a Texture on the render thread.
+    /// </summary>
+    static AssetHandle<Texture> LoadTextureAsync(const std::string& path, GLenum activeTexture = GL_TEXTURE0,
+                                                 GLint filterType = GL_LINEAR, GLint repetitionType = GL_REPEAT,
+                                                 bool useBindless = false, const MipSettings& mips = MipSettings(),
+                                                 IoPriority priority = IoPriority::Normal) {
+        uint64_t parameters = Hash::Combine(Hash::Combine(activeTexture, filterType), Hash::Combine(repetitionType, useBindless));
+        parameters = Hash::Combine(parameters, mips.Key());
+        return Request<Texture>(AssetType::Texture, path, parameters, priority,
+                                [=](const StatePtr<Texture>& state, const FileView& source) -> std::function<void()> {
+            File* file = File::find(state->path);
+            if (!file || !source.isOpen()) return FailLater<Texture>(state);
+
+            uint64_t contentHash = Hash::Bytes(source.data(), source.size());
+            if (auto shared = ShareContent<Texture>(state, AssetType::Texture, contentHash, parameters)) return shared;
+
+            std::shared_ptr<TextureMipChain> chain = BuildTextureChain(state->path, source, contentHash, TextureCompression::None, mips);
+            if (!chain) return FailLater<Texture>(state);
+
+            return [state, file, chain, activeTexture, filterType, repetitionType, useBindless]() {
+                auto texture = std::make_unique<Texture>(*file, *chain, activeTexture, filterType, repetitionType, useBindless);
+                if (texture->textureID == 0) {
+                    Fail<Texture>(state);
+                    return;
+                }
+                size_t bytes = 0;
+                for (size_t level = 0; level < chain->levels.size(); ++level) bytes += chain->LevelBytes(level);
+                Resolve<Texture>(state, AssetRegistry::Track(std::move(texture), AssetType::Texture, bytes));
+            };
+        });
+    }
+
+    /// <summary>
+    /// Returns a Texture right away, holding a 1x1 placeholder of the given color. The image is decoded and
+    /// its mip chain built on a worker (see MipGenerator), or read from the TextureCache once built, then
+    /// TextureStreamer uploads the mips smallest first under its per-frame byte budget. Must be called on the render thread. Streamed textures are shared by path
+    /// only, since their GL object exists before the content is known.
+    /// </summary>
+    static AssetHandle<Texture> LoadTextureStreamed(const std::string& path, GLenum activeTexture = GL_TEXTURE0,
+                                                    GLint filterType = GL_LINEAR, GLint repetitionType = GL_REPEAT,
+                                                    bool useBindless = false, const unsigned char* placeholder = nullptr,
+                                                    const MipSettings& mips = MipSettings(), IoPriority priority = IoPriority::Normal) {
+        return LoadTextureCompressed(path, TextureCompression::None, activeTexture, filterType, repetitionType, useBindless, placeholder, mips, priority);
+    }
+
+    /// <summary>
+    /// Streams a block compressed texture like LoadTextureStreamed (TextureCompression::None streams 8-bit
+    /// pixels). The first load encodes the image and its mips on a worker and caches them as KTX2 next to the
+    /// source (see TextureCache); later loads read the cache and upload with glCompressedTexImage2D. Use TextureCompression::BC5 for normal maps, whose
+    /// Z component the shader rebuilds from X and Y.
+    /// </summary>
+    static AssetHandle<Texture> LoadTextureCompressed(const std::string& path, TextureCompression compression, GLenum activeTexture = GL_TEXTURE0,
+                                                      GLint filterType = GL_LINEAR, GLint repetitionType = GL_REPEAT,
+                                                      bool useBindless = false, const unsigned char* placeholder = nullptr,
+                                                      const MipSettings& mips = MipSettings(), IoPriority priority = IoPriority::Normal) {
+        File* file = File::find(path);
+        if (!file) return AssetHandle<Texture>();
+
+        uint64_t parameters = Hash::Combine(Hash::Combine(activeTexture, filterType), Hash::Combine(repetitionType, useBindless | 2));
+        parameters = Hash::Combine(parameters, Hash::Combine(static_cast<uint64_t>(compression), mips.Key()));
+        AssetHandle<Texture> handle = Request<Texture>(AssetType::Texture, path, parameters, priority,
+                                                       [compression, mips](const StatePtr<Texture>& state, const FileView& source) -> std::function<void()> {
+            // A failed load keeps the placeholder; a failed reload keeps the previous version
+            if (!source.isOpen()) return state->reloadTarget ? FailLater<Texture>(state) : []() {};
+            uint64_t contentHash = Hash::Bytes(source.data(), source.size());
+            std::shared_ptr<TextureMipChain> chain = BuildTextureChain(state->path, source, contentHash, compression, mips);
+            if (!chain) return state->reloadTarget ? FailLater<Texture>(state) : []() {};
+            return [state, chain]() {
+                // A reload streams into the live texture, so a superseded one must not replace a later chain
+                if (state->reloadTarget && state->reloadSerial != state->reloadTarget->reloadSerial) return;
+                TextureStreamer::Stream(state->value, chain);
+                if (state->reloadTarget) FinishReload<Texture>(state, state->value);
+            };
+        });
+
+        // A new request resolves immediately; its job only runs on the render thread after this
+        if (handle.GetStatus() == AssetStatus::Loading) {
+            static const unsigned char grey[4] = { 128, 128, 128, 255 };
+            auto texture = std::make_unique<Texture>(*file, placeholder ? placeholder : grey, activeTexture, filterType, repetitionType, useBindless);
+            Resolve<Texture>(handle.state, AssetRegistry::Track(std::move(texture), AssetType::Texture, 4));
+        }
+        return handle;
+    }
+
+    /// <summary>
+    /// Reads a shader source file on a worker.
+    /// </summary>
+    static AssetHandle<std::string> LoadShaderSourceAsync(const std::string& path, IoPriority priority = IoPriority::Normal) {
+        return Request<std::string>(AssetType::ShaderSource, path, 0, priority,
+                                    [](const StatePtr<std::string>& state, const FileView& contents) -> std::function<void()> {
+            if (contents.size() == 0) return FailLater<std::string>(state);
+            auto source = std::make_unique<std::string>(contents.text());
+            if (auto shared = ShareContent<std::string>(state, AssetType::ShaderSource, Hash::String(*source), 0)) return shared;
+
+            size_t bytes = source->size();
+            auto tracked = AssetRegistry::Track(std::move(source), AssetType::ShaderSource, bytes);
+            return [state, tracked]() { Resolve<std::string>(state, tracked); };
+        });
+    }
+
+    /// <summary>
+    /// Reads both shader sources and resolves their #includes (see ShaderPreprocessor), then compiles and links
+    /// the program on the render thread. The vertex shader is read by the AsyncFileReader and the fragment
+    /// shader on the worker. Both compiles and the link are issued before any result is checked, so a driver
+    /// that compiles in the background can work on them together. Linked programs are cached as driver
+    /// binaries (see ProgramCache): the worker reads the cached binary too, and the render thread loads it
+    /// instead of compiling when it was built from the same sources by the same driver.
+    /// Use ShaderVariants for programs built with different sets of #defines.
+    /// </summary>
+    static AssetHandle<ShaderProgram> LoadProgramAsync(const std::string& vertexPath, const std::string& fragmentPath,
+                                                       IoPriority priority = IoPriority::Normal) {
+        uint64_t parameters = Hash::String(File::canonicalPath(fragmentPath));
+        std::vector<std::string> dependencies = { fragmentPath };
+        if (hotReload) {
+            // Editing an included file reloads the program too
+            for (const std::string& path : { vertexPath, fragmentPath }) {
+                std::vector<std::string> includes = ShaderPreprocessor::ListIncludes(path);
+                dependencies.insert(dependencies.end(), includes.begin(), includes.end());
+            }
+        }
+        return Request<ShaderProgram>(AssetType::ShaderProgram, vertexPath, parameters, priority,
+                                      [vertexPath, fragmentPath](const StatePtr<ShaderProgram>& state, const FileView& vertexContents) -> std::function<void()> {
+            auto vertexSource = std::make_shared<std::string>();
+            auto fragmentSource = std::make_shared<std::string>();
+            std::string fragmentText;
+            if (vertexContents.size() == 0 || !ReadSource(fragmentPath, fragmentText) ||
+                !ShaderPreprocessor::Process(vertexPath, vertexContents.text(), {}, *vertexSource) ||
+                !ShaderPreprocessor::Process(fragmentPath, fragmentText, {}, *fragmentSource)) {
+                return FailLater<ShaderProgram>(state);
+            }
+            uint64_t contentHash = Hash::String(*fragmentSource, Hash::String(*vertexSource));
+            if (auto shared = ShareContent<ShaderProgram>(state, AssetType::ShaderProgram, contentHash, 0)) return shared;
+
+            std::string cachePath = ProgramCache::GetCachePath(vertexPath, fragmentPath);
+            auto binary = std::make_shared<ProgramCache::Binary>();
+            ProgramCache::Read(cachePath, *binary);
+
+            return [state, vertexSource, fragmentSource, cachePath, binary]() {
+                auto program = std::make_unique<ShaderProgram>();
+                uint64_t key = ProgramCache::Key({ *vertexSource, *fragmentSource });
+                if (!ProgramCache::Load(*binary, key, *program)) {
+                    auto start = std::chrono::steady_clock::now();
+                    try {
+                        program = std::make_unique<ShaderProgram>(); // A rejected binary leaves the program unusable
+                        Shader vertexShader(GL_VERTEX_SHADER);
+                        Shader fragmentShader(GL_FRAGMENT_SHADER);
+                        vertexShader.StartCompile(*vertexSource);
+                        fragmentShader.StartCompile(*fragmentSource);
+                        program->AttachShader(vertexShader);
+                        program->AttachShader(fragmentShader);
+                        ProgramCache::PrepareForCaching(*program);
+                        program->StartLink();
+                        vertexShader.CheckCompile();
+                        fragmentShader.CheckCompile();
+                        program->CheckLink();
+                    } catch (const std::exception& e) {
+                        std::cerr << "ERROR: " << e.what() << std::endl;
+                        Fail<ShaderProgram>(state);
+                        return;
+                    }
+                    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    ProgramCache::Write(cachePath, key, *program, milliseconds);
+                }
+                GLint binaryLength = 0;
+                glGetProgramiv(program->ID, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+                Resolve<ShaderProgram>(state, AssetRegistry::Track(std::move(program), AssetType::ShaderProgram,
+                                                                   static_cast<size_t>(std::max(binaryLength, 0))));
+            };
+        }, dependencies);
+    }
+
+    /// <summary>
+    /// Imports a mesh on a worker with the current MeshLoader settings (LODs, optimization, meshlets, cache)
+    /// and keeps it on the CPU. Use LoadGeometryAsync to share the uploaded buffers between objects.
+    /// </summary>
+    static AssetHandle<Mesh> LoadMeshAsync(const std::string& path, MeshFormat format, const VertexFormat& vertexFormat,
+                                           IoPriority priority = IoPriority::Normal) {
+        uint64_t parameters = MeshParameters(format, vertexFormat);
+        return Request<Mesh>(AssetType::Mesh, path, parameters, priority, [=](const StatePtr<Mesh>& state, const FileView& source) -> std::function<void()> {
+            std::function<void()> next;
+            auto mesh = ImportMesh<Mesh>(state, source, AssetType::Mesh, format, vertexFormat, parameters, next);
+            if (!mesh) return next;
+
+            size_t bytes = static_cast<size_t>(mesh->vertexDataSize + mesh->indexDataSize);
+            auto tracked = AssetRegistry::Track(std::move(mesh), AssetType::Mesh, bytes);
+            return [state, tracked]() { Resolve<Mesh>(state, tracked); };
+        });
+    }
+
+    /// <summary>
+    /// Imports a mesh on a worker and uploads it into a GeometryContainer on the render thread. The CPU copy
+    /// is dropped after the upload. Objects share the container with Object::SetGeometry(handle.Share()).
+    /// </summary>
+    static AssetHandle<GeometryContainer> LoadGeometryAsync(const std::string& path, MeshFormat format, const VertexFormat& vertexFormat,
+                                                            IoPriority priority = IoPriority::Normal) {
+        uint64_t parameters = MeshParameters(format, vertexFormat);
+        return Request<GeometryContainer>(AssetType::Geometry, path, parameters, priority,
+                                          [=](const StatePtr<GeometryContainer>& state, const FileView& source) -> std::function<void()> {
+            std::function<void()> next;
+            std::shared_ptr<Mesh> mesh = ImportMesh<GeometryContainer>(state, source, AssetType::Geometry, format, vertexFormat, parameters, next);
+            if (!mesh) return next;
+
+            return [state, mesh]() {
+                auto geometry = std::make_unique<GeometryContainer>();
+                geometry->SetVertexData(*mesh);
+                size_t bytes = static_cast<size_t>(geometry->vertexBuffer.bufferSize + geometry->indexBuffer.bufferSize);
+                Resolve<GeometryContainer>(state, AssetRegistry::Track(std::move(geometry), AssetType::Geometry, bytes));
+            };
+        });
+    }
+
+    /// <summary>
+    /// Runs queued GL uploads until the budget is spent. Called once per frame from the render thread.
+    /// </summary>
+    /// <returns>The number of uploads run.</returns>
+    static size_t ProcessUploads(double budgetMs) {
+        auto start = std::chrono::steady_clock::now();
+        AssetRegistry::CollectGarbage();
+        if (hotReload) StartReloads();
+
+        AssetUploadStats stats;
+        while (true) {
+            std::function<void()> upload;
+            {
+                std::lock_guard<std::mutex> lock(uploadMutex);
+                if (uploads.empty()) break;
+                upload = std::move(uploads.front());
+                uploads.pop_front();
+            }
+            upload();
+            ++stats.uploads;
+
+            stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (stats.milliseconds >= budgetMs) break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            stats.pending = uploads.size();
+        }
+        lastUploadStats = stats;
+        return stats.uploads;
+    }
+
+    /// <summary>
+    /// Blocks the render thread until the asset is ready or failed, running uploads meanwhile.
+    /// </summary>
+    /// <returns>The asset, or nullptr if it failed.</returns>
+    template <typename T>
+    static T* Wait(const AssetHandle<T>& handle) {
+        if (!handle.IsValid()) return nullptr;
+        while (handle.GetStatus() == AssetStatus::Loading) {
+            {
+                std::unique_lock<std::mutex> lock(uploadMutex);
+                uploadReady.wait_for(lock, std::chrono::milliseconds(10), []() { return !uploads.empty(); });
+            }
+            ProcessUploads(std::numeric_limits<double>::infinity());
+        }
+        return handle.Get();
+    }
+
+    /// <summary>
+    /// Stops the workers and drops pending work. Call on the render thread before the GL context is destroyed.
+    /// Handles still loading stay in AssetStatus::Loading.
+    /// </summary>
+    static void Shutdown() {
+        // Reads in flight complete into the pool first, which then drops them
+        AsyncFileReader::Shutdown();
+        pool.Stop();
+        {
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            uploads.clear();
+        }
+        TextureStreamer::Shutdown();
+        AssetRegistry::CollectGarbage();
+    }
+
+private:
+    template <typename T>
+    using StatePtr = std::shared_ptr<typename AssetHandle<T>::State>;
+
+    // A worker job receives the asset file's bytes (not open if it could not be read) and returns the render thread half of the load
+    template <typename T>
+    using Job = std::function<std::function<void()>(const StatePtr<T>&, const FileView&)>;
+
+    struct WorkerPool {
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable jobReady;
+        bool stopping = false;
+
+        void Push(std::function<void()> job) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (threads.empty()) {
+                    stopping = false;
+                    unsigned hardware = std::thread::hardware_concurrency();
+                    unsigned count = workerCount ? workerCount : (hardware > 1 ? hardware - 1 : 1);
+                    for (unsigned i = 0; i < count; ++i) threads.emplace_back([this]() { Run(); });
+                }
+                jobs.push_back(std::move(job));
+            }
+            jobReady.notify_one();
+        }
+
+        void Run() {
+            while (true) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                    if (stopping) return;
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+                job();
+            }
+        }
+
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                jobs.clear();
+            }
+            jobReady.notify_all();
+            for (auto& thread : threads) thread.join();
+            threads.clear();
+        }
+
+        ~WorkerPool() { Stop(); }
+    };
+
+    static WorkerPool pool;
+    static std::deque<std::function<void()>> uploads;
+    static std::mutex uploadMutex;
+    static std::condition_variable uploadReady;
+
+    // Reloads of the assets built from each watched file, by canonical path. A reload returns false once its asset is gone.
+    static std::unordered_map<std::string, std::vector<std::function<bool(std::chrono::steady_clock::time_point)>>> reloaders;
+    static std::mutex reloadMutex;
+
+    // Returns the asset already registered for the path, or registers a new one and starts its job. Dependencies
+    // are further files the job reads, which trigger hot reloads too.
+    template <typename T>
+    static AssetHandle<T> Request(AssetType type, const std::string& path, uint64_t parameters, IoPriority priority, Job<T> job,
+                                  const std::vector<std::string>& dependencies = {}) {
+        bool created = false;
+        std::function<StatePtr<T>()> create = [&path]() {
+            auto state = std::make_shared<typename AssetHandle<T>::State>();
+            state->path = path;
+            return state;
+        };
+        StatePtr<T> state = AssetRegistry::Acquire<typename AssetHandle<T>::State>(AssetRegistry::PathKey(type, path, parameters), create, created);
+        if (!created) return AssetHandle<T>(state);
+
+        if (hotReload) WatchForReload<T>(state, job, dependencies);
+        Start<T>(state, priority, std::move(job));
+        return AssetHandle<T>(state);
+    }
+
+    // Queues a read of the file of a request and runs its job on a worker once the bytes have arrived
+    template <typename T>
+    static void Start(const StatePtr<T>& state, IoPriority priority, Job<T> job) {
+        auto run = [state, job = std::move(job)](FileView source) {
+            pool.Push([state, job, source = std::move(source)]() {
+                std::function<void()> upload;
+                try {
+                    upload = job(state, source);
+                } catch (const std::exception& e) {
+                    std::cerr << "ERROR: Loading " << state->path << " failed: " << e.what() << std::endl;
+                    upload = FailLater<T>(state);
+                }
+                Enqueue(std::move(upload));
+            });
+        };
+        if (const File* file = File::find(state->path)) {
+            AsyncFileReader::Read(*file, priority, [run](const File&, FileView contents) { run(std::move(contents)); });
+        } else {
+            run(FileView());
+        }
+    }
+
+    // Watches the files an asset is built from and registers a reload of it, which runs the asset's job again
+    // on a new state aimed at it (see FinishReload)
+    template <typename T>
+    static void WatchForReload(const StatePtr<T>& state, const Job<T>& job, const std::vector<std::string>& dependencies) {
+        std::weak_ptr<typename AssetHandle<T>::State> watched = state;
+        auto reload = [watched, job](std::chrono::steady_clock::time_point seen) {
+            StatePtr<T> target = watched.lock();
+            if (!target) return false;
+            if (target->status.load(std::memory_order_acquire) != AssetStatus::Ready) return true; // Nothing to replace yet
+
+            auto state = std::make_shared<typename AssetHandle<T>::State>();
+            state->path = target->path;
+            state->value = target->value; // Streamed textures stream the new version into the live one
+            state->reloadTarget = target;
+            state->reloadSerial = ++target->reloadSerial;
+            state->reloadStart = seen;
+            Start<T>(state, IoPriority::Critical, job);
+            return true;
+        };
+
+        std::vector<std::string> paths = { state->path };
+        paths.insert(paths.end(), dependencies.begin(), dependencies.end());
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        for (const std::string& path : paths) {
+            const File* file = File::find(path);
+            if (!file || file->isArchived() || !FileWatcher::Watch(path)) continue;
+            reloaders[File::canonicalPath(path)].push_back(reload);
+        }
+    }
+
+    // Starts reloads of the assets whose files changed. Render thread only.
+    static void StartReloads() {
+        std::vector<std::string> changed = FileWatcher::Poll();
+        if (changed.empty()) return;
+
+        auto seen = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        for (const std::string& path : changed) {
+            auto found = reloaders.find(path);
+            if (found == reloaders.end()) continue;
+            std::cout << "Reloading " << path << std::endl;
+            auto& reloads = found->second;
+            reloads.erase(std::remove_if(reloads.begin(), reloads.end(), [seen](const auto& reload) { return !reload(seen); }), reloads.end());
+            if (reloads.empty()) reloaders.erase(found);
+        }
+    }
+
+    // Registers the content of a request on the worker. If a live asset already has this content, returns
+    // the render thread step that resolves the request with it; otherwise returns an empty function.
+    template <typename T>
+    static std::function<void()> ShareContent(const StatePtr<T>& state, AssetType type, uint64_t contentHash, uint64_t parameters) {
+        std::string key = AssetRegistry::ContentKey(type, contentHash, parameters);
+        if (state->reloadTarget) {
+            // A reload always replaces its own asset; the key moves to it once the reload succeeded
+            state->contentKey = std::move(key);
+            return nullptr;
+        }
+        StatePtr<T> owner = AssetRegistry::Claim(key, state);
+        if (owner == state) {
+            state->contentKey = std::move(key);
+            return nullptr;
+        }
+
+        return [state, owner]() {
+            switch (owner->status.load(std::memory_order_acquire)) {
+                case AssetStatus::Ready: Resolve<T>(state, owner->value); break;
+                case AssetStatus::Failed: Fail<T>(state); break;
+                default: owner->dependents.push_back(state); break;
+            }
+        };
+    }
+
+    // Imports the mesh of a request unless a live asset already has the file's content. Returns nullptr
+    // in that case or on failure, with next set to the render thread step that resolves the request.
+    template <typename T>
+    static std::unique_ptr<Mesh> ImportMesh(const StatePtr<T>& state, const FileView& source, AssetType type, MeshFormat format,
+                                            const VertexFormat& vertexFormat, uint64_t parameters, std::function<void()>& next) {
+        next = FailLater<T>(state);
+        File* file = File::find(state->path);
+        if (!file || !source.isOpen()) return nullptr;
+
+        uint64_t contentHash = MeshLoader::HashSource(source, MeshLoader::IsStreamed(*file, source.size()));
+        // glTF files may reference buffers next to them, so equal text is only equal content within one directory
+        if (format == MeshFormat::GLTF) {
+            contentHash = Hash::String(std::filesystem::path(File::canonicalPath(state->path)).parent_path().generic_string(), contentHash);
+        }
+        if (auto shared = ShareContent<T>(state, type, contentHash, parameters)) {
+            next = std::move(shared);
+            return nullptr;
+        }
+
+        VertexFormat requested = vertexFormat;
+        auto mesh = std::make_unique<Mesh>(MeshLoader::LoadMesh(file, format, requested, &source));
+        if (mesh->vertexDataSize == 0) return nullptr;
+        return mesh;
+    }
+
+    // Worker step of the texture loaders: reads the cached mip chain of an image, or decodes the image,
+    // builds its mips, block compresses them unless compression is None and caches the result
+    static std::shared_ptr<TextureMipChain> BuildTextureChain(const std::string& path, const FileView& source, uint64_t contentHash,
+                                                              TextureCompression compression, const MipSettings& mips) {
+        uint64_t sourceHash = Hash::Combine(contentHash, Hash::Combine(static_cast<uint64_t>(compression), mips.Key()));
+        auto chain = std::make_shared<TextureMipChain>();
+        if (TextureCache::Load(path, sourceHash, BlockCompressor::GetGLFormat(compression), *chain)) return chain;
+
+        TextureData data;
+        if (!Texture::Decode(source.data(), source.size(), data, path)) return nullptr;
+        chain = MipGenerator::Build(data, mips);
+        if (compression != TextureCompression::None) chain = BlockCompressor::CompressChain(*chain, compression);
+        TextureCache::Write(path, sourceHash, *chain);
+        return chain;
+    }
+
+    // Load parameters of a mesh: format, vertex layout and the MeshLoader settings at request time
+    static uint64_t MeshParameters(MeshFormat format, const VertexFormat& vertexFormat) {
+        uint64_t hash = Hash::Combine(static_cast<uint64_t>(format), (MeshLoader::optimizeMeshes ? 1 : 0) | (MeshLoader::buildMeshlets ? 2 : 0));
+        hash = Hash::Combine(hash, Hash::Bytes(MeshLoader::lodRatios.data(), MeshLoader::lodRatios.size() * sizeof(float)));
+        for (const auto& attribute : vertexFormat.getAttributes()) {
+            hash = Hash::Combine(hash, Hash::Combine(Hash::Combine(attribute.count, attribute.type),
+                                                     Hash::Combine(attribute.normalized, attribute.stride)));
+            hash = Hash::Combine(hash, reinterpret_cast<uintptr_t>(attribute.pointer));
+        }
+        return hash;
+    }
+
+    static void Enqueue(std::function<void()> upload) {
+        {
+            std::lock_guard<std::mutex> lock(uploadMutex);
+            uploads.push_back(std::move(upload));
+        }
+        uploadReady.notify_one();
+    }
+
+    template <typename T>
+    static void Resolve(const StatePtr<T>& state, std::shared_ptr<T> value) {
+        if (state->reloadTarget) {
+            FinishReload<T>(state, std::move(value));
+            return;
+        }
+        state->value = value;
+        state->status.store(AssetStatus::Ready, std::memory_order_release);
+        state->promise.set_value(value);
+
+        auto callbacks = std::move(state->callbacks);
+        state->callbacks.clear();
+        for (auto& callback : callbacks) callback(*value);
+
+        auto dependents = std::move(state->dependents);
+        state->dependents.clear();
+        for (auto& dependent : dependents) Resolve<T>(dependent, value);
+    }
+
+    template <typename T>
+    static void Fail(const StatePtr<T>& state) {
+        if (state->reloadTarget) {
+            std::cerr << "ERROR: Failed to reload asset, keeping the previous version: " << state->path << std::endl;
+            ++reloadStats.failures;
+            return;
+        }
+        std::cerr << "ERROR: Failed to load asset: " << state->path << std::endl;
+        state->status.store(AssetStatus::Failed, std::memory_order_release);
+        state->promise.set_value(nullptr);
+        state->callbacks.clear();
+
+        auto dependents = std::move(state->dependents);
+        state->dependents.clear();
+        for (auto& dependent : dependents) Fail<T>(dependent);
+    }
+
+    // Swaps the new version of a reloaded asset into the live object, unless a later reload of it was started meanwhile.
+    // The previous version ends up in loaded and is destroyed with it.
+    template <typename T>
+    static void FinishReload(const StatePtr<T>& state, std::shared_ptr<T> loaded) {
+        const StatePtr<T>& target = state->reloadTarget;
+        if (state->reloadSerial != target->reloadSerial) return;
+
+        if (loaded != target->value) {
+            Replace(*target->value, *loaded);
+            AssetRegistry::SwapSizes(target->value.get(), loaded.get());
+        }
+        AssetRegistry::Forget(target->contentKey, target.get());
+        target->contentKey.clear();
+        if (!state->contentKey.empty() && AssetRegistry::Claim(state->contentKey, target) == target) target->contentKey = state->contentKey;
+
+        ++reloadStats.reloads;
+        reloadStats.lastMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - state->reloadStart).count();
+        std::cout << "Reloaded " << state->path << " in " << reloadStats.lastMilliseconds << " ms" << std::endl;
+    }
+
+    static void Replace(std::string& current, std::string& loaded) {
+        current.swap(loaded);
+    }
+
+    static void Replace(Mesh& current, Mesh& loaded) {
+        std::swap(current, loaded);
+    }
+
+    static void Replace(ShaderProgram& current, ShaderProgram& loaded) {
+        std::swap(current.ID, loaded.ID);
+        current.uniformLocations.clear();
+        loaded.uniformLocations.clear();
+    }
+
+    static void Replace(Texture& current, Texture& loaded) {
+        std::swap(current.textureID, loaded.textureID);
+        std::swap(current.textureHandle, loaded.textureHandle);
+        std::swap(current.useBindless, loaded.useBindless);
+        std::swap(current.width, loaded.width);
+        std::swap(current.height, loaded.height);
+    }
+
+    // Swaps the GL objects and what was derived from the mesh; the draw scratch buffers are rebuilt every frame
+    static void Replace(GeometryContainer& current, GeometryContainer& loaded) {
+        std::swap(current.vertexBuffer.ID, loaded.vertexBuffer.ID);
+        std::swap(current.vertexBuffer.bufferSize, loaded.vertexBuffer.bufferSize);
+        std::swap(current.indexBuffer.ID, loaded.indexBuffer.ID);
+        std::swap(current.indexBuffer.bufferSize, loaded.indexBuffer.bufferSize);
+        std::swap(current.vertexArray.ID, loaded.vertexArray.ID);
+        std::swap(current.subMeshes, loaded.subMeshes);
+        std::swap(current.lods, loaded.lods);
+        std::swap(current.meshlets, loaded.meshlets);
+        std::swap(current.clusterCuller, loaded.clusterCuller);
+        std::swap(current.indexType, loaded.indexType);
+        std::swap(current.positionScale, loaded.positionScale);
+        std::swap(current.positionOffset, loaded.positionOffset);
+        std::swap(current.boundsMin, loaded.boundsMin);
+        std::swap(current.boundsMax, loaded.boundsMax);
+        std::swap(current.boundsRadius, loaded.boundsRadius);
+        std::swap(current.uvDensity, loaded.uvDensity);
+        std::swap(current.arenaAllocation, loaded.arenaAllocation);
+    }
+
+    // Failure is reported on the render thread too, so callbacks and status change in one place
+    template <typename T>
+    static std::function<void()> FailLater(const StatePtr<T>& state) {
+        return [state]() { Fail<T>(state); };
+    }
+
+    static bool ReadSource(const std::string& path, std::string& source) {
+        const File* file = File::find(path);
+        if (!file) return false;
+        source = file->read();
+        return !source.empty();
+    }
+};
+
+double AssetService::uploadBudgetMs = 2.0;
+unsigned AssetService::workerCount = 0;
+AssetUploadStats AssetService::lastUploadStats;
+bool AssetService::hotReload = false;
+AssetReloadStats AssetService::reloadStats;
+
+std::deque<std::function<void()>> AssetService::uploads;
+std::mutex AssetService::uploadMutex;
+std::condition_variable AssetService::uploadReady;
+std::unordered_map<std::string, std::vector<std::function<bool(std::chrono::steady_clock::time_point)>>> AssetService::reloaders;
+std::mutex AssetService::reloadMutex;
+
+// Defined last so the workers are joined before the queues they use are destroyed
+AssetService::WorkerPool AssetService::pool;
@@ -0,0 +1,454 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include "../Core.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSOR_SSE2 1
+#endif
+
+/// <summary>
+/// GPU block compression formats a texture can be encoded in.
+/// </summary>
+enum class TextureCompression {
+    None,
+    BC1, // RGB, 4 bits per pixel
+    BC3, // RGBA with a separate alpha block, 8 bits per pixel
+    BC5, // Two channels (normal map X and Y), 8 bits per pixel
+    BC7  // RGBA at higher quality than BC1/BC3, 8 bits per pixel
+};
+
+/// <summary>
+/// CPU encoder for BC1, BC3, BC5 and BC7 blocks. Rows of blocks are spread over threads and the
+/// palette search, where the encoder spends its time, tests four pixels per SSE2 instruction.
+/// Endpoints come from the principal axis of each block and are refined once by least squares.
+/// BC7 uses mode 6 (one subset, RGBA endpoints with p-bits, 4-bit indices).
+/// </summary>
+class BlockCompressor {
+public:
+    /// GL format of the blocks; BC5 holds non-color data and has no sRGB variant.
+    static GLenum GetGLFormat(TextureCompression compression, bool srgb = false) {
+        switch (compression) {
+            case TextureCompression::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case TextureCompression::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case TextureCompression::BC5: return GL_COMPRESSED_RG_RGTC2;
+            case TextureCompression::BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+            default: return 0;
+        }
+    }
+
+    /// Bytes of one 4x4 block.
+    static size_t GetBlockBytes(TextureCompression compression) {
+        switch (compression) {
+            case TextureCompression::None: return 0;
+            case TextureCompression::BC1: return 8;
+            default: return 16;
+        }
+    }
+
+    /// <summary>
+    /// Compresses every level of an uncompressed mip chain.
+    /// </summary>
+    /// <param name="maxThreads">Worker count, 0 uses all hardware threads.</param>
+    static std::shared_ptr<TextureMipChain> CompressChain(const TextureMipChain& source, TextureCompression compression, unsigned maxThreads = 0) {
+        auto chain = std::make_shared<TextureMipChain>();
+        chain->channels = source.channels;
+        chain->srgb = source.srgb && compression != TextureCompression::BC5;
+        chain->compressedFormat = GetGLFormat(compression, chain->srgb);
+        for (const auto& level : source.levels) {
+            TextureMip mip;
+            mip.width = level.width;
+            mip.height = level.height;
+            mip.pixels = CompressLevel(level, source.channels, compression, maxThreads);
+            chain->levels.push_back(std::move(mip));
+        }
+        return chain;
+    }
+
+    /// <summary>
+    /// Compresses one image of 1 to 4 channels. Partial blocks at the edges repeat the last row and column.
+    /// </summary>
+    /// <returns>The blocks in row order, or an empty vector for TextureCompression::None.</returns>
+    static std::vector<unsigned char> CompressLevel(const TextureMip& level, int channels, TextureCompression compression, unsigned maxThreads = 0) {
+        size_t blockBytes = GetBlockBytes(compression);
+        size_t blocksX = static_cast<size_t>(level.width + 3) / 4;
+        size_t blocksY = static_cast<size_t>(level.height + 3) / 4;
+        std::vector<unsigned char> blocks(blocksX * blocksY * blockBytes);
+        if (blocks.empty()) return blocks;
+
+        auto encodeRows = [&](size_t firstRow, size_t lastRow) {
+            Block block;
+            for (size_t by = firstRow; by < lastRow; ++by) {
+                for (size_t bx = 0; bx < blocksX; ++bx) {
+                    LoadBlock(level, channels, bx, by, block);
+                    unsigned char* out = &blocks[(by * blocksX + bx) * blockBytes];
+                    switch (compression) {
+                        case TextureCompression::BC1: EncodeBC1(block, out); break;
+                        case TextureCompression::BC3: EncodeBC3(block, out); break;
+                        case TextureCompression::BC5: EncodeBC5(block, out); break;
+                        case TextureCompression::BC7: EncodeBC7(block, out); break;
+                        default: break;
+                    }
+                }
+            }
+        };
+
+        // Small levels are not worth a thread
+        unsigned threadCount = maxThreads ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+        threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, std::max<size_t>(1, blocksX * blocksY / MinBlocksPerThread)));
+        threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, blocksY));
+
+        std::vector<std::thread> workers;
+        size_t rowsPerThread = (blocksY + threadCount - 1) / threadCount;
+        for (unsigned t = 1; t < threadCount; ++t) {
+            size_t first = t * rowsPerThread;
+            if (first < blocksY) workers.emplace_back(encodeRows, first, std::min(blocksY, first + rowsPerThread));
+        }
+        encodeRows(0, std::min(blocksY, rowsPerThread));
+        for (auto& worker : workers) worker.join();
+        return blocks;
+    }
+
+    /// <summary>
+    /// The pixels of one 4x4 block as floats in [0, 255], one array per channel for the SIMD search.
+    /// </summary>
+    struct Block {
+        float r[16], g[16], b[16], a[16];
+    };
+
+    static void EncodeBC1(const Block& block, unsigned char out[8]) {
+        float mean[4], axis[4];
+        PrincipalAxis(block, 3, mean, axis);
+        float low[4], high[4];
+        AxisExtents(block, 3, mean, axis, low, high);
+
+        unsigned char candidate[8];
+        float bestError = EncodeBC1Endpoints(block, high, low, out);
+
+        // Refit the endpoints to the chosen indices
+        uint8_t indices[16];
+        for (int i = 0; i < 16; ++i) indices[i] = (out[4 + i / 4] >> ((i % 4) * 2)) & 3;
+        static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+        if (FitEndpoints(block, 3, indices, weights, high, low)) {
+            float error = EncodeBC1Endpoints(block, high, low, candidate);
+            if (error < bestError) std::memcpy(out, candidate, 8);
+        }
+    }
+
+    static void EncodeBC3(const Block& block, unsigned char out[16]) {
+        EncodeBC4(block.a, out);
+        EncodeBC1(block, out + 8);
+    }
+
+    static void EncodeBC5(const Block& block, unsigned char out[16]) {
+        EncodeBC4(block.r, out);
+        EncodeBC4(block.g, out + 8);
+    }
+
+    /// One channel in the 8 value mode: two endpoints and six interpolated values.
+    static void EncodeBC4(const float values[16], unsigned char out[8]) {
+        float low = values[0];
+        float high = values[0];
+        for (int i = 1; i < 16; ++i) {
+            low = std::min(low, values[i]);
+            high = std::max(high, values[i]);
+        }
+        int end0 = static_cast<int>(std::lround(high));
+        int end1 = static_cast<int>(std::lround(low));
+        out[0] = static_cast<unsigned char>(end0);
+        out[1] = static_cast<unsigned char>(end1);
+
+        uint64_t bits = 0;
+        if (end0 > end1) {
+            float scale = 7.0f / static_cast<float>(end0 - end1);
+            for (int i = 0; i < 16; ++i) {
+                // Position 0 is end1 and 7 is end0; index 0 is end0, 1 is end1, 2..7 run from end0 to end1
+                int position = static_cast<int>(std::lround((values[i] - end1) * scale));
+                position = std::clamp(position, 0, 7);
+                uint64_t index = position == 7 ? 0 : position == 0 ? 1 : 8 - position;
+                bits |= index << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; ++i) out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+
+    static void EncodeBC7(const Block& block, unsigned char out[16]) {
+        float mean[4], axis[4];
+        PrincipalAxis(block, 4, mean, axis);
+        float low[4], high[4];
+        AxisExtents(block, 4, mean, axis, low, high);
+
+        uint8_t indices[16];
+        float bestError = EncodeBC7Endpoints(block, low, high, out, indices);
+
+        float weights[16];
+        for (int i = 0; i < 16; ++i) weights[i] = BC7Weights[i] / 64.0f;
+        if (FitEndpoints(block, 4, indices, weights, low, high)) {
+            unsigned char candidate[16];
+            uint8_t candidateIndices[16];
+            float error = EncodeBC7Endpoints(block, low, high, candidate, candidateIndices);
+            if (error < bestError) std::memcpy(out, candidate, 16);
+        }
+    }
+
+private:
+    static constexpr size_t MinBlocksPerThread = 1024;
+
+    static constexpr int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    static void LoadBlock(const TextureMip& level, int channels, size_t bx, size_t by, Block& block) {
+        for (int y = 0; y < 4; ++y) {
+            size_t sy = std::min<size_t>(by * 4 + y, static_cast<size_t>(level.height) - 1);
+            for (int x = 0; x < 4; ++x) {
+                size_t sx = std::min<size_t>(bx * 4 + x, static_cast<size_t>(level.width) - 1);
+                const unsigned char* p = &level.pixels[(sy * level.width + sx) * channels];
+                int i = y * 4 + x;
+                if (channels >= 3) {
+                    block.r[i] = p[0];
+                    block.g[i] = p[1];
+                    block.b[i] = p[2];
+                } else {
+                    block.r[i] = block.g[i] = block.b[i] = p[0];
+                }
+                block.a[i] = channels == 4 ? p[3] : channels == 2 ? p[1] : 255.0f;
+            }
+        }
+    }
+
+    // Mean and dominant direction of the block's colors, by power iteration on the covariance
+    static void PrincipalAxis(const Block& block, int channels, float mean[4], float axis[4]) {
+        const float* data[4] = { block.r, block.g, block.b, block.a };
+        for (int c = 0; c < 4; ++c) {
+            mean[c] = 0.0f;
+            if (c < channels) {
+                for (int i = 0; i < 16; ++i) mean[c] += data[c][i];
+                mean[c] /= 16.0f;
+            }
+        }
+
+        float covariance[4][4] = {};
+        for (int i = 0; i < 16; ++i) {
+            float d[4];
+            for (int c = 0; c < 4; ++c) d[c] = c < channels ? data[c][i] - mean[c] : 0.0f;
+            for (int j = 0; j < 4; ++j) {
+                for (int k = 0; k < 4; ++k) covariance[j][k] += d[j] * d[k];
+            }
+        }
+
+        float v[4] = { 1.0f, 1.0f, 1.0f, channels == 4 ? 1.0f : 0.0f };
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[4] = {};
+            for (int j = 0; j < 4; ++j) {
+                for (int k = 0; k < 4; ++k) next[j] += covariance[j][k] * v[k];
+            }
+            float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+            if (length <= 1e-12f) break;
+            for (int c = 0; c < 4; ++c) v[c] = next[c] / length;
+        }
+        float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+        for (int c = 0; c < 4; ++c) axis[c] = length > 0.0f ? v[c] / length : 0.0f;
+    }
+
+    // Endpoints at the extreme projections of the block onto the axis
+    static void AxisExtents(const Block& block, int channels, const float mean[4], const float axis[4], float low[4], float high[4]) {
+        const float* data[4] = { block.r, block.g, block.b, block.a };
+        float minT = 0.0f, maxT = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+            for (int c = 0; c < channels; ++c) t += (data[c][i] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+        for (int c = 0; c < 4; ++c) {
+            float base = c < channels ? mean[c] : 255.0f;
+            low[c] = std::clamp(base + axis[c] * minT, 0.0f, 255.0f);
+            high[c] = std::clamp(base + axis[c] * maxT, 0.0f, 255.0f);
+        }
+    }
+
+    // Least squares endpoints for fixed indices; weights[index] is the share of end1 in that palette entry
+    static bool FitEndpoints(const Block& block, int channels, const uint8_t indices[16], const float* weights, float end0[4], float end1[4]) {
+        const float* data[4] = { block.r, block.g, block.b, block.a };
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; ++i) {
+            float w1 = weights[indices[i]];
+            float w0 = 1.0f - w1;
+            aa += w0 * w0;
+            ab += w0 * w1;
+            bb += w1 * w1;
+            for (int c = 0; c < channels; ++c) {
+                ax[c] += w0 * data[c][i];
+                bx[c] += w1 * data[c][i];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f) return false;
+
+        for (int c = 0; c < channels; ++c) {
+            end0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+            end1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    // Index of the nearest palette entry for every pixel; returns the summed squared error
+    static float FindIndices(const Block& block, const float (*palette)[4], int paletteSize, uint8_t indices[16]) {
+        float total = 0.0f;
+#ifdef BLOCK_COMPRESSOR_SSE2
+        for (int i = 0; i < 16; i += 4) {
+            __m128 r = _mm_loadu_ps(block.r + i);
+            __m128 g = _mm_loadu_ps(block.g + i);
+            __m128 b = _mm_loadu_ps(block.b + i);
+            __m128 a = _mm_loadu_ps(block.a + i);
+            __m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+            __m128i bestIndex = _mm_setzero_si128();
+            for (int p = 0; p < paletteSize; ++p) {
+                __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+                __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+                __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+                __m128 da = _mm_sub_ps(a, _mm_set1_ps(palette[p][3]));
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+                                             _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+                __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+                best = _mm_min_ps(distance, best);
+                bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+            }
+            alignas(16) int32_t chosen[4];
+            alignas(16) float errors[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(chosen), bestIndex);
+            _mm_store_ps(errors, best);
+            for (int k = 0; k < 4; ++k) {
+                indices[i + k] = static_cast<uint8_t>(chosen[k]);
+                total += errors[k];
+            }
+        }
+#else
+        for (int i = 0; i < 16; ++i) {
+            float best = std::numeric_limits<float>::max();
+            for (int p = 0; p < paletteSize; ++p) {
+                float dr = block.r[i] - palette[p][0];
+                float dg = block.g[i] - palette[p][1];
+                float db = block.b[i] - palette[p][2];
+                float da = block.a[i] - palette[p][3];
+                float distance = dr * dr + dg * dg + db * db + da * da;
+                if (distance < best) {
+                    best = distance;
+                    indices[i] = static_cast<uint8_t>(p);
+                }
+            }
+            total += best;
+        }
+#endif
+        return total;
+    }
+
+    static uint16_t To565(const float color[4]) {
+        int r = static_cast<int>(std::lround(color[0] * 31.0f / 255.0f));
+        int g = static_cast<int>(std::lround(color[1] * 63.0f / 255.0f));
+        int b = static_cast<int>(std::lround(color[2] * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    static void From565(uint16_t value, float color[4]) {
+        int r = (value >> 11) & 31;
+        int g = (value >> 5) & 63;
+        int b = value & 31;
+        color[0] = static_cast<float>((r << 3) | (r >> 2));
+        color[1] = static_cast<float>((g << 2) | (g >> 4));
+        color[2] = static_cast<float>((b << 3) | (b >> 2));
+        color[3] = 0.0f;
+    }
+
+    // Writes a four color BC1 block (color0 > color1) for two endpoints; returns its error
+    static float EncodeBC1Endpoints(const Block& block, const float end0[4], const float end1[4], unsigned char out[8]) {
+        uint16_t color0 = To565(end0);
+        uint16_t color1 = To565(end1);
+        if (color0 < color1) std::swap(color0, color1);
+
+        float palette[4][4];
+        From565(color0, palette[0]);
+        From565(color1, palette[1]);
+        for (int c = 0; c < 4; ++c) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        // Alpha does not take part in the color search
+        Block colors = block;
+        std::fill(std::begin(colors.a), std::end(colors.a), 0.0f);
+        uint8_t indices[16];
+        float error = FindIndices(colors, palette, color0 == color1 ? 1 : 4, indices);
+
+        uint32_t bits = 0;
+        for (int i = 0; i < 16; ++i) bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+        out[0] = static_cast<unsigned char>(color0);
+        out[1] = static_cast<unsigned char>(color0 >> 8);
+        out[2] = static_cast<unsigned char>(color1);
+        out[3] = static_cast<unsigned char>(color1 >> 8);
+        for (int i = 0; i < 4; ++i) out[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+        return error;
+    }
+
+    // Writes a mode 6 BC7 block, trying all four p-bit pairs; returns its error
+    static float EncodeBC7Endpoints(const Block& block, const float end0[4], const float end1[4], unsigned char out[16], uint8_t indices[16]) {
+        float bestError = std::numeric_limits<float>::max();
+        int best[2][4] = {};
+        int bestP[2] = {};
+        uint8_t candidate[16];
+        for (int pbits = 0; pbits < 4; ++pbits) {
+            int p[2] = { pbits & 1, pbits >> 1 };
+            int q[2][4];
+            float palette[16][4];
+            for (int c = 0; c < 4; ++c) {
+                q[0][c] = std::clamp(static_cast<int>(std::lround((end0[c] - p[0]) / 2.0f)), 0, 127);
+                q[1][c] = std::clamp(static_cast<int>(std::lround((end1[c] - p[1]) / 2.0f)), 0, 127);
+                int v0 = (q[0][c] << 1) | p[0];
+                int v1 = (q[1][c] << 1) | p[1];
+                for (int i = 0; i < 16; ++i) {
+                    palette[i][c] = static_cast<float>(((64 - BC7Weights[i]) * v0 + BC7Weights[i] * v1 + 32) >> 6);
+                }
+            }
+            float error = FindIndices(block, palette, 16, candidate);
+            if (error < bestError) {
+                bestError = error;
+                std::memcpy(best, q, sizeof(q));
+                bestP[0] = p[0];
+                bestP[1] = p[1];
+                std::memcpy(indices, candidate, 16);
+            }
+        }
+
+        // The first index is stored without its top bit, so it must be below 8
+        if (indices[0] >= 8) {
+            for (int c = 0; c < 4; ++c) std::swap(best[0][c], best[1][c]);
+            std::swap(bestP[0], bestP[1]);
+            for (int i = 0; i < 16; ++i) indices[i] = static_cast<uint8_t>(15 - indices[i]);
+        }
+
+        std::memset(out, 0, 16);
+        size_t position = 0;
+        auto write = [&](uint32_t value, int bits) {
+            for (int i = 0; i < bits; ++i, ++position) {
+                if ((value >> i) & 1) out[position / 8] |= static_cast<unsigned char>(1u << (position % 8));
+            }
+        };
+        write(1u << 6, 7); // Mode 6
+        for (int c = 0; c < 4; ++c) {
+            write(static_cast<uint32_t>(best[0][c]), 7);
+            write(static_cast<uint32_t>(best[1][c]), 7);
+        }
+        write(static_cast<uint32_t>(bestP[0]), 1);
+        write(static_cast<uint32_t>(bestP[1]), 1);
+        write(indices[0], 3);
+        for (int i = 1; i < 16; ++i) write(indices[i], 4);
+        return bestError;
+    }
+};
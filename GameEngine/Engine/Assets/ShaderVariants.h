@@ -0,0 +1,246 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <exception>
+#include <initializer_list>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include "../Core.h"
+#include "../FileSystem.h"
+
+/// <summary>
+/// Shader variants built by ShaderVariants since startup. Render thread only.
+/// </summary>
+struct ShaderVariantStats {
+    size_t requested = 0;             // Variants asked for the first time
+    size_t cached = 0;                // Of those, loaded from a program binary instead of compiled
+    size_t failed = 0;
+    size_t compiling = 0;             // Compiles issued to the driver and not finished yet
+    double compileMilliseconds = 0;   // From issuing the compiles of each variant to finding them done
+};
+
+/// <summary>
+/// The programs built from one vertex and one fragment shader with different sets of #defines, e.g.
+/// { "ALPHA_TEST", "SHADOWS=4" }. The sources are read once and run through ShaderPreprocessor, so they may
+/// #include shared files. A variant is built the first time it is asked for, and only its compiles and link are
+/// issued then: Get returns nullptr until Update finds them complete, so the driver can build every variant
+/// requested in a frame at once, on its own threads with GL_KHR_parallel_shader_compile. From then on the
+/// variant is served from the cache. Variants are cached as program binaries as well (see ProgramCache).
+/// Render thread only.
+/// </summary>
+class ShaderVariants {
+public:
+    static ShaderVariantStats stats;
+
+    ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath) {}
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    /// <summary>
+    /// The program of a variant, issuing its build if this is the first time it is asked for.
+    /// </summary>
+    /// <param name="defines">Defines as "NAME" or "NAME=VALUE", in any order.</param>
+    /// <returns>The program, or nullptr while it is compiling or if it failed to build.</returns>
+    ShaderProgram* Get(const std::vector<std::string>& defines = {}) {
+        return GetByKey(ShaderPreprocessor::VariantKey(defines));
+    }
+
+    /// <summary>
+    /// Same as Get, for a key made once with ShaderPreprocessor::VariantKey, which saves sorting the defines
+    /// on every draw.
+    /// </summary>
+    ShaderProgram* GetByKey(const std::string& variantKey) {
+        const Variant& variant = Find(variantKey);
+        return variant.status == Status::Ready ? variant.program.get() : nullptr;
+    }
+
+    /// <summary>
+    /// Issues the builds of several variants together, e.g. while loading a level, so none of them stalls
+    /// the frame it is first drawn in.
+    /// </summary>
+    void Prepare(std::initializer_list<std::vector<std::string>> variants) {
+        for (const auto& defines : variants) Find(ShaderPreprocessor::VariantKey(defines));
+    }
+
+    /// <summary>
+    /// The program of a variant, waiting for its build to finish if it is still compiling.
+    /// </summary>
+    /// <returns>The program, or nullptr if it failed to build.</returns>
+    ShaderProgram* Wait(const std::vector<std::string>& defines = {}) {
+        Variant& variant = Find(ShaderPreprocessor::VariantKey(defines));
+        if (variant.status == Status::Compiling) {
+            Finish(variant);
+            pending.erase(std::remove_if(pending.begin(), pending.end(), [&](const auto& entry) { return entry.get() == &variant; }),
+                          pending.end());
+            stats.compiling = pending.size();
+        }
+        return variant.status == Status::Ready ? variant.program.get() : nullptr;
+    }
+
+    /// Number of variants asked for so far, including those still compiling or failed.
+    size_t GetVariantCount() const {
+        return variants.size();
+    }
+
+    /// <summary>
+    /// Finishes the variants whose compiles are done. Called once per frame by Renderer::Render.
+    /// Without GL_KHR_parallel_shader_compile the driver cannot tell, so variants finish the frame after
+    /// they were asked for, waiting for the driver if it compiles in the background anyway.
+    /// </summary>
+    static void Update() {
+        if (pending.empty()) return;
+        auto done = std::remove_if(pending.begin(), pending.end(), [](const std::shared_ptr<Variant>& variant) {
+            if (!variant->program->IsLinkComplete()) return false;
+            Finish(*variant);
+            return true;
+        });
+        pending.erase(done, pending.end());
+        stats.compiling = pending.size();
+    }
+
+    /// <summary>
+    /// Drops the variants still compiling, so nothing holds their programs past the ShaderVariants that made
+    /// them. Call before the GL context is destroyed; each ShaderVariants must be destroyed by then as well.
+    /// </summary>
+    static void Shutdown() {
+        pending.clear();
+        stats.compiling = 0;
+    }
+
+private:
+    enum class Status {
+        Compiling,
+        Ready,
+        Failed
+    };
+
+    struct Variant {
+        Status status = Status::Compiling;
+        std::string name; // Shaders and defines, for error messages
+        std::unique_ptr<ShaderProgram> program;
+        std::unique_ptr<Shader> vertexShader;
+        std::unique_ptr<Shader> fragmentShader;
+        std::vector<std::string> vertexFiles;   // Source string numbers of compiler messages, see ShaderPreprocessor
+        std::vector<std::string> fragmentFiles;
+        std::string cachePath;
+        uint64_t cacheKey = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Returns the variant with the given defines, issuing its build if it is new
+    Variant& Find(const std::string& variantKey) {
+        auto found = variants.find(variantKey);
+        if (found != variants.end()) return *found->second;
+
+        auto variant = std::make_shared<Variant>();
+        variants[variantKey] = variant;
+        ++stats.requested;
+        variant->name = vertexPath + " + " + fragmentPath;
+        if (!variantKey.empty()) {
+            std::string defines = variantKey;
+            defines.pop_back();
+            std::replace(defines.begin(), defines.end(), '\n', ' ');
+            variant->name += " [" + defines + "]";
+        }
+
+        std::string vertexSource, fragmentSource;
+        if (!ReadSources() ||
+            !ShaderPreprocessor::Process(vertexPath, vertexText, variantKey, vertexSource, &variant->vertexFiles) ||
+            !ShaderPreprocessor::Process(fragmentPath, fragmentText, variantKey, fragmentSource, &variant->fragmentFiles)) {
+            std::cerr << "ERROR: Unable to build shader variant " << variant->name << std::endl;
+            variant->status = Status::Failed;
+            ++stats.failed;
+            return *variant;
+        }
+
+        variant->cacheKey = ProgramCache::Key({ vertexSource, fragmentSource }, variantKey);
+        variant->cachePath = ProgramCache::GetCachePath(vertexPath, fragmentPath, variantKey);
+        ProgramCache::Binary binary;
+        ProgramCache::Read(variant->cachePath, binary);
+        variant->program = std::make_unique<ShaderProgram>();
+        if (ProgramCache::Load(binary, variant->cacheKey, *variant->program)) {
+            variant->status = Status::Ready;
+            ++stats.cached;
+            return *variant;
+        }
+
+        // Only issued here; the results are checked once the driver reports them done
+        variant->start = std::chrono::steady_clock::now();
+        variant->program = std::make_unique<ShaderProgram>(); // A rejected binary leaves the program unusable
+        variant->vertexShader = std::make_unique<Shader>(GL_VERTEX_SHADER);
+        variant->fragmentShader = std::make_unique<Shader>(GL_FRAGMENT_SHADER);
+        variant->vertexShader->StartCompile(vertexSource);
+        variant->fragmentShader->StartCompile(fragmentSource);
+        variant->program->AttachShader(*variant->vertexShader);
+        variant->program->AttachShader(*variant->fragmentShader);
+        ProgramCache::PrepareForCaching(*variant->program);
+        variant->program->StartLink();
+        pending.push_back(variant);
+        stats.compiling = pending.size();
+        return *variant;
+    }
+
+    // Checks the results of a variant's compiles and link, waiting for them if needed
+    static void Finish(Variant& variant) {
+        try {
+            variant.vertexShader->CheckCompile();
+            variant.fragmentShader->CheckCompile();
+            variant.program->CheckLink();
+        } catch (const std::exception& e) {
+            std::cerr << "ERROR: " << e.what() << " Variant: " << variant.name << std::endl;
+            PrintFiles("vertex", variant.vertexFiles);
+            PrintFiles("fragment", variant.fragmentFiles);
+            variant.status = Status::Failed;
+            variant.program.reset();
+            variant.vertexShader.reset();
+            variant.fragmentShader.reset();
+            ++stats.failed;
+            return;
+        }
+
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - variant.start).count();
+        stats.compileMilliseconds += milliseconds;
+        ProgramCache::Write(variant.cachePath, variant.cacheKey, *variant.program, milliseconds);
+        variant.vertexShader.reset();
+        variant.fragmentShader.reset();
+        variant.status = Status::Ready;
+    }
+
+    // Lists the files behind the source string numbers of compiler messages, when a shader includes any
+    static void PrintFiles(const char* stage, const std::vector<std::string>& files) {
+        if (files.size() < 2) return;
+        std::cerr << "  Sources of the " << stage << " shader:";
+        for (size_t i = 0; i < files.size(); ++i) std::cerr << " " << i << "=" << files[i];
+        std::cerr << std::endl;
+    }
+
+    bool ReadSources() {
+        if (!sourcesRead) {
+            sourcesRead = true;
+            const File* vertexFile = File::find(vertexPath);
+            const File* fragmentFile = File::find(fragmentPath);
+            if (vertexFile) vertexText = vertexFile->read();
+            if (fragmentFile) fragmentText = fragmentFile->read();
+        }
+        return !vertexText.empty() && !fragmentText.empty();
+    }
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string vertexText;
+    std::string fragmentText;
+    bool sourcesRead = false;
+    std::unordered_map<std::string, std::shared_ptr<Variant>> variants; // Variant key -> variant
+
+    // Variants whose compiles were issued and not checked yet, of every ShaderVariants
+    static std::vector<std::shared_ptr<Variant>> pending;
+};
+
+ShaderVariantStats ShaderVariants::stats;
+std::vector<std::shared_ptr<ShaderVariants::Variant>> ShaderVariants::pending;
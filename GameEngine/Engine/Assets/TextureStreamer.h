@@ -0,0 +1,347 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include "../Core.h"
+#include "AssetRegistry.h"
+
+/// <summary>
+/// Texture bytes streamed by the last TextureStreamer::Update call, and the memory held by streamed textures.
+/// </summary>
+struct TextureStreamStats {
+    size_t bytes = 0;
+    size_t levelsCompleted = 0;
+    size_t levelsEvicted = 0;
+    size_t pendingTextures = 0;  // Textures with fewer mips resident than they need
+    size_t residentBytes = 0;    // Mips resident in all streamed textures
+};
+
+/// <summary>
+/// Streams decoded textures into GL a few rows at a time, or a level at a time for block compressed chains,
+/// and decides which of their mips stay resident.
+/// Every frame, objects report how many screen pixels one UV unit of each of their textures covers
+/// (RequestResolution), which gives the finest level the texture needs. Missing levels are uploaded
+/// smallest first through a fenced PixelUnpackRing, at most bytesPerFrame per frame, and GL_TEXTURE_BASE_LEVEL
+/// is lowered as each level completes, so a texture sharpens progressively without a frame ever waiting on a
+/// large upload. Resident levels stay until an upload would go over residentBudget; then the finest levels of
+/// the least recently used textures are released, detail no object needs first. Textures nothing has asked
+/// about stream to full size.
+/// </summary>
+class TextureStreamer {
+public:
+    /// Pixel bytes uploaded per frame at most; a frame always uploads at least one row when a slot is free.
+    static size_t bytesPerFrame;
+
+    /// Slots and slot size of the upload ring, read when the ring is created on first use.
+    static size_t ringSlots;
+    static size_t ringSlotSize;
+
+    /// Memory all streamed mips may hold together. Levels no larger than residentTailSize are never released.
+    static size_t residentBudget;
+    static int residentTailSize;
+
+    /// Added to the level each texture needs; positive values trade sharpness for memory.
+    static float mipBias;
+
+    static TextureStreamStats lastStreamStats;
+
+    /// <summary>
+    /// Queues a mip chain for upload into a texture, replacing its placeholder. Render thread only.
+    /// The chain is kept to bring released levels back; streaming stops when the texture is released.
+    /// </summary>
+    static void Stream(const std::shared_ptr<Texture>& texture, std::shared_ptr<TextureMipChain> chain) {
+        GLenum internalFormat = chain ? chain->compressedFormat : 0;
+        GLenum dataFormat = GL_RGBA;
+        if (!texture || !chain || chain->levels.empty() ||
+            (!internalFormat && !Texture::GetFormats(chain->channels, internalFormat, dataFormat, chain->srgb))) {
+            std::cerr << "ERROR: Cannot stream texture" << (texture ? ": " + texture->textureFile.getPath() : "") << std::endl;
+            return;
+        }
+
+        Entry& entry = entries[texture.get()];
+        totalResidentBytes -= entry.residentBytes;
+        entry = Entry();
+        entry.texture = texture;
+        entry.chain = std::move(chain);
+        entry.residentLevel = static_cast<int>(entry.chain->levels.size());
+        entry.internalFormat = internalFormat;
+        entry.dataFormat = dataFormat;
+    }
+
+    /// <summary>
+    /// Reports that a texture is drawn this frame with one UV unit covering pixelsPerUv pixels on screen.
+    /// The largest report of a frame decides the finest level the texture keeps. Render thread only.
+    /// </summary>
+    static void RequestResolution(const Texture* texture, float pixelsPerUv) {
+        auto found = entries.find(texture);
+        if (found == entries.end()) return;
+        Entry& entry = found->second;
+        entry.requestedPixels = std::max(entry.requestedPixels, pixelsPerUv);
+        entry.lastUsedFrame = frame;
+    }
+
+    /// <summary>
+    /// Finest level resident in a streamed texture; its level count while only the placeholder is loaded,
+    /// and -1 for textures the streamer does not manage.
+    /// </summary>
+    static int GetResidentLevel(const Texture* texture) {
+        auto found = entries.find(texture);
+        return found == entries.end() ? -1 : found->second.residentLevel;
+    }
+
+    /// <summary>
+    /// Turns last frame's requests into the level each texture needs, then uploads missing mip rows within
+    /// bytesPerFrame and residentBudget. Called once per frame from the render thread, before drawing.
+    /// </summary>
+    static void Update() {
+        TextureStreamStats stats;
+        for (auto it = entries.begin(); it != entries.end();) {
+            Entry& entry = it->second;
+            if (entry.texture.expired()) {
+                totalResidentBytes -= entry.residentBytes;
+                it = entries.erase(it);
+                continue;
+            }
+            if (entry.lastUsedFrame == frame && entry.requestedPixels > 0.0f) {
+                entry.wantedLevel = WantedLevel(entry);
+                entry.requestedPixels = 0.0f;
+            }
+            ++it;
+        }
+        ++frame;
+
+        std::vector<Entry*> pending;
+        for (auto& [texture, entry] : entries) {
+            if (entry.residentLevel > entry.wantedLevel) pending.push_back(&entry);
+        }
+        // Levels already half uploaded finish first, then textures by how recently they were drawn
+        std::sort(pending.begin(), pending.end(), [](const Entry* a, const Entry* b) {
+            if ((a->row > 0) != (b->row > 0)) return a->row > 0;
+            return a->lastUsedFrame > b->lastUsedFrame;
+        });
+
+        if (!pending.empty()) {
+            if (!ring) ring = std::make_unique<PixelUnpackRing>(ringSlots, ringSlotSize);
+
+            GLint previousAlignment;
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+            bool slotsLeft = true;
+            for (Entry* entry : pending) {
+                while (entry->residentLevel > entry->wantedLevel && stats.bytes < bytesPerFrame) {
+                    if (entry->row == 0 && !Reserve(*entry, entry->chain->LevelBytes(entry->residentLevel - 1), stats)) break;
+                    if (!UploadRows(*entry, stats)) {
+                        slotsLeft = false;
+                        break;
+                    }
+                }
+                if (!slotsLeft || stats.bytes >= bytesPerFrame) break;
+            }
+
+            glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        for (const auto& [texture, entry] : entries) {
+            if (entry.residentLevel > entry.wantedLevel) ++stats.pendingTextures;
+        }
+        stats.residentBytes = totalResidentBytes;
+        lastStreamStats = stats;
+    }
+
+    /// Drops all streaming state and the ring. Call before the GL context is destroyed.
+    static void Shutdown() {
+        entries.clear();
+        totalResidentBytes = 0;
+        ring.reset();
+    }
+
+private:
+    struct Entry {
+        std::weak_ptr<Texture> texture;
+        std::shared_ptr<TextureMipChain> chain;
+        int residentLevel = 0;  // Finest complete level; the level count while only the placeholder is loaded
+        int wantedLevel = 0;    // Finest level the texture needs
+        int row = 0;            // Next row of residentLevel - 1
+        float requestedPixels = 0.0f;
+        uint64_t lastUsedFrame = 0;
+        size_t residentBytes = 0;
+        GLenum internalFormat = GL_RGBA; // Or the compressed format
+        GLenum dataFormat = GL_RGBA;
+    };
+
+    static std::unordered_map<const Texture*, Entry> entries;
+    static std::unique_ptr<PixelUnpackRing> ring;
+    static size_t totalResidentBytes;
+    static uint64_t frame;
+
+    // Level whose texels map about one to one onto pixels at the requested resolution
+    static int WantedLevel(const Entry& entry) {
+        auto texture = entry.texture.lock();
+        // Bindless textures only become resident once level 0 is in
+        if (texture && texture->useBindless) return 0;
+        const TextureMip& base = entry.chain->levels[0];
+        float level = std::log2(static_cast<float>(std::max(base.width, base.height)) / entry.requestedPixels) + mipBias;
+        return std::clamp(static_cast<int>(std::floor(level)), 0, static_cast<int>(entry.chain->levels.size()) - 1);
+    }
+
+    // Makes room for bytes more resident memory, releasing levels of other textures if needed
+    static bool Reserve(const Entry& entry, size_t bytes, TextureStreamStats& stats) {
+        while (totalResidentBytes + bytes > residentBudget) {
+            Entry* victim = FindVictim(entry);
+            if (!victim) return false;
+            EvictLevel(*victim, stats);
+        }
+        return true;
+    }
+
+    // The least recently used texture holding detail it does not need, else the least recently used one
+    // drawn less recently than the requester
+    static Entry* FindVictim(const Entry& requester) {
+        Entry* surplus = nullptr;
+        Entry* older = nullptr;
+        for (auto& [texture, entry] : entries) {
+            if (&entry == &requester || entry.row > 0 || !CanEvict(entry)) continue;
+            if (entry.residentLevel < entry.wantedLevel) {
+                if (!surplus || entry.lastUsedFrame < surplus->lastUsedFrame) surplus = &entry;
+            } else if (entry.lastUsedFrame < requester.lastUsedFrame) {
+                if (!older || entry.lastUsedFrame < older->lastUsedFrame) older = &entry;
+            }
+        }
+        return surplus ? surplus : older;
+    }
+
+    static bool CanEvict(const Entry& entry) {
+        auto texture = entry.texture.lock();
+        // A bindless handle freezes the texture's parameters, so its levels stay
+        if (!texture || texture->useBindless) return false;
+        if (entry.residentLevel >= static_cast<int>(entry.chain->levels.size())) return false;
+        const TextureMip& mip = entry.chain->levels[entry.residentLevel];
+        return std::max(mip.width, mip.height) > residentTailSize;
+    }
+
+    // Samples from the next coarser level and frees the finest one
+    static void EvictLevel(Entry& entry, TextureStreamStats& stats) {
+        auto texture = entry.texture.lock();
+        int level = entry.residentLevel;
+        glBindTexture(GL_TEXTURE_2D, texture->textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+        if (entry.chain->compressedFormat) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, 0, 0, 0, 0, nullptr);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, 0, 0, 0, entry.dataFormat, GL_UNSIGNED_BYTE, nullptr);
+        }
+
+        size_t bytes = entry.chain->LevelBytes(level);
+        entry.residentBytes -= bytes;
+        totalResidentBytes -= bytes;
+        entry.residentLevel = level + 1;
+        AssetRegistry::UpdateSize(texture.get(), AssetType::Texture, entry.residentBytes);
+        ++stats.levelsEvicted;
+    }
+
+    // Uploads the next rows of an entry. Returns false when the ring has no free slot this frame.
+    static bool UploadRows(Entry& entry, TextureStreamStats& stats) {
+        auto texture = entry.texture.lock();
+        if (!texture) {
+            entry.wantedLevel = entry.residentLevel;
+            return true;
+        }
+        if (entry.chain->compressedFormat) return UploadCompressedLevel(entry, *texture, stats);
+
+        int level = entry.residentLevel - 1;
+        const TextureMip& mip = entry.chain->levels[level];
+        size_t rowBytes = static_cast<size_t>(mip.width) * entry.chain->channels;
+        size_t budgetRows = std::max<size_t>(1, (bytesPerFrame - stats.bytes) / rowBytes);
+        size_t rows = std::min<size_t>(mip.height - entry.row, budgetRows);
+        const unsigned char* source = mip.pixels.data() + entry.row * rowBytes;
+
+        glBindTexture(GL_TEXTURE_2D, texture->textureID);
+        if (rowBytes <= ring->SlotSize()) {
+            rows = std::min(rows, ring->SlotSize() / rowBytes);
+            unsigned char* slot = ring->Acquire();
+            if (!slot) return false;
+            if (entry.row == 0) AllocateLevel(entry, level, mip);
+
+            std::memcpy(slot, source, rows * rowBytes);
+            ring->Bind();
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, entry.row, mip.width, static_cast<GLsizei>(rows), entry.dataFormat, GL_UNSIGNED_BYTE, ring->Offset());
+            ring->Commit();
+            PixelUnpackRing::Unbind();
+        } else {
+            // Rows wider than a slot are uploaded straight from client memory
+            if (entry.row == 0) AllocateLevel(entry, level, mip);
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, entry.row, mip.width, static_cast<GLsizei>(rows), entry.dataFormat, GL_UNSIGNED_BYTE, source);
+        }
+        entry.row += static_cast<int>(rows);
+        stats.bytes += rows * rowBytes;
+
+        if (entry.row == mip.height) CompleteLevel(entry, *texture, stats);
+        return true;
+    }
+
+    // Compressed levels are several times smaller, so each goes up whole, from one slot when it fits
+    static bool UploadCompressedLevel(Entry& entry, Texture& texture, TextureStreamStats& stats) {
+        int level = entry.residentLevel - 1;
+        const TextureMip& mip = entry.chain->levels[level];
+        GLsizei size = static_cast<GLsizei>(mip.pixels.size());
+
+        glBindTexture(GL_TEXTURE_2D, texture.textureID);
+        if (mip.pixels.size() <= ring->SlotSize()) {
+            unsigned char* slot = ring->Acquire();
+            if (!slot) return false;
+
+            std::memcpy(slot, mip.pixels.data(), mip.pixels.size());
+            ring->Bind();
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, mip.width, mip.height, 0, size, ring->Offset());
+            ring->Commit();
+            PixelUnpackRing::Unbind();
+        } else {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, mip.width, mip.height, 0, size, mip.pixels.data());
+        }
+        stats.bytes += mip.pixels.size();
+
+        CompleteLevel(entry, texture, stats);
+        return true;
+    }
+
+    // The level is complete: sample from it and move on to the next finer one
+    static void CompleteLevel(Entry& entry, Texture& texture, TextureStreamStats& stats) {
+        int level = entry.residentLevel - 1;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(entry.chain->levels.size()) - 1);
+        size_t bytes = entry.chain->LevelBytes(level);
+        entry.residentBytes += bytes;
+        totalResidentBytes += bytes;
+        AssetRegistry::UpdateSize(&texture, AssetType::Texture, entry.residentBytes);
+        ++stats.levelsCompleted;
+
+        texture.width = entry.chain->levels[0].width;
+        texture.height = entry.chain->levels[0].height;
+        if (level == 0 && texture.useBindless && !texture.textureHandle) texture.makeResident();
+        entry.residentLevel = level;
+        entry.row = 0;
+    }
+
+    static void AllocateLevel(const Entry& entry, int level, const TextureMip& mip) {
+        glTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, mip.width, mip.height, 0, entry.dataFormat, GL_UNSIGNED_BYTE, nullptr);
+    }
+};
+
+size_t TextureStreamer::bytesPerFrame = size_t(4) << 20;
+size_t TextureStreamer::ringSlots = 4;
+size_t TextureStreamer::ringSlotSize = size_t(1) << 20;
+size_t TextureStreamer::residentBudget = size_t(512) << 20;
+int TextureStreamer::residentTailSize = 64;
+float TextureStreamer::mipBias = 0.0f;
+TextureStreamStats TextureStreamer::lastStreamStats;
+
+std::unordered_map<const Texture*, TextureStreamer::Entry> TextureStreamer::entries;
+std::unique_ptr<PixelUnpackRing> TextureStreamer::ring;
+size_t TextureStreamer::totalResidentBytes = 0;
+uint64_t TextureStreamer::frame = 0;
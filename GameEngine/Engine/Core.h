@@ -1,6 +1,9 @@
 #pragma once
 #include "Core/Buffers.h"
+#include "Core/PixelUnpackRing.h"
 #include "Core/VertexArray.h"
 #include "Core/Framebuffer.h"
 #include "Core/Shaders.h"
+#include "Core/TextureData.h"
+#include "Core/MipGenerator.h"
 #include "Core/Texture.h"
\ No newline at end of file
@@ -9,7 +9,7 @@ class Buffer {
 public:
     GLuint ID;
     GLenum type;
-    GLsizeiptr bufferSize;
+    GLsizeiptr bufferSize = 0;
 
     // Constructor
     Buffer(GLenum bufferType) : type(bufferType) {
@@ -26,9 +26,26 @@ public:
         glBindBuffer(bufferType, 0);
     }
 
+    // Update part of the buffer, e.g. one page of a streamed upload
+    void SetSubData(GLintptr offset, const void* data, GLsizeiptr size) const {
+        Bind();
+        glBufferSubData(type, offset, size, data);
+    }
+
+    // Buffers own their GL object, so they are not copied
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    // Destructor: frees the GL buffer
+    ~Buffer() {
+        Delete();
+    }
+
     // Delete buffer
     void Delete() {
         glDeleteBuffers(1, &ID);
+        ID = 0;
+        bufferSize = 0;
     }
 };
 
@@ -83,4 +100,49 @@ public:
     void BindBase(GLuint bindingPoint) const {
         glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ID);
     }
-};
\ No newline at end of file
+};
+
+// Shader Storage Buffer Object (SSBO)
+class ShaderStorageBuffer : public Buffer {
+public:
+    ShaderStorageBuffer() : Buffer(GL_SHADER_STORAGE_BUFFER) {}
+
+    void SetData(const void* data, GLsizeiptr size, GLenum usage) {
+        Bind();
+        bufferSize = size;
+        glBufferData(type, size, data, usage);
+    }
+
+    static void Unbind() {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // Bind to a specific binding point for SSBO
+    void BindBase(GLuint bindingPoint) const {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, ID);
+    }
+};
+// Layout of one command of glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Draw Indirect Buffer, holding DrawElementsIndirectCommand records
+class DrawIndirectBuffer : public Buffer {
+public:
+    DrawIndirectBuffer() : Buffer(GL_DRAW_INDIRECT_BUFFER) {}
+
+    void SetData(const void* data, GLsizeiptr size, GLenum usage) {
+        Bind();
+        bufferSize = size;
+        glBufferData(type, size, data, usage);
+    }
+
+    static void Unbind() {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+};
@@ -0,0 +1,329 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "TextureData.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2 1
+#endif
+
+/**
+ * Downsampling filter used to build mip levels.
+ */
+enum class MipFilter {
+    Box,   // Area average: soft, no ringing
+    Kaiser // Kaiser windowed sinc: sharper, keeps detail in distant mips
+};
+
+/**
+ * How a mip chain is built. Part of the texture cache key, so changing it rebuilds cached chains.
+ */
+struct MipSettings {
+    MipFilter filter = MipFilter::Kaiser;
+    bool srgb = false;        // Color channels are sRGB encoded: filter in linear space and upload as sRGB
+    float alphaCutoff = 0.0f; // Alpha test threshold (0-1) whose coverage every level keeps; 0 disables
+
+    uint64_t Key() const {
+        uint32_t cutoff;
+        std::memcpy(&cutoff, &alphaCutoff, sizeof(cutoff));
+        return static_cast<uint64_t>(filter) | (srgb ? 4u : 0u) | (static_cast<uint64_t>(cutoff) << 32);
+    }
+};
+
+/**
+ * Builds full mip chains on the CPU so textures no longer depend on glGenerateMipmap.
+ * Each level is resampled from the previous one in floating point with a separable filter, the rows of a
+ * level are split across threads and every texel is filtered as four floats with SSE2. The result only
+ * depends on the input and the settings, so it can be cached and gives the same mips on every driver.
+ */
+class MipGenerator {
+public:
+    /**
+     * Builds the mip chain of decoded pixels, level 0 being a copy of the input.
+     * @param settings Filter, color space and alpha coverage options.
+     * @param maxThreads Worker count, 0 uses all hardware threads.
+     */
+    static std::shared_ptr<TextureMipChain> Build(const TextureData& data, const MipSettings& settings = MipSettings(), unsigned maxThreads = 0) {
+        return Build(data.pixels.get(), data.width, data.height, data.channels, settings, maxThreads);
+    }
+
+    /**
+     * Builds the mip chain of 1 to 4 channel, 8-bit pixels, level 0 being a copy of the input.
+     */
+    static std::shared_ptr<TextureMipChain> Build(const unsigned char* pixels, int width, int height, int channels,
+                                                  const MipSettings& settings = MipSettings(), unsigned maxThreads = 0) {
+        auto chain = std::make_shared<TextureMipChain>();
+        chain->channels = channels;
+        chain->srgb = settings.srgb && channels >= 3;
+        if (!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4) return chain;
+
+        TextureMip base;
+        base.width = width;
+        base.height = height;
+        base.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+        chain->levels.push_back(std::move(base));
+
+        Layout layout(channels, chain->srgb);
+        Image current = Expand(chain->levels[0], layout, maxThreads);
+        bool preserveCoverage = settings.alphaCutoff > 0.0f && layout.alpha >= 0;
+        float coverage = preserveCoverage ? Coverage(current, layout.alpha, settings.alphaCutoff, 1.0f) : 0.0f;
+
+        while (current.width > 1 || current.height > 1) {
+            Image next;
+            next.width = std::max(1, current.width / 2);
+            next.height = std::max(1, current.height / 2);
+            next.texels.resize(static_cast<size_t>(next.width) * next.height * 4);
+            Taps horizontal = ComputeTaps(current.width, next.width, settings.filter);
+            Taps vertical = ComputeTaps(current.height, next.height, settings.filter);
+            ForEachRows(next.height, static_cast<size_t>(next.width) * (horizontal.count + vertical.count), maxThreads, [&](int first, int last) {
+                Resample(current, next, horizontal, vertical, first, last);
+            });
+
+            float alphaScale = preserveCoverage ? FindAlphaScale(next, layout.alpha, settings.alphaCutoff, coverage) : 1.0f;
+            TextureMip level;
+            level.width = next.width;
+            level.height = next.height;
+            level.pixels.resize(static_cast<size_t>(next.width) * next.height * channels);
+            ForEachRows(next.height, static_cast<size_t>(next.width), maxThreads, [&](int first, int last) {
+                Quantize(next, layout, alphaScale, level, first, last);
+            });
+            chain->levels.push_back(std::move(level));
+            current = std::move(next);
+        }
+        return chain;
+    }
+
+private:
+    static constexpr float KaiserRadius = 1.5f; // In destination texels, i.e. three source texels each side
+    static constexpr float KaiserAlpha = 4.0f;
+    static constexpr size_t MinTexelsPerThread = 16384;
+
+    // A level being filtered: four floats per texel, linear in [0, 1]
+    struct Image {
+        int width = 0;
+        int height = 0;
+        std::vector<float> texels;
+    };
+
+    // Which of a texel's floats hold color and alpha
+    struct Layout {
+        int channels;
+        int colorChannels; // Converted from and to sRGB when srgb is set
+        int alpha;         // Index of the alpha channel, -1 if there is none
+        bool srgb;
+
+        Layout(int channels, bool srgb)
+            : channels(channels), colorChannels(channels >= 3 ? 3 : 1),
+              alpha(channels == 2 || channels == 4 ? channels - 1 : -1), srgb(srgb) {}
+    };
+
+    // Filter taps of every destination texel along one axis; each has the same count, unused ones weigh 0
+    struct Taps {
+        int count = 0;
+        std::vector<int> first;      // First source texel of each destination texel
+        std::vector<float> weights;  // count weights per destination texel
+    };
+
+    static float Kaiser(float x) {
+        auto besselI0 = [](float v) {
+            float sum = 1.0f, term = 1.0f;
+            for (int k = 1; k < 16; ++k) {
+                term *= (v * 0.5f / k) * (v * 0.5f / k);
+                sum += term;
+            }
+            return sum;
+        };
+        float t = x / KaiserRadius;
+        if (t * t >= 1.0f) return 0.0f;
+        float sinc = x == 0.0f ? 1.0f : std::sin(3.14159265f * x) / (3.14159265f * x);
+        return sinc * besselI0(KaiserAlpha * std::sqrt(1.0f - t * t)) / besselI0(KaiserAlpha);
+    }
+
+    // Polyphase weights; taps beyond the edges are clamped to the edge texel
+    static Taps ComputeTaps(int sourceSize, int destinationSize, MipFilter filter) {
+        float scale = static_cast<float>(sourceSize) / destinationSize;
+        float support = filter == MipFilter::Box ? scale * 0.5f : KaiserRadius * scale;
+
+        Taps taps;
+        taps.count = static_cast<int>(std::ceil(support * 2.0f)) + 1;
+        taps.first.resize(destinationSize);
+        taps.weights.assign(static_cast<size_t>(destinationSize) * taps.count, 0.0f);
+        for (int x = 0; x < destinationSize; ++x) {
+            float center = (x + 0.5f) * scale;
+            int first = static_cast<int>(std::floor(center - support));
+            float total = 0.0f;
+            std::vector<float> weights(taps.count, 0.0f);
+            for (int i = 0; i < taps.count; ++i) {
+                float left = static_cast<float>(first + i);
+                float weight;
+                if (filter == MipFilter::Box) {
+                    weight = std::max(0.0f, std::min(left + 1.0f, center + support) - std::max(left, center - support));
+                } else {
+                    weight = Kaiser((left + 0.5f - center) / scale);
+                }
+                weights[i] = weight;
+                total += weight;
+            }
+
+            // Fold taps outside the image onto the edge so every destination texel has the same tap count
+            int clampedFirst = std::clamp(first, 0, std::max(0, sourceSize - taps.count));
+            taps.first[x] = clampedFirst;
+            float* out = &taps.weights[static_cast<size_t>(x) * taps.count];
+            for (int i = 0; i < taps.count; ++i) {
+                int source = std::clamp(first + i, 0, sourceSize - 1);
+                int slot = std::clamp(source - clampedFirst, 0, taps.count - 1);
+                out[slot] += weights[i] / total;
+            }
+        }
+        return taps;
+    }
+
+    // Destination rows [first, last): a vertical pass into a scratch row, then a horizontal pass
+    static void Resample(const Image& source, Image& destination, const Taps& horizontal, const Taps& vertical, int first, int last) {
+        size_t rowFloats = static_cast<size_t>(source.width) * 4;
+        std::vector<float> row(rowFloats);
+        for (int y = first; y < last; ++y) {
+            std::fill(row.begin(), row.end(), 0.0f);
+            const float* weights = &vertical.weights[static_cast<size_t>(y) * vertical.count];
+            for (int i = 0; i < vertical.count; ++i) {
+                int sourceRow = std::min(vertical.first[y] + i, source.height - 1);
+                if (weights[i] != 0.0f) AddScaled(row.data(), &source.texels[sourceRow * rowFloats], weights[i], rowFloats);
+            }
+
+            float* out = &destination.texels[static_cast<size_t>(y) * destination.width * 4];
+            for (int x = 0; x < destination.width; ++x) {
+                const float* texelWeights = &horizontal.weights[static_cast<size_t>(x) * horizontal.count];
+#ifdef MIP_GENERATOR_SSE2
+                __m128 sum = _mm_setzero_ps();
+                for (int i = 0; i < horizontal.count; ++i) {
+                    int sourceX = std::min(horizontal.first[x] + i, source.width - 1);
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&row[sourceX * 4]), _mm_set1_ps(texelWeights[i])));
+                }
+                _mm_storeu_ps(out + x * 4, sum);
+#else
+                float sum[4] = {};
+                for (int i = 0; i < horizontal.count; ++i) {
+                    int sourceX = std::min(horizontal.first[x] + i, source.width - 1);
+                    for (int c = 0; c < 4; ++c) sum[c] += row[sourceX * 4 + c] * texelWeights[i];
+                }
+                std::memcpy(out + x * 4, sum, sizeof(sum));
+#endif
+            }
+        }
+    }
+
+    // out += in * weight over count floats
+    static void AddScaled(float* out, const float* in, float weight, size_t count) {
+        size_t i = 0;
+#ifdef MIP_GENERATOR_SSE2
+        __m128 w = _mm_set1_ps(weight);
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), w)));
+        }
+#endif
+        for (; i < count; ++i) out[i] += in[i] * weight;
+    }
+
+    static Image Expand(const TextureMip& level, const Layout& layout, unsigned maxThreads) {
+        const float* toLinear = SrgbToLinearTable();
+        Image image;
+        image.width = level.width;
+        image.height = level.height;
+        image.texels.assign(static_cast<size_t>(level.width) * level.height * 4, 0.0f);
+        ForEachRows(level.height, static_cast<size_t>(level.width), maxThreads, [&](int first, int last) {
+            for (size_t i = static_cast<size_t>(first) * level.width; i < static_cast<size_t>(last) * level.width; ++i) {
+                for (int c = 0; c < layout.channels; ++c) {
+                    unsigned char value = level.pixels[i * layout.channels + c];
+                    bool color = layout.srgb && c < layout.colorChannels;
+                    image.texels[i * 4 + c] = color ? toLinear[value] : value / 255.0f;
+                }
+            }
+        });
+        return image;
+    }
+
+    static void Quantize(const Image& image, const Layout& layout, float alphaScale, TextureMip& level, int first, int last) {
+        const unsigned char* toSrgb = LinearToSrgbTable();
+        for (size_t i = static_cast<size_t>(first) * image.width; i < static_cast<size_t>(last) * image.width; ++i) {
+            for (int c = 0; c < layout.channels; ++c) {
+                float value = image.texels[i * 4 + c];
+                if (c == layout.alpha) value *= alphaScale;
+                value = std::clamp(value, 0.0f, 1.0f); // The Kaiser filter's negative lobes can overshoot
+                bool color = layout.srgb && c < layout.colorChannels;
+                level.pixels[i * layout.channels + c] = color ? toSrgb[static_cast<size_t>(value * 65535.0f + 0.5f)]
+                                                              : static_cast<unsigned char>(value * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    // Fraction of texels passing the alpha test once alpha is multiplied by scale
+    static float Coverage(const Image& image, int alpha, float cutoff, float scale) {
+        size_t texels = static_cast<size_t>(image.width) * image.height;
+        size_t covered = 0;
+        for (size_t i = 0; i < texels; ++i) {
+            if (image.texels[i * 4 + alpha] * scale > cutoff) ++covered;
+        }
+        return static_cast<float>(covered) / texels;
+    }
+
+    // Alpha scale giving a level the coverage of level 0, by bisection
+    static float FindAlphaScale(const Image& image, int alpha, float cutoff, float coverage) {
+        float low = 0.0f, high = 4.0f;
+        for (int iteration = 0; iteration < 12; ++iteration) {
+            float middle = (low + high) * 0.5f;
+            if (Coverage(image, alpha, cutoff, middle) < coverage) low = middle;
+            else high = middle;
+        }
+        return (low + high) * 0.5f;
+    }
+
+    static const float* SrgbToLinearTable() {
+        static const std::vector<float> table = []() {
+            std::vector<float> values(256);
+            for (int i = 0; i < 256; ++i) {
+                float s = i / 255.0f;
+                values[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+            }
+            return values;
+        }();
+        return table.data();
+    }
+
+    // Indexed by linear value * 65535; fine enough to round every 8-bit sRGB value correctly
+    static const unsigned char* LinearToSrgbTable() {
+        static const std::vector<unsigned char> table = []() {
+            std::vector<unsigned char> values(65536);
+            for (int i = 0; i < 65536; ++i) {
+                float l = i / 65535.0f;
+                float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                values[i] = static_cast<unsigned char>(std::clamp(s, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+            return values;
+        }();
+        return table.data();
+    }
+
+    // Runs work(first, last) over row ranges on up to maxThreads threads; small images stay on the caller
+    template <typename Work>
+    static void ForEachRows(int rows, size_t workPerRow, unsigned maxThreads, const Work& work) {
+        unsigned threadCount = maxThreads ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+        size_t totalWork = static_cast<size_t>(rows) * std::max<size_t>(1, workPerRow);
+        threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, std::max<size_t>(1, totalWork / MinTexelsPerThread)));
+        threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, static_cast<size_t>(rows)));
+
+        int rowsPerThread = (rows + static_cast<int>(threadCount) - 1) / static_cast<int>(threadCount);
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threadCount; ++t) {
+            int first = static_cast<int>(t) * rowsPerThread;
+            if (first < rows) workers.emplace_back([&work, first, last = std::min(rows, first + rowsPerThread)]() { work(first, last); });
+        }
+        work(0, std::min(rows, rowsPerThread));
+        for (auto& worker : workers) worker.join();
+    }
+};
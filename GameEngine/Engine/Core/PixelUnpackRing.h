@@ -0,0 +1,82 @@
+#pragma once
+#include <glad/glad.h>
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+// Ring of pixel unpack buffer slots for streaming texture uploads.
+// One persistently mapped buffer is split into equal slots. A slot is written by the CPU, consumed by
+// glTexSubImage2D and guarded by a fence, so it is only reused once the GPU has finished reading it.
+// Uploads never wait: when the next slot is still in flight, Acquire returns nullptr and the caller
+// retries on a later frame.
+class PixelUnpackRing {
+public:
+    PixelUnpackRing(size_t slotCount, size_t slotSize) : slotSize(slotSize), fences(slotCount, nullptr) {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ID);
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(slotCount * slotSize), nullptr, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(slotCount * slotSize), flags));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!mapped) {
+            std::cerr << "ERROR: Failed to map pixel unpack buffer" << std::endl;
+        }
+    }
+
+    PixelUnpackRing(const PixelUnpackRing&) = delete;
+    PixelUnpackRing& operator=(const PixelUnpackRing&) = delete;
+
+    ~PixelUnpackRing() {
+        for (GLsync fence : fences) {
+            if (fence) glDeleteSync(fence);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ID);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &ID);
+    }
+
+    size_t SlotSize() const {
+        return slotSize;
+    }
+
+    // Returns the memory of the next slot, or nullptr if the GPU still reads from it
+    unsigned char* Acquire() {
+        if (!mapped) return nullptr;
+        GLsync& fence = fences[current];
+        if (fence) {
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) return nullptr;
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        return mapped + current * slotSize;
+    }
+
+    // Binds the ring as GL_PIXEL_UNPACK_BUFFER; pixel pointers passed to GL are then offsets into it
+    void Bind() const {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ID);
+    }
+
+    static void Unbind() {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // Offset of the acquired slot, to pass as the pixel pointer while the ring is bound
+    const void* Offset() const {
+        return reinterpret_cast<const void*>(static_cast<uintptr_t>(current * slotSize));
+    }
+
+    // Fences the acquired slot after the commands reading it were issued, and moves to the next slot
+    void Commit() {
+        fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        current = (current + 1) % fences.size();
+    }
+
+private:
+    GLuint ID = 0;
+    size_t slotSize;
+    size_t current = 0;
+    unsigned char* mapped = nullptr;
+    std::vector<GLsync> fences;
+};
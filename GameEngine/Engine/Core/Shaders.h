@@ -1,6 +1,7 @@
 #pragma once
 #include <glad/glad.h>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <stdexcept>
 #include <any>
@@ -21,22 +22,49 @@ public:
             throw std::runtime_error("Shader file not found: " + file.getPath());
         }
 
-        std::string shaderCode = file.read();
-        if (shaderCode.empty()) {
+        // Compiled straight from the file's mapping
+        FileView shaderCode = file.view();
+        if (shaderCode.size() == 0) {
             throw std::runtime_error("Failed to read shader file: " + file.getPath());
         }
 
         // Compile the shader
-        CompileShader(shaderCode.c_str());
+        CompileShader(shaderCode.text());
+    }
+
+    // Constructor that compiles source text read earlier (e.g. on a loader thread)
+    Shader(GLenum shaderType, const std::string& shaderCode) : type(shaderType) {
+        if (shaderCode.empty()) {
+            throw std::runtime_error("Shader source is empty.");
+        }
+
+        CompileShader(shaderCode);
     }
 
-    // Method to compile the shader
-    void CompileShader(const char* shaderSource) {
+    // Constructor for a shader compiled later with StartCompile and checked with CheckCompile once the result
+    // is needed, so the driver can compile several shaders in parallel in the meantime
+    explicit Shader(GLenum shaderType) : ID(0), type(shaderType) {}
+
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    // Method to compile the shader; the source needs no terminating null
+    void CompileShader(std::string_view shaderSource) {
+        StartCompile(shaderSource);
+        CheckCompile();
+    }
+
+    // Hands the source to the driver without waiting for the result
+    void StartCompile(std::string_view shaderSource) {
+        const char* source = shaderSource.data();
+        GLint length = static_cast<GLint>(shaderSource.size());
         ID = glCreateShader(type);
-        glShaderSource(ID, 1, &shaderSource, nullptr);
+        glShaderSource(ID, 1, &source, &length);
         glCompileShader(ID);
+    }
 
-        // Check for compilation errors
+    // Waits for the compile if it is still running and throws if it failed
+    void CheckCompile() const {
         GLint success;
         glGetShaderiv(ID, GL_COMPILE_STATUS, &success);
         if (!success) {
@@ -63,6 +91,7 @@ public:
 
     // Constructor that creates a shader program
     ShaderProgram() {
+        SupportsParallelCompile(); // Sets up the driver's compiler threads before the first compile
         ID = glCreateProgram();
     }
 
@@ -73,9 +102,26 @@ public:
 
     // Method to link the shader program
     void LinkProgram() {
+        StartLink();
+        CheckLink();
+    }
+
+    // Issues the link without waiting for it (nor for the compiles of the attached shaders)
+    void StartLink() {
         glLinkProgram(ID);
+    }
 
-        // Check for linking errors
+    // True once the compiles and the link have finished, successfully or not, so CheckLink will not stall.
+    // Without GL_KHR_parallel_shader_compile the driver cannot be asked and this is always true.
+    bool IsLinkComplete() const {
+        if (!SupportsParallelCompile()) return true;
+        GLint complete = GL_TRUE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+        return complete == GL_TRUE;
+    }
+
+    // Waits for the link if it is still running and throws if it failed
+    void CheckLink() const {
         GLint success;
         glGetProgramiv(ID, GL_LINK_STATUS, &success);
         if (!success) {
@@ -89,6 +135,23 @@ public:
         }
     }
 
+    // True if the driver compiles and links on its own threads and can report when it is done.
+    // The first call lets the driver use as many threads as it likes.
+    static bool SupportsParallelCompile() {
+        static const bool supported = []() {
+            if (GLAD_GL_KHR_parallel_shader_compile) {
+                glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+                return true;
+            }
+            if (GLAD_GL_ARB_parallel_shader_compile) {
+                glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+                return true;
+            }
+            return false;
+        }();
+        return supported;
+    }
+
     // Method to use the shader program
     void Use() const {
         glUseProgram(ID);
@@ -122,6 +185,15 @@ public:
         return location;
     }
 
+    // True if the program declares an active uniform of this name; unlike getUniformLocation, never warns
+    bool HasUniform(const std::string& name) {
+        auto found = uniformLocations.find(name);
+        if (found != uniformLocations.end()) return found->second != -1;
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        uniformLocations[name] = location;
+        return location != -1;
+    }
+
     // Set uniform for texture
     void SetUniform(const std::string& name, GLuint textureUnit) {
         GLint location = getUniformLocation(name);
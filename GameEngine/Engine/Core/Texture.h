@@ -1,8 +1,12 @@
 #pragma once
 #include <glad/glad.h>
 #include "../FileSystem/File.h"
+#include "TextureData.h"
+#include "MipGenerator.h"
 #include <stb/stb_image.h>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 class Texture {
 public:
@@ -10,6 +14,8 @@ public:
     GLuint64 textureHandle; // Only used if bindless mode is active.
     const File& textureFile;  // File reference for the texture
     bool useBindless;
+    int width = 0;   // Size of level 0, 0 while only a placeholder is loaded
+    int height = 0;
 
     /**
      * Constructs a Texture object and loads the texture from a file.
@@ -23,13 +29,74 @@ public:
             GLint filterType = GL_LINEAR, GLint repetitionType = GL_REPEAT,
             bool useBindless = false)
         : textureFile(file), useBindless(useBindless) {
-        textureID = loadTexture(textureFile, activeTexture, filterType, repetitionType);
-        if(useBindless) {
-            textureHandle = glGetTextureHandleARB(textureID);
-            glMakeTextureHandleResidentARB(textureHandle);
-        } else {
-            textureHandle = 0; // Not used in traditional mode.
-        }
+        TextureData data;
+        textureID = Decode(textureFile, data) ? upload(*MipGenerator::Build(data), activeTexture, filterType, repetitionType) : 0;
+        makeResident();
+    }
+
+    /**
+     * Constructs a Texture object from pixels decoded earlier (e.g. on a loader thread).
+     * Only the GL upload happens here, so this must run on the thread owning the GL context.
+     * @param file The file the pixels were decoded from.
+     * @param data The decoded pixels.
+     * @param activeTexture The texture unit (default GL_TEXTURE0).
+     * @param filterType The filtering type (GL_LINEAR, GL_NEAREST, etc.).
+     * @param repetitionType The wrapping mode (GL_REPEAT, GL_CLAMP_TO_EDGE, etc.).
+     * @param useBindless Set to true to use bindless textures.
+     */
+    Texture(const File& file, const TextureData& data, GLenum activeTexture = GL_TEXTURE0,
+            GLint filterType = GL_LINEAR, GLint repetitionType = GL_REPEAT,
+            bool useBindless = false)
+        : textureFile(file), useBindless(useBindless) {
+        textureID = data.IsValid() ? upload(*MipGenerator::Build(data), activeTexture, filterType, repetitionType) : 0;
+        makeResident();
+    }
+
+    /**
+     * Constructs a Texture object from a mip chain built earlier (see MipGenerator), uncompressed or block compressed.
+     * Only the GL upload happens here, so this must run on the thread owning the GL context.
+     * @param file The file the chain was built from.
+     * @param chain All levels of the texture, level 0 first.
+     * @param activeTexture The texture unit (default GL_TEXTURE0).
+     * @param filterType The filtering type (GL_LINEAR, GL_NEAREST, etc.).
+     * @param repetitionType The wrapping mode (GL_REPEAT, GL_CLAMP_TO_EDGE, etc.).
+     * @param useBindless Set to true to use bindless textures.
+     */
+    Texture(const File& file, const TextureMipChain& chain, GLenum activeTexture = GL_TEXTURE0,
+            GLint filterType = GL_LINEAR, GLint repetitionType = GL_REPEAT,
+            bool useBindless = false)
+        : textureFile(file), useBindless(useBindless) {
+        textureID = chain.levels.empty() ? 0 : upload(chain, activeTexture, filterType, repetitionType);
+        makeResident();
+    }
+
+    /**
+     * Constructs a Texture object holding a 1x1 placeholder of the given color, usable right away.
+     * The real image is filled in later (see TextureStreamer); bindless handles are created once it is complete.
+     * @param file The file the texture will be streamed from.
+     * @param placeholder RGBA color of the placeholder.
+     * @param activeTexture The texture unit (default GL_TEXTURE0).
+     * @param filterType The filtering type (GL_LINEAR, GL_NEAREST, etc.).
+     * @param repetitionType The wrapping mode (GL_REPEAT, GL_CLAMP_TO_EDGE, etc.).
+     * @param useBindless Set to true to use bindless textures.
+     */
+    Texture(const File& file, const unsigned char placeholder[4], GLenum activeTexture = GL_TEXTURE0,
+            GLint filterType = GL_LINEAR, GLint repetitionType = GL_REPEAT,
+            bool useBindless = false)
+        : textureHandle(0), textureFile(file), useBindless(useBindless) {
+        glGenTextures(1, &textureID);
+        glActiveTexture(activeTexture);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, repetitionType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, repetitionType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     ~Texture() {
@@ -53,20 +120,83 @@ public:
         return textureHandle;
     }
 
-private:
-    GLuint loadTexture(const File& file, GLenum activeTexture, GLint filterType, GLint repetitionType) {
+    /**
+     * Decodes an image file into memory without touching GL state.
+     * @param file The file containing the texture.
+     * @param data Receives the decoded pixels.
+     * @return True on success.
+     */
+    static bool Decode(const File& file, TextureData& data) {
         if (!file.exists()) {
             std::cerr << "Texture file does not exist: " << file.getPath() << std::endl;
-            return 0;
+            return false;
         }
 
-        int width, height, numColorCh;
-        unsigned char* bytes = stbi_load(file.getPath().c_str(), &width, &height, &numColorCh, 0);
-        if (!bytes) {
-            std::cerr << "Failed to load texture: " << file.getPath() << std::endl;
+        FileView encoded = file.view();
+        return encoded.isOpen() && Decode(encoded.data(), encoded.size(), data, file.getPath());
+    }
+
+    /**
+     * Decodes an image file already in memory (e.g. mapped) without touching GL state.
+     * @param bytes The encoded image.
+     * @param size Size of the encoded image in bytes.
+     * @param data Receives the decoded pixels.
+     * @param name Name used in error messages.
+     * @return True on success.
+     */
+    static bool Decode(const void* bytes, size_t size, TextureData& data, const std::string& name) {
+        data.pixels.reset(stbi_load_from_memory(static_cast<const stbi_uc*>(bytes), static_cast<int>(size),
+                                                &data.width, &data.height, &data.channels, 0));
+        if (!data.pixels) {
+            std::cerr << "Failed to load texture: " << name << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Maps a channel count to the internal and pixel data formats used for uploads.
+     * @param srgb Use the sRGB internal format for 3 and 4 channel pixels.
+     * @return False for unsupported channel counts.
+     */
+    static bool GetFormats(int channels, GLenum& internalFormat, GLenum& dataFormat, bool srgb = false) {
+        switch (channels) {
+            case 1:
+                internalFormat = GL_RED;
+                dataFormat = GL_RED;
+                return true;
+            case 3:
+                internalFormat = srgb ? GL_SRGB8 : GL_RGB;
+                dataFormat = GL_RGB;
+                return true;
+            case 4:
+                internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA;
+                dataFormat = GL_RGBA;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+private:
+    friend class TextureStreamer;
+
+    void makeResident() {
+        if(useBindless) {
+            textureHandle = glGetTextureHandleARB(textureID);
+            glMakeTextureHandleResidentARB(textureHandle);
+        } else {
+            textureHandle = 0; // Not used in traditional mode.
+        }
+    }
+
+    GLuint upload(const TextureMipChain& chain, GLenum activeTexture, GLint filterType, GLint repetitionType) {
+        GLenum internalFormat = chain.compressedFormat;
+        GLenum dataFormat = GL_RGBA;
+        if (!internalFormat && !GetFormats(chain.channels, internalFormat, dataFormat, chain.srgb)) {
+            std::cerr << "Unsupported number of color channels: " << chain.channels << std::endl;
             return 0;
         }
-        std::cout << "Texture loaded at address: " << static_cast<void*>(bytes) << "\n";
 
         GLuint texture;
         glGenTextures(1, &texture);
@@ -77,32 +207,27 @@ private:
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filterType);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, repetitionType);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, repetitionType);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(chain.levels.size()) - 1);
 
-        GLenum internalFormat, dataFormat;
-        switch (numColorCh) {
-            case 1:
-                internalFormat = GL_RED;
-                dataFormat = GL_RED;
-                break;
-            case 3:
-                internalFormat = GL_RGB;
-                dataFormat = GL_RGB;
-                break;
-            case 4:
-                internalFormat = GL_RGBA;
-                dataFormat = GL_RGBA;
-                break;
-            default:
-                std::cerr << "Unsupported number of color channels: " << numColorCh << std::endl;
-                stbi_image_free(bytes);
-                return 0;
+        // The mips come from the CPU, so they are identical on every driver; rows of small levels are not 4-byte aligned
+        GLint previousAlignment;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &previousAlignment);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t level = 0; level < chain.levels.size(); ++level) {
+            const TextureMip& mip = chain.levels[level];
+            if (chain.compressedFormat) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, mip.width, mip.height, 0,
+                                       static_cast<GLsizei>(mip.pixels.size()), mip.pixels.data());
+            } else {
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, mip.width, mip.height, 0, dataFormat, GL_UNSIGNED_BYTE, mip.pixels.data());
+            }
         }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, previousAlignment);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, bytes);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        stbi_image_free(bytes);
         glBindTexture(GL_TEXTURE_2D, 0);
+        width = chain.levels[0].width;
+        height = chain.levels[0].height;
 
         std::cout << "Loaded texture ID: " << texture << std::endl;
         return texture;
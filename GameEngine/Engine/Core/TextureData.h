@@ -0,0 +1,41 @@
+#pragma once
+#include <glad/glad.h>
+#include <stb/stb_image.h>
+#include <memory>
+#include <vector>
+
+/**
+ * Pixels decoded from an image file, ready to be uploaded by a Texture.
+ * Decoding touches no GL state, so it may run on any thread.
+ */
+struct TextureData {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels{nullptr, stbi_image_free};
+
+    bool IsValid() const { return pixels != nullptr; }
+};
+
+/**
+ * One level of a texture's mip chain in memory: pixels, or blocks for a compressed format.
+ */
+struct TextureMip {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+};
+
+/**
+ * A full mip chain in memory, level 0 first, ready to be streamed into a Texture.
+ */
+struct TextureMipChain {
+    int channels = 0;
+    GLenum compressedFormat = 0; // e.g. GL_COMPRESSED_RG_RGTC2; 0 for uncompressed pixels
+    bool srgb = false;           // Color channels are sRGB encoded
+    std::vector<TextureMip> levels;
+
+    size_t LevelBytes(size_t level) const {
+        return levels[level].pixels.size();
+    }
+};
@@ -11,6 +11,12 @@ public:
     static VertexFormat PositionUv;
     static VertexFormat PositionUvNormal;
 
+    // Compact 16 byte encodings of PositionUvNormal (see MeshQuantizer).
+    // Positions are dequantized with Mesh::positionScale/positionOffset, UVs are half floats
+    // and normals are octahedral encoded in the x/y fields of a 2_10_10_10 value.
+    static VertexFormat PositionUvNormalQuantized;
+    static VertexFormat PositionUvNormalHalf;
+
     struct Attribute {
         GLuint count;
         GLenum type;
@@ -131,4 +137,16 @@ VertexFormat VertexFormat::PositionUvNormal = FormatBuilder()
                                             .AddAttribute(3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0)
                                             .AddAttribute(2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)))
                                             .AddAttribute(3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(5*sizeof(float)))
+                                            .Build();
+
+VertexFormat VertexFormat::PositionUvNormalQuantized = FormatBuilder()
+                                            .AddAttribute(4, GL_SHORT, GL_TRUE, 16, (void*)0)
+                                            .AddAttribute(2, GL_HALF_FLOAT, GL_FALSE, 16, (void*)8)
+                                            .AddAttribute(4, GL_INT_2_10_10_10_REV, GL_TRUE, 16, (void*)12)
+                                            .Build();
+
+VertexFormat VertexFormat::PositionUvNormalHalf = FormatBuilder()
+                                            .AddAttribute(4, GL_HALF_FLOAT, GL_FALSE, 16, (void*)0)
+                                            .AddAttribute(2, GL_HALF_FLOAT, GL_FALSE, 16, (void*)8)
+                                            .AddAttribute(4, GL_INT_2_10_10_10_REV, GL_TRUE, 16, (void*)12)
                                             .Build();
\ No newline at end of file
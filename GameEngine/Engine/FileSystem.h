@@ -1,3 +1,17 @@
 #pragma once
+#include "FileSystem/MappedFile.h"
+#include "FileSystem/Hash.h"
+#include "FileSystem/Lz4.h"
+#include "FileSystem/PakArchive.h"
 #include "FileSystem/File.h"
+#include "FileSystem/AsyncFileReader.h"
+#include "FileSystem/FileWatcher.h"
+#include "FileSystem/ObjParser.h"
+#include "FileSystem/MeshCache.h"
+#include "FileSystem/TextureCache.h"
+#include "FileSystem/ProgramCache.h"
+#include "FileSystem/ShaderPreprocessor.h"
+#include "FileSystem/StreamingMeshImporter.h"
+#include "FileSystem/Json.h"
+#include "FileSystem/GltfLoader.h"
 #include "FileSystem/MeshLoader.h"
\ No newline at end of file
@@ -0,0 +1,519 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "File.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ASYNC_FILE_READER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/// <summary>
+/// Order in which queued reads are issued; reads of the same priority are issued first come, first served.
+/// </summary>
+enum class IoPriority {
+    Critical,   // Needed before the next frame, e.g. shaders
+    High,
+    Normal,
+    Background  // Prefetching
+};
+
+/// <summary>
+/// Totals since the reader started.
+/// </summary>
+struct FileReadStats {
+    size_t files = 0;          // Reads completed, successful or not
+    size_t bytes = 0;
+    size_t requests = 0;       // Individual read requests issued to the kernel
+    size_t maxInFlight = 0;    // Highest number of read requests outstanding at once
+    bool ioUring = false;      // False while the thread pool fallback is in use
+};
+
+/// <summary>
+/// Reads whole files in the background and hands their bytes to a callback, so a level load keeps the storage
+/// device's queue full instead of reading files one after another.
+/// On Linux, reads are submitted in batches through io_uring from one thread: files are split into chunks of
+/// ChunkSize bytes and up to queueDepth chunks of any number of files are in flight at once. Elsewhere, or when
+/// io_uring is unavailable (old kernels, seccomp), fallbackThreads threads read files with blocking reads.
+/// Queued reads are issued by IoPriority. Files in mounted archives and files of mapThreshold bytes or more
+/// are handed over as a mapped File::view() instead of being read into memory.
+/// </summary>
+class AsyncFileReader {
+public:
+    /// <summary>
+    /// Receives the file's bytes; contents.isOpen() is false if the file could not be read.
+    /// Runs on the I/O thread, so it should only hand the bytes on, e.g. to a decode worker.
+    /// </summary>
+    using Callback = std::function<void(const File& file, FileView contents)>;
+
+    /// Read requests in flight at once with io_uring. Read when the reader starts.
+    static unsigned queueDepth;
+
+    /// Threads of the fallback pool. Read when the reader starts.
+    static unsigned fallbackThreads;
+
+    /// Files at least this large are mapped rather than read, e.g. meshes too big to hold in memory at once.
+    static size_t mapThreshold;
+
+    /// Set to false before the first read to always use the thread pool.
+    static bool useIoUring;
+
+    /// <summary>
+    /// Queues a read of a whole file. The reader starts on first use. Thread safe.
+    /// </summary>
+    static void Read(const File& file, IoPriority priority, Callback callback) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!started) Start();
+            queue.push(Request{ &file, priority, nextSequence++, std::move(callback) });
+        }
+        Wake();
+    }
+
+    static FileReadStats GetStats() {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        return stats;
+    }
+
+    /// <summary>
+    /// Waits for reads in flight and stops the reader. Queued reads that have not started are dropped without
+    /// calling their callbacks. The reader starts again on the next Read.
+    /// </summary>
+    static void Shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!started) return;
+            stopping = true;
+            queue = {};
+        }
+        Wake();
+        for (auto& thread : threads) thread.join();
+        threads.clear();
+#ifdef ASYNC_FILE_READER_IO_URING
+        ring.Close();
+        if (doorbell >= 0) close(doorbell);
+        doorbell = -1;
+#endif
+        std::lock_guard<std::mutex> lock(queueMutex);
+        started = false;
+        stopping = false;
+    }
+
+private:
+    static constexpr size_t ChunkSize = 512 * 1024;
+
+    struct Request {
+        const File* file;
+        IoPriority priority;
+        uint64_t sequence;
+        Callback callback;
+    };
+
+    // Highest priority, then oldest, on top
+    struct Later {
+        bool operator()(const Request& a, const Request& b) const {
+            if (a.priority != b.priority) return a.priority > b.priority;
+            return a.sequence > b.sequence;
+        }
+    };
+
+    static std::priority_queue<Request, std::vector<Request>, Later> queue;
+    static std::mutex queueMutex;
+    static std::condition_variable queueReady;
+    static std::vector<std::thread> threads;
+    static uint64_t nextSequence;
+    static bool started;
+    static bool stopping;
+
+    static FileReadStats stats;
+    static std::mutex statsMutex;
+
+    // Joins the I/O threads at exit if Shutdown was not called
+    struct Stopper {
+        ~Stopper() { Shutdown(); }
+    };
+    static Stopper stopper;
+
+    // Called with queueMutex held
+    static void Start() {
+        started = true;
+        bool ioUring = false;
+#ifdef ASYNC_FILE_READER_IO_URING
+        if (useIoUring && StartRing()) {
+            ioUring = true;
+            threads.emplace_back(RunRing);
+        }
+#endif
+        if (!ioUring) {
+            for (unsigned i = 0; i < std::max(1u, fallbackThreads); ++i) threads.emplace_back(RunFallback);
+        }
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.ioUring = ioUring;
+    }
+
+    static void Wake() {
+#ifdef ASYNC_FILE_READER_IO_URING
+        if (doorbell >= 0) {
+            uint64_t one = 1;
+            ssize_t written = write(doorbell, &one, sizeof(one));
+            (void)written; // A full counter already means a wakeup is pending
+            return;
+        }
+#endif
+        queueReady.notify_all();
+    }
+
+    // Files the I/O backend does not read itself: archive entries and very large files
+    static bool ReadsDirectly(const File& file, size_t size) {
+        return file.isArchived() || size >= mapThreshold;
+    }
+
+    static void Complete(Request& request, FileView contents) {
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            ++stats.files;
+            stats.bytes += contents.size();
+        }
+        if (!contents.isOpen()) std::cerr << "ERROR: Unable to read file: " << request.file->getPath() << std::endl;
+        request.callback(*request.file, std::move(contents));
+    }
+
+    static void RunFallback() {
+        while (true) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueReady.wait(lock, []() { return stopping || !queue.empty(); });
+                if (stopping) return;
+                request = std::move(const_cast<Request&>(queue.top()));
+                queue.pop();
+            }
+
+            std::error_code error;
+            size_t size = request.file->isArchived() ? 0 : static_cast<size_t>(std::filesystem::file_size(request.file->getPath(), error));
+            if (error || ReadsDirectly(*request.file, size)) {
+                Complete(request, error ? FileView() : request.file->view());
+                continue;
+            }
+
+            auto buffer = std::make_shared<std::string>(size, '\0');
+            std::ifstream in(request.file->getPath(), std::ios::binary);
+            bool read = in && in.read(buffer->data(), static_cast<std::streamsize>(size)) && in.gcount() == static_cast<std::streamsize>(size);
+            {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                ++stats.requests;
+                stats.maxInFlight = std::max<size_t>(stats.maxInFlight, 1);
+            }
+            Complete(request, read ? FileView::FromMemory(std::move(buffer)) : FileView());
+        }
+    }
+
+#ifdef ASYNC_FILE_READER_IO_URING
+    // Submission and completion rings shared with the kernel (see io_uring_setup(2))
+    struct Ring {
+        int fd = -1;
+        void* sqMemory = nullptr;
+        void* cqMemory = nullptr;
+        size_t sqMemorySize = 0;
+        size_t cqMemorySize = 0;
+        io_uring_sqe* sqes = nullptr;
+        size_t sqesSize = 0;
+        unsigned* sqHead = nullptr;
+        unsigned* sqTail = nullptr;
+        unsigned* sqMask = nullptr;
+        unsigned* sqArray = nullptr;
+        unsigned* cqHead = nullptr;
+        unsigned* cqTail = nullptr;
+        unsigned* cqMask = nullptr;
+        io_uring_cqe* cqes = nullptr;
+        unsigned entries = 0;
+        unsigned unsubmitted = 0;
+
+        bool Open(unsigned requested) {
+            io_uring_params params{};
+            fd = static_cast<int>(syscall(__NR_io_uring_setup, requested, &params));
+            if (fd < 0) return false;
+
+            entries = params.sq_entries;
+            sqMemorySize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single) sqMemorySize = cqMemorySize = std::max(sqMemorySize, cqMemorySize);
+
+            sqMemory = mmap(nullptr, sqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sqMemory == MAP_FAILED) sqMemory = nullptr;
+            cqMemory = single ? sqMemory
+                              : mmap(nullptr, cqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqMemory == MAP_FAILED) cqMemory = nullptr;
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqeMemory = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            sqes = sqeMemory == MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(sqeMemory);
+            if (!sqMemory || !cqMemory || !sqes) {
+                Close();
+                return false;
+            }
+
+            char* sq = static_cast<char*>(sqMemory);
+            sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            char* cq = static_cast<char*>(cqMemory);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        void Close() {
+            if (sqes) munmap(sqes, sqesSize);
+            if (cqMemory && cqMemory != sqMemory) munmap(cqMemory, cqMemorySize);
+            if (sqMemory) munmap(sqMemory, sqMemorySize);
+            if (fd >= 0) close(fd);
+            sqes = nullptr;
+            sqMemory = cqMemory = nullptr;
+            fd = -1;
+        }
+
+        // Queues a read; it reaches the kernel with the next Enter
+        void PrepareRead(int file, void* buffer, unsigned length, uint64_t offset, uint64_t userData) {
+            unsigned tail = *sqTail;
+            unsigned index = tail & *sqMask;
+            io_uring_sqe& sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = file;
+            sqe.addr = reinterpret_cast<uint64_t>(buffer);
+            sqe.len = length;
+            sqe.off = offset;
+            sqe.user_data = userData;
+            sqArray[index] = index;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+            ++unsubmitted;
+        }
+
+        // Submits the queued reads and waits for at least one completion
+        bool Enter() {
+            while (true) {
+                long submitted = syscall(__NR_io_uring_enter, fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (submitted >= 0) {
+                    unsubmitted -= static_cast<unsigned>(submitted);
+                    return true;
+                }
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+            }
+        }
+
+        // Calls handle(cqe) for every completion that has arrived
+        template <typename Handle>
+        void Reap(const Handle& handle) {
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) handle(cqes[head & *cqMask]);
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+    };
+
+    // A file being read: its chunks complete in any order
+    struct ActiveRead {
+        Request request;
+        int fd = -1;
+        std::shared_ptr<std::string> buffer;
+        size_t nextOffset = 0;    // First byte not yet requested
+        size_t chunksInFlight = 0;
+        bool failed = false;
+    };
+
+    struct Chunk {
+        ActiveRead* read;
+        size_t offset;
+        size_t length;
+    };
+
+    static constexpr uint64_t DoorbellTag = 0; // Chunks are tagged with their address instead
+
+    static Ring ring;
+    static int doorbell;
+
+    static bool StartRing() {
+        if (!ring.Open(std::max(2u, queueDepth + 1))) {
+            std::cerr << "WARNING: io_uring is unavailable, reading files on a thread pool" << std::endl;
+            return false;
+        }
+        doorbell = eventfd(0, EFD_CLOEXEC);
+        if (doorbell < 0) {
+            ring.Close();
+            return false;
+        }
+        return true;
+    }
+
+    static void RunRing() {
+        std::vector<std::unique_ptr<ActiveRead>> active;
+        uint64_t doorbellValue = 0;
+        size_t inFlight = 0; // Chunks, not counting the doorbell
+        size_t depth = std::max(1u, std::min(queueDepth, ring.entries - 1));
+        ring.PrepareRead(doorbell, &doorbellValue, sizeof(doorbellValue), 0, DoorbellTag);
+
+        while (true) {
+            // Keep the queue full: more chunks of files being read, then the next files by priority.
+            // Files already started are finished when stopping; Shutdown has emptied the queue.
+            std::vector<Request> direct;
+            bool stop;
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                stop = stopping;
+                while (inFlight < depth) {
+                    ActiveRead* next = nullptr;
+                    for (auto& read : active) {
+                        if (!read->failed && read->nextOffset < read->buffer->size()) {
+                            next = read.get();
+                            break;
+                        }
+                    }
+                    if (!next) {
+                        if (queue.empty()) break;
+                        Request request = std::move(const_cast<Request&>(queue.top()));
+                        queue.pop();
+                        next = Open(std::move(request), direct);
+                        if (!next) continue;
+                        active.emplace_back(next);
+                    }
+
+                    size_t length = std::min(ChunkSize, next->buffer->size() - next->nextOffset);
+                    Chunk* chunk = new Chunk{ next, next->nextOffset, length };
+                    next->nextOffset += length;
+                    ++next->chunksInFlight;
+                    SubmitChunk(*chunk);
+                    ++inFlight;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                stats.maxInFlight = std::max(stats.maxInFlight, inFlight);
+            }
+            for (Request& request : direct) {
+                FileView contents = request.file->view();
+                Complete(request, std::move(contents));
+            }
+            if (stop && inFlight == 0) return;
+
+            if (!ring.Enter()) {
+                std::cerr << "ERROR: io_uring_enter failed" << std::endl;
+                return;
+            }
+
+            ring.Reap([&](const io_uring_cqe& cqe) {
+                if (cqe.user_data == DoorbellTag) {
+                    ring.PrepareRead(doorbell, &doorbellValue, sizeof(doorbellValue), 0, DoorbellTag);
+                    return;
+                }
+
+                Chunk* chunk = reinterpret_cast<Chunk*>(cqe.user_data);
+                ActiveRead& read = *chunk->read;
+                if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                    SubmitChunk(*chunk);
+                    return;
+                }
+                if (cqe.res <= 0) {
+                    read.failed = true; // An error, or the file shrank while it was read
+                } else if (static_cast<size_t>(cqe.res) < chunk->length) {
+                    chunk->offset += static_cast<size_t>(cqe.res);
+                    chunk->length -= static_cast<size_t>(cqe.res);
+                    SubmitChunk(*chunk);
+                    return;
+                }
+                delete chunk;
+                --inFlight;
+                --read.chunksInFlight;
+            });
+
+            // Finished files leave the ring before their callbacks run
+            for (auto it = active.begin(); it != active.end();) {
+                ActiveRead& read = **it;
+                bool done = read.chunksInFlight == 0 && (read.failed || read.nextOffset == read.buffer->size());
+                if (!done) {
+                    ++it;
+                    continue;
+                }
+                close(read.fd);
+                Complete(read.request, read.failed ? FileView() : FileView::FromMemory(std::move(read.buffer)));
+                it = active.erase(it);
+            }
+        }
+    }
+
+    // Opens a queued file. Returns nullptr for files completed another way, which are added to direct.
+    static ActiveRead* Open(Request request, std::vector<Request>& direct) {
+        if (request.file->isArchived()) {
+            direct.push_back(std::move(request));
+            return nullptr;
+        }
+
+        int fd = open(request.file->getPath().c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info {};
+        if (fd < 0 || fstat(fd, &info) != 0 || ReadsDirectly(*request.file, static_cast<size_t>(info.st_size)) || info.st_size == 0) {
+            if (fd >= 0) close(fd);
+            // Empty files complete right away with an empty view, failed opens with an error
+            direct.push_back(std::move(request));
+            return nullptr;
+        }
+
+        auto* read = new ActiveRead();
+        read->request = std::move(request);
+        read->fd = fd;
+        read->buffer = std::make_shared<std::string>(static_cast<size_t>(info.st_size), '\0');
+        return read;
+    }
+
+    static void SubmitChunk(Chunk& chunk) {
+        ring.PrepareRead(chunk.read->fd, chunk.read->buffer->data() + chunk.offset, static_cast<unsigned>(chunk.length),
+                         chunk.offset, reinterpret_cast<uint64_t>(&chunk));
+        std::lock_guard<std::mutex> lock(statsMutex);
+        ++stats.requests;
+    }
+#endif
+};
+
+unsigned AsyncFileReader::queueDepth = 64;
+unsigned AsyncFileReader::fallbackThreads = 4;
+size_t AsyncFileReader::mapThreshold = size_t(64) << 20;
+bool AsyncFileReader::useIoUring = true;
+
+std::priority_queue<AsyncFileReader::Request, std::vector<AsyncFileReader::Request>, AsyncFileReader::Later> AsyncFileReader::queue;
+std::mutex AsyncFileReader::queueMutex;
+std::condition_variable AsyncFileReader::queueReady;
+std::vector<std::thread> AsyncFileReader::threads;
+uint64_t AsyncFileReader::nextSequence = 0;
+bool AsyncFileReader::started = false;
+bool AsyncFileReader::stopping = false;
+FileReadStats AsyncFileReader::stats;
+std::mutex AsyncFileReader::statsMutex;
+
+#ifdef ASYNC_FILE_READER_IO_URING
+AsyncFileReader::Ring AsyncFileReader::ring;
+int AsyncFileReader::doorbell = -1;
+#endif
+
+// Defined last so the I/O threads are joined before the state they use is destroyed
+AsyncFileReader::Stopper AsyncFileReader::stopper;
@@ -1,12 +1,91 @@
 #pragma once
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
+#include <span>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <filesystem>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <cstdio>
+#include "MappedFile.h"
+#include "PakArchive.h"
+
+/**
+ * @class FileView
+ * @brief Read-only view of a file's bytes, returned by File::view().
+ *
+ * Loose files and raw archive entries are viewed straight in their mapping; compressed archive
+ * entries are decompressed once into memory the view owns. Copies of a view share the bytes,
+ * which stay valid as long as any copy exists.
+ */
+class FileView {
+public:
+    /** @brief True if the file could be opened (possibly with zero length). */
+    bool isOpen() const { return opened; }
+
+    /** @brief Start of the bytes; may be nullptr for empty files. */
+    const char* data() const { return begin; }
+
+    /** @brief Number of bytes. */
+    size_t size() const { return length; }
+
+    /** @brief The bytes as text, e.g. for parsers. */
+    std::string_view text() const { return std::string_view(begin, length); }
+
+    /** @brief The bytes as a span. */
+    std::span<const std::byte> bytes() const { return std::span<const std::byte>(reinterpret_cast<const std::byte*>(begin), length); }
+
+    /**
+     * @brief The mapping the bytes live in, to keep them alive past the view (e.g. in a Mesh).
+     *
+     * @return The mapping, or nullptr if the bytes were decompressed into memory.
+     */
+    const std::shared_ptr<const MappedFile>& getMapping() const { return mapping; }
+
+    /**
+     * @brief Drops resident pages of a range of the view once it has been consumed; see MappedFile::evict.
+     *
+     * @param offset First byte of the range, relative to data().
+     * @param count Number of bytes.
+     */
+    void evict(size_t offset, size_t count) const {
+        if (mapping) mapping->evict(static_cast<size_t>(begin - mapping->data()) + offset, count);
+    }
+
+    /**
+     * @brief Views bytes that were already read into memory, e.g. by AsyncFileReader.
+     *
+     * @param contents The bytes; the view shares ownership of them.
+     * @return An open view of contents.
+     */
+    static FileView FromMemory(std::shared_ptr<const std::string> contents) {
+        FileView result;
+        result.begin = contents->data();
+        result.length = contents->size();
+        result.buffer = std::move(contents);
+        result.opened = true;
+        return result;
+    }
+
+private:
+    friend class File;
+
+    std::shared_ptr<const MappedFile> mapping;
+    std::shared_ptr<const std::string> buffer;
+    const char* begin = nullptr;
+    size_t length = 0;
+    bool opened = false;
+};
 
 /**
  * @class File
  * @brief Handles file operations
+ *
+ * Files are looked up in the mounted PakArchives first and on disk otherwise.
  */
 class File {
 public:
@@ -16,21 +95,54 @@ public:
     /**
      * @brief Reads the entire content of the file.
      *
-     * This function opens the file, reads its content into a string, and returns it.
+     * This function copies the file's bytes out of its mapping into a string and returns it.
+     * Prefer view() for parsing, which makes no copy.
      * In case of an error (e.g., file not found), an empty string is returned.
      *
      * @return A string containing the contents of the file.
      */
     std::string read() const {
-        std::ifstream file(filePath);
-        if (!file) {
+        if (archiveEntry) return archive->read(*archiveEntry);
+
+        FileView contents = view();
+        if (!contents.isOpen()) {
             std::cerr << "ERROR: Unable to open file: " << filePath << std::endl;
             return "";
         }
+        return std::string(contents.text());
+    }
 
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return buffer.str();
+    /**
+     * @brief Maps the file and returns a read-only view of its bytes, without copying them.
+     *
+     * @param access How the caller will read the bytes, passed to the kernel as a read-ahead hint.
+     * @return The view; check isOpen() for errors.
+     */
+    FileView view(MappedFile::Access access = MappedFile::Access::Sequential) const {
+        FileView result;
+        if (archiveEntry && PakArchive::IsCompressed(*archiveEntry)) {
+            auto contents = std::make_shared<std::string>(archive->read(*archiveEntry));
+            if (contents->size() != archiveEntry->size) return result;
+            result.begin = contents->data();
+            result.length = contents->size();
+            result.buffer = std::move(contents);
+        } else if (archiveEntry) {
+            // Shares the archive's ownership, so the view keeps the whole archive mapped
+            result.mapping = std::shared_ptr<const MappedFile>(archive, &archive->getMapping());
+            std::string_view raw = archive->getRawView(*archiveEntry);
+            result.begin = raw.data();
+            result.length = raw.size();
+            result.mapping->advise(access, archiveEntry->offset, archiveEntry->size);
+        } else {
+            auto mapping = std::make_shared<MappedFile>(filePath);
+            if (!mapping->isOpen()) return result;
+            mapping->advise(access);
+            result.begin = mapping->data();
+            result.length = mapping->size();
+            result.mapping = std::move(mapping);
+        }
+        result.opened = true;
+        return result;
     }
 
     /**
@@ -39,8 +151,15 @@ public:
      * @return True if the file exists, false otherwise.
      */
     bool exists() const {
-        std::ifstream file(filePath);
-        return file.good();
+        return archiveEntry || isRegularFile(filePath);
+    }
+
+    /**
+     * @brief Checks if a regular file exists at a path with a single stat call, without opening it.
+     */
+    static bool isRegularFile(const std::string& path) {
+        std::error_code error;
+        return std::filesystem::is_regular_file(path, error);
     }
 
     /**
@@ -53,22 +172,72 @@ public:
     }
 
     /**
-     * @brief Static method to create a File object if the file exists at the specified path.
+     * @brief Checks if the file was resolved from a mounted archive rather than from disk.
+     */
+    bool isArchived() const {
+        return archiveEntry != nullptr;
+    }
+
+    /**
+     * @brief Returns the canonical form of a path, so different spellings of one file compare equal.
+     *
+     * Falls back to the path as given if it cannot be resolved.
+     *
+     * @param path The path to normalize.
+     * @return The absolute, normalized path with forward slashes.
+     */
+    static std::string canonicalPath(const std::string& path) {
+        std::error_code error;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        return error ? path : canonical.generic_string();
+    }
+
+    /**
+     * @brief Returns a unique temporary name next to a file about to be written and renamed into place.
+     *
+     * Cache files of one source may be written by several threads at once (e.g. cooks with different settings);
+     * each writer gets its own temporary file, so none renames another's half written one.
+     *
+     * @param path The path the file is renamed to once written.
+     * @return The path with the writing thread and a counter appended.
+     */
+    static std::string tempPath(const std::string& path) {
+        static std::atomic<uint32_t> counter{0};
+        char tag[32];
+        std::snprintf(tag, sizeof(tag), ".%08x.%u.tmp",
+                      static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())), counter++);
+        return path + tag;
+    }
+
+    /**
+     * @brief Static method to get the File object of the file at the specified path.
      *
      * This method checks if the file exists at the given path and returns a File object if valid.
-     * If the file does not exist, it returns a nullptr.
+     * The mounted archives are searched before the filesystem; which one a file comes from is decided
+     * the first time it is found. File objects are shared: every path resolving to the same canonical path returns the same object,
+     * which stays owned by File and lives until the program exits. Callers must not delete it.
+     * If the file does not exist, it returns a nullptr. This method is thread safe.
      *
      * @param path The file path to check and associate with the File object.
-     * @return A pointer to a File object if the file exists, nullptr otherwise.
+     * @return A pointer to the File object if the file exists, nullptr otherwise.
      */
     static File* find(const std::string& path) {
-        std::ifstream file(path);
-        if (file.good()) {
-            return new File(path); // File exists, return a new File object
-        } else {
+        std::shared_ptr<const PakArchive> archive;
+        const PakArchive::Entry* archiveEntry = PakArchive::FindMounted(path, archive);
+        if (!archiveEntry && !isRegularFile(path)) {
             std::cerr << "ERROR: File not found at: " << path << std::endl;
             return nullptr; // File does not exist
         }
+
+        std::string key = canonicalPath(path);
+        std::lock_guard<std::mutex> lock(registryMutex);
+        std::unique_ptr<File>& entry = registry[key];
+        if (!entry) {
+            entry.reset(new File(path)); // First lookup of this file
+            entry->archive = std::move(archive);
+            entry->archiveEntry = archiveEntry;
+        }
+        return entry.get();
     }
 
 private:
@@ -81,5 +250,14 @@ private:
      */
     File(const std::string &path) : filePath(path) {}
 
-    // No additional private members are necessary for this simple class
+    /** @brief The archive the file was resolved from, which keeps archiveEntry valid; null for loose files. */
+    std::shared_ptr<const PakArchive> archive;
+    const PakArchive::Entry* archiveEntry = nullptr;
+
+    /** @brief File objects handed out by find, keyed by canonical path. */
+    static std::unordered_map<std::string, std::unique_ptr<File>> registry;
+    static std::mutex registryMutex;
 };
+
+std::unordered_map<std::string, std::unique_ptr<File>> File::registry;
+std::mutex File::registryMutex;
@@ -0,0 +1,146 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include "File.h"
+
+#if defined(__linux__) && __has_include(<sys/inotify.h>)
+#define FILE_WATCHER_INOTIFY
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+/**
+ * @class FileWatcher
+ * @brief Reports loose files that changed on disk, e.g. for hot reloading assets.
+ *
+ * On Linux the directories of watched files are watched with inotify, and a file counts as changed once it
+ * was closed after writing or renamed into place, so editors that save through a temporary file are seen
+ * too and half written files are not. Elsewhere, or if inotify is unavailable, the modification times of
+ * the watched files are compared every pollIntervalMs. Files in mounted archives cannot be watched.
+ */
+class FileWatcher {
+public:
+    /** @brief Interval of the modification time fallback. */
+    static double pollIntervalMs;
+
+    /**
+     * @brief Starts watching a file. Watching a file twice has no effect. Thread safe.
+     *
+     * @param path Path of an existing loose file.
+     * @return False if the file cannot be watched.
+     */
+    static bool Watch(const std::string& path) {
+        std::string canonical = File::canonicalPath(path);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (watched.count(canonical)) return true;
+
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(canonical, error);
+        if (error) {
+            std::cerr << "ERROR: Cannot watch file: " << path << std::endl;
+            return false;
+        }
+        watched[canonical] = modified;
+
+#ifdef FILE_WATCHER_INOTIFY
+        if (inotifyFd == -1) {
+            inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (inotifyFd < 0) {
+                std::cerr << "WARNING: inotify is unavailable, polling file modification times" << std::endl;
+                inotifyFd = -2; // Do not try again
+            }
+        }
+        if (inotifyFd >= 0) {
+            std::string directory = std::filesystem::path(canonical).parent_path().generic_string();
+            bool known = std::any_of(directories.begin(), directories.end(), [&](const auto& entry) { return entry.second == directory; });
+            if (!known) {
+                int watch = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (watch < 0) {
+                    std::cerr << "ERROR: Cannot watch directory: " << directory << std::endl;
+                    watched.erase(canonical);
+                    return false;
+                }
+                directories[watch] = directory;
+            }
+        }
+#endif
+        return true;
+    }
+
+    /**
+     * @brief Returns the watched files that changed since the last call, without blocking. Thread safe.
+     *
+     * @return Canonical paths (see File::canonicalPath), each listed once.
+     */
+    static std::vector<std::string> Poll() {
+        std::vector<std::string> changed;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (watched.empty()) return changed;
+
+#ifdef FILE_WATCHER_INOTIFY
+        if (inotifyFd >= 0) {
+            alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+            while (true) {
+                ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+                if (length <= 0) break;
+                for (ssize_t offset = 0; offset < length;) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                    offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        // Events were lost, so any watched file may have changed
+                        for (const auto& entry : watched) AddOnce(changed, entry.first);
+                        continue;
+                    }
+                    auto directory = directories.find(event->wd);
+                    if (directory == directories.end() || event->len == 0) continue;
+                    std::string path = directory->second + "/" + event->name;
+                    if (watched.count(path)) AddOnce(changed, path);
+                }
+            }
+            return changed;
+        }
+#endif
+
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double, std::milli>(now - lastPoll).count() < pollIntervalMs) return changed;
+        lastPoll = now;
+        for (auto& [path, modified] : watched) {
+            std::error_code error;
+            auto current = std::filesystem::last_write_time(path, error);
+            if (error || current == modified) continue; // Missing files are mid save; wait for them to return
+            modified = current;
+            changed.push_back(path);
+        }
+        return changed;
+    }
+
+private:
+    static void AddOnce(std::vector<std::string>& paths, const std::string& path) {
+        if (std::find(paths.begin(), paths.end(), path) == paths.end()) paths.push_back(path);
+    }
+
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::filesystem::file_time_type> watched; // Canonical path -> last seen modification time
+    static std::chrono::steady_clock::time_point lastPoll;
+#ifdef FILE_WATCHER_INOTIFY
+    static int inotifyFd; // -1 before the first watch, -2 if inotify is unavailable
+    static std::unordered_map<int, std::string> directories;
+#endif
+};
+
+double FileWatcher::pollIntervalMs = 250.0;
+std::mutex FileWatcher::mutex;
+std::unordered_map<std::string, std::filesystem::file_time_type> FileWatcher::watched;
+std::chrono::steady_clock::time_point FileWatcher::lastPoll;
+#ifdef FILE_WATCHER_INOTIFY
+int FileWatcher::inotifyFd = -1;
+std::unordered_map<int, std::string> FileWatcher::directories;
+#endif
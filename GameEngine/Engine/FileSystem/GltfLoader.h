@@ -0,0 +1,595 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <charconv>
+#include <algorithm>
+#include "../Core.h"
+#include "../Objects/Mesh.h"
+#include "File.h"
+#include "MappedFile.h"
+#include "Json.h"
+
+/// **GltfLoader Class**
+/// Loads glTF 2.0 (.gltf with external or embedded buffers) and binary GLB meshes.
+/// Buffers are memory mapped. When the accessors of every primitive already match the requested
+/// VertexFormat (same component type, count, stride and interleaving) the Mesh points directly
+/// into the mapped buffer view and nothing is repacked. Other layouts are converted into an
+/// interleaved buffer with one pass per attribute. All primitives of the mesh share one vertex
+/// and one index buffer and are exposed as Mesh::subMeshes.
+///
+/// VertexFormat attributes are matched to glTF semantics by position:
+/// attribute 0 = POSITION, 1 = TEXCOORD_0, 2 = NORMAL.
+class GltfLoader {
+public:
+    /// <summary>
+    /// Loads one mesh of a glTF or GLB file.
+    /// </summary>
+    /// <param name="file">The .gltf or .glb file.</param>
+    /// <param name="vertexFormat">Desired VertexFormat.</param>
+    /// <param name="meshIndex">Index into the document's "meshes" array.</param>
+    /// <param name="contents">The file's bytes if they were already read; the file is viewed otherwise.</param>
+    /// <returns>The mesh, or an empty Mesh on error.</returns>
+    static Mesh Load(const File& file, const VertexFormat& vertexFormat, size_t meshIndex = 0, const FileView* contents = nullptr) {
+        Document document;
+        if (!OpenDocument(file, document, contents)) {
+            return Mesh();
+        }
+
+        const auto& attributes = vertexFormat.getAttributes();
+        if (attributes.empty() || attributes.size() > SemanticCount) {
+            std::cerr << "Unsupported vertex format for glTF meshes." << std::endl;
+            return Mesh();
+        }
+
+        const JsonValue& gltfMesh = document.json["meshes"][meshIndex];
+        if (!gltfMesh.isObject()) {
+            std::cerr << "ERROR: glTF file has no mesh " << meshIndex << ": " << file.getPath() << std::endl;
+            return Mesh();
+        }
+
+        // **Resolve every triangle primitive's accessors**
+        std::vector<Primitive> primitives;
+        const JsonValue& gltfPrimitives = gltfMesh["primitives"];
+        for (size_t p = 0; p < gltfPrimitives.size(); ++p) {
+            const JsonValue& gltfPrimitive = gltfPrimitives[p];
+            if (gltfPrimitive["mode"].asInt(4) != 4) {
+                std::cerr << "WARNING: Skipping non-triangle glTF primitive in " << file.getPath() << std::endl;
+                continue;
+            }
+
+            Primitive primitive;
+            if (!ResolveAccessor(document, gltfPrimitive["attributes"]["POSITION"], primitive.attributes[0])) {
+                std::cerr << "WARNING: Skipping glTF primitive without valid POSITION in " << file.getPath() << std::endl;
+                continue;
+            }
+            primitive.vertexCount = primitive.attributes[0].count;
+
+            bool valid = true;
+            for (size_t a = 1; a < attributes.size(); ++a) {
+                const JsonValue& accessorIndex = gltfPrimitive["attributes"][Semantics[a]];
+                if (accessorIndex.isNull()) continue; // Missing attributes are zero-filled
+                if (!ResolveAccessor(document, accessorIndex, primitive.attributes[a]) ||
+                    primitive.attributes[a].count != primitive.vertexCount) {
+                    valid = false;
+                }
+            }
+            if (gltfPrimitive.has("indices") && (!ResolveAccessor(document, gltfPrimitive["indices"], primitive.indices) ||
+                                                 !ValidIndices(document, primitive.indices, primitive.vertexCount))) {
+                valid = false;
+            }
+            if (!valid) {
+                std::cerr << "WARNING: Skipping glTF primitive with invalid accessors in " << file.getPath() << std::endl;
+                continue;
+            }
+            primitives.push_back(primitive);
+        }
+
+        if (primitives.empty()) {
+            std::cerr << "ERROR: glTF mesh has no loadable primitives: " << file.getPath() << std::endl;
+            return Mesh();
+        }
+
+        Mesh mesh;
+        mesh.vertexFormat = vertexFormat;
+        mesh.usage = GL_STATIC_DRAW;
+        BuildVertices(document, primitives, vertexFormat, mesh);
+        BuildIndices(document, primitives, mesh);
+
+        // **Bounds from the POSITION accessors' min/max, which the spec requires**
+        bool haveBounds = false;
+        for (const auto& primitive : primitives) {
+            const JsonValue& accessor = document.json["accessors"][primitive.attributes[0].accessorIndex];
+            if (accessor["min"].size() < 3 || accessor["max"].size() < 3) {
+                haveBounds = false;
+                break;
+            }
+            Vector3f minimum(accessor["min"][0].asNumber(), accessor["min"][1].asNumber(), accessor["min"][2].asNumber());
+            Vector3f maximum(accessor["max"][0].asNumber(), accessor["max"][1].asNumber(), accessor["max"][2].asNumber());
+            mesh.boundsMin = haveBounds ? glm::min(mesh.boundsMin, minimum) : minimum;
+            mesh.boundsMax = haveBounds ? glm::max(mesh.boundsMax, maximum) : maximum;
+            haveBounds = true;
+        }
+        if (haveBounds) {
+            mesh.ComputeBoundingRadius();
+        } else {
+            mesh.ComputeBounds();
+        }
+
+        return mesh;
+    }
+
+private:
+    static constexpr size_t SemanticCount = 3;
+    static constexpr const char* Semantics[SemanticCount] = {"POSITION", "TEXCOORD_0", "NORMAL"};
+
+    struct Buffer {
+        std::shared_ptr<const MappedFile> mapping; // Set when the bytes live in a mapped file
+        std::vector<uint8_t> owned;                 // Set for base64 data URIs and compressed archive entries
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct Document {
+        JsonValue json;
+        std::vector<Buffer> buffers;
+    };
+
+    struct Accessor {
+        bool present = false;
+        int64_t accessorIndex = -1;
+        int64_t bufferView = -1;
+        size_t buffer = 0;
+        size_t offset = 0;          // Byte offset of element 0 inside the buffer
+        size_t viewOffset = 0;      // Byte offset of the buffer view inside the buffer
+        size_t viewLength = 0;
+        size_t count = 0;
+        size_t stride = 0;
+        bool strideDeclared = false;
+        GLenum componentType = 0;
+        GLuint components = 0;
+        bool normalized = false;
+    };
+
+    struct Primitive {
+        Accessor attributes[SemanticCount];
+        Accessor indices;
+        size_t vertexCount = 0;
+        GLint baseVertex = 0;
+    };
+
+    static bool OpenDocument(const File& file, Document& document, const FileView* contents = nullptr) {
+        const std::string& path = file.filePath;
+        FileView source = contents ? *contents : file.view();
+        if (!source.isOpen() || source.size() == 0) {
+            std::cerr << "ERROR: Unable to open glTF file: " << path << std::endl;
+            return false;
+        }
+
+        std::string_view jsonText;
+        Buffer binaryChunk;
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(source.data());
+
+        if (source.size() >= 12 && std::memcmp(bytes, "glTF", 4) == 0) {
+            // **GLB: 12 byte header followed by a JSON chunk and an optional BIN chunk**
+            uint32_t version = ReadU32(bytes + 4);
+            uint32_t length = ReadU32(bytes + 8);
+            if (version != 2 || length > source.size()) {
+                std::cerr << "ERROR: Unsupported or truncated GLB file: " << path << std::endl;
+                return false;
+            }
+
+            size_t offset = 12;
+            while (offset + 8 <= length) {
+                uint32_t chunkLength = ReadU32(bytes + offset);
+                uint32_t chunkType = ReadU32(bytes + offset + 4);
+                offset += 8;
+                if (chunkLength > length - offset) break;
+
+                if (chunkType == 0x4E4F534A && jsonText.empty()) {          // "JSON"
+                    jsonText = std::string_view(reinterpret_cast<const char*>(bytes + offset), chunkLength);
+                } else if (chunkType == 0x004E4942 && !binaryChunk.data) {  // "BIN\0"
+                    binaryChunk = ViewBuffer(source, bytes + offset, chunkLength);
+                }
+                offset += (chunkLength + 3) & ~3u;
+            }
+        } else {
+            jsonText = source.text();
+        }
+
+        if (!JsonValue::Parse(jsonText, document.json)) {
+            std::cerr << "ERROR: Invalid glTF JSON: " << path << std::endl;
+            return false;
+        }
+
+        // **Resolve buffers: GLB chunk, data URI or external file**
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+        const JsonValue& buffers = document.json["buffers"];
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            Buffer buffer;
+            const JsonValue& uri = buffers[i]["uri"];
+            if (uri.isNull()) {
+                if (i == 0) buffer = std::move(binaryChunk);
+            } else if (uri.asString().rfind("data:", 0) == 0) {
+                size_t comma = uri.asString().find(',');
+                if (comma == std::string::npos || !DecodeBase64(std::string_view(uri.asString()).substr(comma + 1), buffer.owned)) {
+                    std::cerr << "ERROR: Invalid glTF data URI in " << path << std::endl;
+                    return false;
+                }
+                buffer.data = buffer.owned.data();
+                buffer.size = buffer.owned.size();
+            } else {
+                const File* external = File::find((directory / DecodeUri(uri.asString())).generic_string());
+                if (!external) return false;
+                FileView externalSource = external->view();
+                if (!externalSource.isOpen()) return false;
+                buffer = ViewBuffer(externalSource, reinterpret_cast<const uint8_t*>(externalSource.data()), externalSource.size());
+            }
+
+            size_t declared = static_cast<size_t>(buffers[i]["byteLength"].asInt(0));
+            if (!buffer.data || buffer.size < declared) {
+                std::cerr << "ERROR: Missing or truncated glTF buffer " << i << " in " << path << std::endl;
+                return false;
+            }
+            document.buffers.push_back(std::move(buffer));
+        }
+        return true;
+    }
+
+    // Buffer over bytes of a view: shares the view's mapping, or copies bytes it decompressed
+    static Buffer ViewBuffer(const FileView& source, const uint8_t* data, size_t size) {
+        Buffer buffer;
+        if (source.getMapping()) {
+            buffer.mapping = source.getMapping();
+            buffer.data = data;
+        } else {
+            buffer.owned.assign(data, data + size);
+            buffer.data = buffer.owned.data();
+        }
+        buffer.size = size;
+        return buffer;
+    }
+
+    static uint32_t ReadU32(const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static GLuint ComponentCount(const std::string& type) {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0;
+    }
+
+    static size_t ComponentSize(GLenum componentType) {
+        switch (componentType) {
+            case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+            case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+            case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+            default: return 0;
+        }
+    }
+
+    static bool ResolveAccessor(const Document& document, const JsonValue& index, Accessor& out) {
+        if (!index.isNumber()) return false;
+        const JsonValue& accessor = document.json["accessors"][static_cast<size_t>(index.asInt())];
+        if (!accessor.isObject() || accessor.has("sparse") || !accessor.has("bufferView")) return false;
+
+        out.accessorIndex = index.asInt();
+        out.bufferView = accessor["bufferView"].asInt();
+        const JsonValue& view = document.json["bufferViews"][static_cast<size_t>(out.bufferView)];
+        if (!view.isObject()) return false;
+
+        out.buffer = static_cast<size_t>(view["buffer"].asInt(-1));
+        if (out.buffer >= document.buffers.size()) return false;
+
+        out.componentType = static_cast<GLenum>(accessor["componentType"].asInt());
+        out.components = ComponentCount(accessor["type"].asString());
+        out.normalized = accessor["normalized"].isNull() ? false : accessor["normalized"].boolean;
+        out.count = static_cast<size_t>(accessor["count"].asInt());
+        size_t elementSize = ComponentSize(out.componentType) * out.components;
+        if (elementSize == 0) return false;
+
+        out.viewOffset = static_cast<size_t>(view["byteOffset"].asInt(0));
+        out.viewLength = static_cast<size_t>(view["byteLength"].asInt(0));
+        out.strideDeclared = view.has("byteStride");
+        out.stride = out.strideDeclared ? static_cast<size_t>(view["byteStride"].asInt()) : elementSize;
+        out.offset = out.viewOffset + static_cast<size_t>(accessor["byteOffset"].asInt(0));
+
+        // **Bounds check against both the view and the buffer**
+        const Buffer& buffer = document.buffers[out.buffer];
+        size_t span = out.count ? out.stride * (out.count - 1) + elementSize : 0;
+        if (out.viewOffset + out.viewLength > buffer.size || out.offset + span > out.viewOffset + out.viewLength) return false;
+
+        out.present = true;
+        return true;
+    }
+
+    static const uint8_t* Data(const Document& document, const Accessor& accessor) {
+        return document.buffers[accessor.buffer].data + accessor.offset;
+    }
+
+    /// <summary>
+    /// True when every primitive's accessors form exactly the interleaved layout of the VertexFormat
+    /// inside one shared buffer view, so the view can be used as the vertex buffer as-is.
+    /// </summary>
+    static bool MatchesLayout(std::vector<Primitive>& primitives, const VertexFormat& vertexFormat) {
+        const auto& attributes = vertexFormat.getAttributes();
+        const Accessor& first = primitives[0].attributes[0];
+
+        for (auto& primitive : primitives) {
+            size_t base = 0;
+            for (size_t a = 0; a < attributes.size(); ++a) {
+                const Accessor& accessor = primitive.attributes[a];
+                const auto& attribute = attributes[a];
+                size_t attributeOffset = reinterpret_cast<uintptr_t>(attribute.pointer);
+                if (!accessor.present || accessor.bufferView != first.bufferView ||
+                    accessor.componentType != attribute.type || accessor.components != attribute.count ||
+                    accessor.normalized != (attribute.normalized == GL_TRUE) ||
+                    accessor.stride != static_cast<size_t>(attribute.stride) ||
+                    accessor.offset < accessor.viewOffset + attributeOffset) {
+                    return false;
+                }
+                size_t attributeBase = accessor.offset - attributeOffset;
+                if (a == 0) base = attributeBase;
+                else if (attributeBase != base) return false;
+            }
+            if ((base - first.viewOffset) % first.stride != 0) return false;
+            primitive.baseVertex = static_cast<GLint>((base - first.viewOffset) / first.stride);
+        }
+        return true;
+    }
+
+    static void BuildVertices(const Document& document, std::vector<Primitive>& primitives,
+                              const VertexFormat& vertexFormat, Mesh& mesh) {
+        const auto& attributes = vertexFormat.getAttributes();
+
+        if (MatchesLayout(primitives, vertexFormat)) {
+            // **Zero-copy: the shared buffer view already is the vertex buffer**
+            const Accessor& first = primitives[0].attributes[0];
+            const Buffer& buffer = document.buffers[first.buffer];
+            const uint8_t* view = buffer.data + first.viewOffset;
+            if (buffer.mapping) {
+                mesh.mappedStorage = buffer.mapping;
+                mesh.mappedVertexData = view;
+                mesh.vertexData.reset();
+            } else {
+                mesh.vertexData = std::make_unique<float[]>((first.viewLength + sizeof(float) - 1) / sizeof(float));
+                std::memcpy(mesh.vertexData.get(), view, first.viewLength);
+            }
+            mesh.vertexDataSize = static_cast<GLsizeiptr>(first.viewLength);
+            return;
+        }
+
+        // **Repack into one interleaved buffer, one pass per attribute**
+        size_t stride = attributes[0].stride;
+        size_t totalVertices = 0;
+        for (auto& primitive : primitives) {
+            primitive.baseVertex = static_cast<GLint>(totalVertices);
+            totalVertices += primitive.vertexCount;
+        }
+
+        size_t size = totalVertices * stride;
+        mesh.vertexData = std::make_unique<float[]>((size + sizeof(float) - 1) / sizeof(float));
+        std::memset(mesh.vertexData.get(), 0, size);
+        mesh.vertexDataSize = static_cast<GLsizeiptr>(size);
+
+        uint8_t* destination = reinterpret_cast<uint8_t*>(mesh.vertexData.get());
+        for (const auto& primitive : primitives) {
+            for (size_t a = 0; a < attributes.size(); ++a) {
+                if (!primitive.attributes[a].present) continue;
+                uint8_t* target = destination + primitive.baseVertex * stride + reinterpret_cast<uintptr_t>(attributes[a].pointer);
+                ConvertAttribute(Data(document, primitive.attributes[a]), primitive.attributes[a], target, stride, attributes[a]);
+            }
+        }
+    }
+
+    template<int N>
+    static void CopyFloats(const uint8_t* source, size_t sourceStride, uint8_t* target, size_t targetStride, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            float value[N];
+            std::memcpy(value, source + i * sourceStride, sizeof(value));
+            std::memcpy(target + i * targetStride, value, sizeof(value));
+        }
+    }
+
+    /// <summary>
+    /// Converts one accessor into one attribute slot of an interleaved buffer.
+    /// Float sources go through fixed-width copies the compiler can vectorize; integer sources are
+    /// widened to float (normalized per the glTF rules when the accessor says so).
+    /// </summary>
+    static void ConvertAttribute(const uint8_t* source, const Accessor& accessor,
+                                 uint8_t* target, size_t targetStride, const VertexFormat::Attribute& attribute) {
+        GLuint components = std::min(accessor.components, attribute.count);
+
+        if (attribute.type != GL_FLOAT) {
+            // Integer destinations are only filled from identical component types
+            if (accessor.componentType != attribute.type) return;
+            size_t bytes = ComponentSize(accessor.componentType) * components;
+            for (size_t i = 0; i < accessor.count; ++i) {
+                std::memcpy(target + i * targetStride, source + i * accessor.stride, bytes);
+            }
+            return;
+        }
+
+        if (accessor.componentType == GL_FLOAT) {
+            switch (components) {
+                case 1: CopyFloats<1>(source, accessor.stride, target, targetStride, accessor.count); return;
+                case 2: CopyFloats<2>(source, accessor.stride, target, targetStride, accessor.count); return;
+                case 3: CopyFloats<3>(source, accessor.stride, target, targetStride, accessor.count); return;
+                default: CopyFloats<4>(source, accessor.stride, target, targetStride, accessor.count); return;
+            }
+        }
+
+        for (size_t i = 0; i < accessor.count; ++i) {
+            const uint8_t* element = source + i * accessor.stride;
+            float value[4];
+            for (GLuint c = 0; c < components; ++c) {
+                value[c] = ReadComponent(element, c, accessor.componentType, accessor.normalized);
+            }
+            std::memcpy(target + i * targetStride, value, components * sizeof(float));
+        }
+    }
+
+    static float ReadComponent(const uint8_t* element, GLuint component, GLenum type, bool normalized) {
+        switch (type) {
+            case GL_BYTE: {
+                int8_t v; std::memcpy(&v, element + component, 1);
+                return normalized ? std::max(v / 127.0f, -1.0f) : v;
+            }
+            case GL_UNSIGNED_BYTE: {
+                uint8_t v = element[component];
+                return normalized ? v / 255.0f : v;
+            }
+            case GL_SHORT: {
+                int16_t v; std::memcpy(&v, element + component * 2, 2);
+                return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+            }
+            case GL_UNSIGNED_SHORT: {
+                uint16_t v; std::memcpy(&v, element + component * 2, 2);
+                return normalized ? v / 65535.0f : v;
+            }
+            case GL_UNSIGNED_INT: {
+                uint32_t v; std::memcpy(&v, element + component * 4, 4);
+                return static_cast<float>(v);
+            }
+            default:
+                return 0.0f;
+        }
+    }
+
+    static void BuildIndices(const Document& document, const std::vector<Primitive>& primitives, Mesh& mesh) {
+        mesh.subMeshes.clear();
+
+        // **Zero-copy when every primitive uses 32-bit indices from one tightly packed, mapped view**
+        // A Mesh keeps a single mapping alive, so the indices must live in the same mapping as the
+        // vertices unless the vertex data is owned.
+        const Accessor& first = primitives[0].indices;
+        const auto& mapping = first.present ? document.buffers[first.buffer].mapping : nullptr;
+        bool shared = mapping && !first.strideDeclared && (!mesh.mappedStorage || mesh.mappedStorage == mapping);
+        for (const auto& primitive : primitives) {
+            const Accessor& indices = primitive.indices;
+            if (!indices.present || indices.componentType != GL_UNSIGNED_INT || indices.bufferView != first.bufferView ||
+                (indices.offset - indices.viewOffset) % sizeof(GLuint) != 0) {
+                shared = false;
+            }
+        }
+
+        if (shared) {
+            mesh.mappedStorage = mapping;
+            mesh.mappedIndexData = document.buffers[first.buffer].data + first.viewOffset;
+            mesh.indexData.reset();
+            mesh.indexDataSize = static_cast<GLsizeiptr>(first.viewLength / sizeof(GLuint) * sizeof(GLuint));
+            for (const auto& primitive : primitives) {
+                Mesh::SubMesh subMesh;
+                subMesh.firstIndex = static_cast<GLuint>((primitive.indices.offset - first.viewOffset) / sizeof(GLuint));
+                subMesh.indexCount = static_cast<GLsizei>(primitive.indices.count);
+                subMesh.baseVertex = primitive.baseVertex;
+                mesh.subMeshes.push_back(subMesh);
+            }
+            return;
+        }
+
+        // **Otherwise widen everything into one owned 32-bit index buffer**
+        size_t totalIndices = 0;
+        for (const auto& primitive : primitives) {
+            totalIndices += primitive.indices.present ? primitive.indices.count : primitive.vertexCount;
+        }
+
+        mesh.indexData = std::make_unique<uint8_t[]>(totalIndices * sizeof(GLuint));
+        mesh.indexDataSize = static_cast<GLsizeiptr>(totalIndices * sizeof(GLuint));
+        GLuint* out = reinterpret_cast<GLuint*>(mesh.indexData.get());
+
+        size_t written = 0;
+        for (const auto& primitive : primitives) {
+            Mesh::SubMesh subMesh;
+            subMesh.firstIndex = static_cast<GLuint>(written);
+            subMesh.baseVertex = primitive.baseVertex;
+
+            const Accessor& indices = primitive.indices;
+            if (!indices.present) {
+                for (size_t i = 0; i < primitive.vertexCount; ++i) out[written++] = static_cast<GLuint>(i);
+            } else {
+                const uint8_t* source = Data(document, indices);
+                for (size_t i = 0; i < indices.count; ++i) {
+                    out[written++] = ReadIndex(source + i * indices.stride, indices.componentType);
+                }
+            }
+
+            subMesh.indexCount = static_cast<GLsizei>(written - subMesh.firstIndex);
+            mesh.subMeshes.push_back(subMesh);
+        }
+    }
+
+    static GLuint ReadIndex(const uint8_t* element, GLenum componentType) {
+        switch (componentType) {
+            case GL_UNSIGNED_BYTE: return element[0];
+            case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, element, 2); return v; }
+            default: { uint32_t v; std::memcpy(&v, element, 4); return v; }
+        }
+    }
+
+    // Index accessors must be unsigned byte, short or int scalars addressing the primitive's vertices
+    static bool ValidIndices(const Document& document, const Accessor& indices, size_t vertexCount) {
+        if (indices.components != 1 || (indices.componentType != GL_UNSIGNED_BYTE &&
+            indices.componentType != GL_UNSIGNED_SHORT && indices.componentType != GL_UNSIGNED_INT)) {
+            return false;
+        }
+        const uint8_t* source = Data(document, indices);
+        for (size_t i = 0; i < indices.count; ++i) {
+            if (ReadIndex(source + i * indices.stride, indices.componentType) >= vertexCount) return false;
+        }
+        return true;
+    }
+
+    static std::string DecodeUri(const std::string& uri) {
+        std::string out;
+        for (size_t i = 0; i < uri.size(); ++i) {
+            unsigned value = 0;
+            if (uri[i] == '%' && i + 2 < uri.size() &&
+                std::from_chars(uri.data() + i + 1, uri.data() + i + 3, value, 16).ptr == uri.data() + i + 3) {
+                out += static_cast<char>(value);
+                i += 2;
+            } else {
+                out += uri[i];
+            }
+        }
+        return out;
+    }
+
+    static bool DecodeBase64(std::string_view text, std::vector<uint8_t>& out) {
+        auto value = [](char c) -> int {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+') return 62;
+            if (c == '/') return 63;
+            return -1;
+        };
+
+        out.clear();
+        out.reserve(text.size() / 4 * 3);
+        uint32_t accumulator = 0;
+        int bits = 0;
+        for (char c : text) {
+            if (c == '=') break;
+            int v = value(c);
+            if (v < 0) return false;
+            accumulator = (accumulator << 6) | static_cast<uint32_t>(v);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out.push_back(static_cast<uint8_t>(accumulator >> bits));
+            }
+        }
+        return true;
+    }
+};
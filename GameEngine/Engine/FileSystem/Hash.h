@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+/**
+ * @class Hash
+ * @brief Fast non-cryptographic 64-bit hashing for content keys (cache validation, deduplication).
+ */
+class Hash {
+public:
+    /**
+     * @brief Hashes a block of memory, eight bytes per step.
+     *
+     * @param data Start of the bytes to hash.
+     * @param size Number of bytes.
+     * @param seed Optional seed, e.g. a previous hash to chain blocks.
+     * @return The 64-bit hash.
+     */
+    static uint64_t Bytes(const void* data, size_t size, uint64_t seed = 0) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        uint64_t h = seed ^ (0x9E3779B97F4A7C15ull * (size + 1));
+
+        while (size >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            h = Mix(h ^ Mix(word));
+            p += 8;
+            size -= 8;
+        }
+
+        uint64_t tail = 0;
+        if (size > 0) std::memcpy(&tail, p, size);
+        return Mix(h ^ Mix(tail ^ size));
+    }
+
+    /** @brief Hashes the characters of a string. */
+    static uint64_t String(std::string_view text, uint64_t seed = 0) {
+        return Bytes(text.data(), text.size(), seed);
+    }
+
+    /** @brief Combines two hashes into one; the order matters. */
+    static uint64_t Combine(uint64_t a, uint64_t b) {
+        return Mix(a ^ (b + 0x9E3779B97F4A7C15ull + (a << 6) + (a >> 2)));
+    }
+
+    /** @brief Final avalanche step of MurmurHash3. */
+    static uint64_t Mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+};
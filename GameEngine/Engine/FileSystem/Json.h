@@ -0,0 +1,218 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <charconv>
+#include <cstdint>
+
+/**
+ * @class JsonValue
+ * @brief Minimal JSON document model used by asset loaders (glTF).
+ *
+ * Values are immutable once parsed. Lookups on missing members or out of range
+ * elements return a shared null value, so chained lookups never need null checks.
+ */
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> elements;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    bool isNull() const { return type == Type::Null; }
+    bool isNumber() const { return type == Type::Number; }
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    /** @brief Number of array elements (0 for non-arrays). */
+    size_t size() const { return elements.size(); }
+
+    /** @brief Object member lookup. */
+    const JsonValue& operator[](std::string_view key) const {
+        for (const auto& member : members) {
+            if (member.first == key) return member.second;
+        }
+        return Null();
+    }
+
+    /** @brief Array element lookup. */
+    const JsonValue& operator[](size_t index) const {
+        return index < elements.size() ? elements[index] : Null();
+    }
+
+    bool has(std::string_view key) const {
+        return !(*this)[key].isNull();
+    }
+
+    double asNumber(double fallback = 0.0) const { return isNumber() ? number : fallback; }
+    int64_t asInt(int64_t fallback = 0) const { return isNumber() ? static_cast<int64_t>(number) : fallback; }
+    const std::string& asString() const { return string; }
+
+    /**
+     * @brief Parses a JSON document.
+     *
+     * @param text The JSON text.
+     * @param out Receives the parsed document.
+     * @return False if the text is not valid JSON.
+     */
+    static bool Parse(std::string_view text, JsonValue& out) {
+        Parser parser{text.data(), text.data() + text.size()};
+        if (!parser.parseValue(out, 0)) return false;
+        parser.skipWhitespace();
+        return parser.p == parser.end;
+    }
+
+private:
+    static const JsonValue& Null() {
+        static const JsonValue null;
+        return null;
+    }
+
+    struct Parser {
+        const char* p;
+        const char* end;
+
+        static constexpr int MaxDepth = 128;
+
+        void skipWhitespace() {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+        }
+
+        bool literal(std::string_view word) {
+            if (static_cast<size_t>(end - p) < word.size() || std::string_view(p, word.size()) != word) return false;
+            p += word.size();
+            return true;
+        }
+
+        bool parseValue(JsonValue& out, int depth) {
+            if (depth > MaxDepth) return false;
+            skipWhitespace();
+            if (p >= end) return false;
+
+            switch (*p) {
+                case '{': return parseObject(out, depth);
+                case '[': return parseArray(out, depth);
+                case '"': out.type = Type::String; return parseString(out.string);
+                case 't': out.type = Type::Bool; out.boolean = true; return literal("true");
+                case 'f': out.type = Type::Bool; out.boolean = false; return literal("false");
+                case 'n': out.type = Type::Null; return literal("null");
+                default: return parseNumber(out);
+            }
+        }
+
+        bool parseNumber(JsonValue& out) {
+            out.type = Type::Number;
+            auto [next, error] = std::from_chars(p, end, out.number);
+            if (error != std::errc()) return false;
+            p = next;
+            return true;
+        }
+
+        static void appendUtf8(std::string& s, uint32_t c) {
+            if (c < 0x80) {
+                s += static_cast<char>(c);
+            } else if (c < 0x800) {
+                s += static_cast<char>(0xC0 | (c >> 6));
+                s += static_cast<char>(0x80 | (c & 0x3F));
+            } else if (c < 0x10000) {
+                s += static_cast<char>(0xE0 | (c >> 12));
+                s += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                s += static_cast<char>(0x80 | (c & 0x3F));
+            } else {
+                s += static_cast<char>(0xF0 | (c >> 18));
+                s += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+                s += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                s += static_cast<char>(0x80 | (c & 0x3F));
+            }
+        }
+
+        bool parseHex4(uint32_t& value) {
+            if (end - p < 4) return false;
+            auto [next, error] = std::from_chars(p, p + 4, value, 16);
+            if (error != std::errc() || next != p + 4) return false;
+            p += 4;
+            return true;
+        }
+
+        bool parseString(std::string& out) {
+            ++p; // opening quote
+            while (p < end && *p != '"') {
+                if (*p != '\\') {
+                    out += *p++;
+                    continue;
+                }
+                if (++p >= end) return false;
+                switch (*p++) {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u': {
+                        uint32_t c;
+                        if (!parseHex4(c)) return false;
+                        if (c >= 0xD800 && c < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                            p += 2;
+                            uint32_t low;
+                            if (!parseHex4(low)) return false;
+                            c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(out, c);
+                        break;
+                    }
+                    default: return false;
+                }
+            }
+            if (p >= end) return false;
+            ++p; // closing quote
+            return true;
+        }
+
+        bool parseArray(JsonValue& out, int depth) {
+            out.type = Type::Array;
+            ++p;
+            skipWhitespace();
+            if (p < end && *p == ']') { ++p; return true; }
+            while (true) {
+                out.elements.emplace_back();
+                if (!parseValue(out.elements.back(), depth + 1)) return false;
+                skipWhitespace();
+                if (p >= end) return false;
+                if (*p == ',') { ++p; continue; }
+                if (*p == ']') { ++p; return true; }
+                return false;
+            }
+        }
+
+        bool parseObject(JsonValue& out, int depth) {
+            out.type = Type::Object;
+            ++p;
+            skipWhitespace();
+            if (p < end && *p == '}') { ++p; return true; }
+            while (true) {
+                skipWhitespace();
+                if (p >= end || *p != '"') return false;
+                out.members.emplace_back();
+                if (!parseString(out.members.back().first)) return false;
+                skipWhitespace();
+                if (p >= end || *p != ':') return false;
+                ++p;
+                if (!parseValue(out.members.back().second, depth + 1)) return false;
+                skipWhitespace();
+                if (p >= end) return false;
+                if (*p == ',') { ++p; continue; }
+                if (*p == '}') { ++p; return true; }
+                return false;
+            }
+        }
+    };
+};
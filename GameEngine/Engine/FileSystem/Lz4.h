@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/**
+ * @class Lz4
+ * @brief Compressor and decompressor for the LZ4 block format.
+ *
+ * Output is compatible with LZ4_compress_default / LZ4_decompress_safe, so archives can
+ * also be produced or inspected with the reference library. The compressor is a single-pass
+ * greedy matcher: it favours speed over ratio, and decompression speed does not depend on it.
+ */
+class Lz4 {
+public:
+    /** @brief Largest compressed size of size input bytes. */
+    static size_t CompressBound(size_t size) {
+        return size + size / 255 + 16;
+    }
+
+    /**
+     * @brief Compresses a block.
+     *
+     * @param source The bytes to compress.
+     * @param size Number of bytes, at most 2 GB.
+     * @param destination Receives the compressed block; needs CompressBound(size) bytes.
+     * @return The compressed size.
+     */
+    static size_t Compress(const char* source, size_t size, char* destination) {
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(source);
+        unsigned char* output = reinterpret_cast<unsigned char*>(destination);
+        unsigned char* op = output;
+        size_t anchor = 0;
+
+        if (size >= MinInputSize) {
+            std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+            // A match may not start in the last 12 bytes, and the last 5 bytes are always literals
+            size_t matchLimit = size - LastLiterals;
+            size_t position = 1;
+
+            while (position + MinMatchDistance <= size) {
+                uint32_t& slot = table[HashAt(input + position)];
+                size_t candidate = slot;
+                slot = static_cast<uint32_t>(position);
+                if (position - candidate > MaxOffset || Read32(input + candidate) != Read32(input + position)) {
+                    ++position;
+                    continue;
+                }
+
+                // Extend backwards over literals and forwards up to the limit
+                while (position > anchor && candidate > 0 && input[position - 1] == input[candidate - 1]) {
+                    --position;
+                    --candidate;
+                }
+                size_t length = MinMatch;
+                while (position + length < matchLimit && input[position + length] == input[candidate + length]) ++length;
+
+                op = WriteSequence(op, input + anchor, position - anchor, position - candidate, length);
+                position += length;
+                anchor = position;
+                if (position >= 2 && position + MinMatchDistance <= size) table[HashAt(input + position - 2)] = static_cast<uint32_t>(position - 2);
+            }
+        }
+
+        // Closing sequence: the remaining literals and no match
+        size_t literals = size - anchor;
+        op = WriteToken(op, literals, 0);
+        std::memcpy(op, input + anchor, literals);
+        op += literals;
+        return static_cast<size_t>(op - output);
+    }
+
+    /**
+     * @brief Decompresses a block, checking every length against both buffers.
+     *
+     * @param source The compressed block.
+     * @param size Its size in bytes.
+     * @param destination Receives the bytes.
+     * @param decompressedSize Exact size of the decompressed block.
+     * @return False if the block is malformed or does not decompress to exactly decompressedSize bytes.
+     */
+    static bool Decompress(const char* source, size_t size, char* destination, size_t decompressedSize) {
+        const unsigned char* ip = reinterpret_cast<const unsigned char*>(source);
+        const unsigned char* inputEnd = ip + size;
+        unsigned char* output = reinterpret_cast<unsigned char*>(destination);
+        unsigned char* op = output;
+        unsigned char* outputEnd = output + decompressedSize;
+
+        while (ip < inputEnd) {
+            unsigned token = *ip++;
+            size_t literals = token >> 4;
+            if (literals == 15 && !ReadLength(ip, inputEnd, literals)) return false;
+            if (literals > static_cast<size_t>(inputEnd - ip) || literals > static_cast<size_t>(outputEnd - op)) return false;
+            std::memcpy(op, ip, literals);
+            ip += literals;
+            op += literals;
+            if (ip == inputEnd) break; // The last sequence has no match
+
+            if (inputEnd - ip < 2) return false;
+            size_t offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            size_t length = token & 15;
+            if (length == 15 && !ReadLength(ip, inputEnd, length)) return false;
+            length += MinMatch;
+            if (offset == 0 || offset > static_cast<size_t>(op - output) || length > static_cast<size_t>(outputEnd - op)) return false;
+
+            // Byte by byte, since overlapping matches repeat the bytes they copy
+            const unsigned char* match = op - offset;
+            if (offset >= length) {
+                std::memcpy(op, match, length);
+                op += length;
+            } else {
+                for (size_t i = 0; i < length; ++i) *op++ = match[i];
+            }
+        }
+        return op == outputEnd;
+    }
+
+private:
+    static constexpr size_t MinMatch = 4;
+    static constexpr size_t LastLiterals = 5;
+    static constexpr size_t MinMatchDistance = 12;
+    static constexpr size_t MinInputSize = 13;
+    static constexpr size_t MaxOffset = 65535;
+    static constexpr unsigned HashBits = 16;
+
+    static uint32_t Read32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    static uint32_t HashAt(const unsigned char* p) {
+        return (Read32(p) * 2654435761u) >> (32 - HashBits);
+    }
+
+    // Writes a token with the 4-bit literal count and match code, then the literal count's extension bytes
+    static unsigned char* WriteToken(unsigned char* op, size_t literals, unsigned matchCode) {
+        unsigned char* token = op++;
+        if (literals >= 15) {
+            *token = static_cast<unsigned char>((15 << 4) | matchCode);
+            for (literals -= 15; literals >= 255; literals -= 255) *op++ = 255;
+            *op++ = static_cast<unsigned char>(literals);
+        } else {
+            *token = static_cast<unsigned char>((literals << 4) | matchCode);
+        }
+        return op;
+    }
+
+    static unsigned char* WriteSequence(unsigned char* op, const unsigned char* literals, size_t literalCount, size_t offset, size_t length) {
+        size_t matchCode = length - MinMatch;
+        op = WriteToken(op, literalCount, static_cast<unsigned>(matchCode >= 15 ? 15 : matchCode));
+        std::memcpy(op, literals, literalCount);
+        op += literalCount;
+        *op++ = static_cast<unsigned char>(offset);
+        *op++ = static_cast<unsigned char>(offset >> 8);
+        if (matchCode >= 15) {
+            for (matchCode -= 15; matchCode >= 255; matchCode -= 255) *op++ = 255;
+            *op++ = static_cast<unsigned char>(matchCode);
+        }
+        return op;
+    }
+
+    static bool ReadLength(const unsigned char*& ip, const unsigned char* end, size_t& length) {
+        unsigned value;
+        do {
+            if (ip == end) return false;
+            value = *ip++;
+            length += value;
+        } while (value == 255);
+        return true;
+    }
+};
@@ -0,0 +1,239 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a file on disk.
+ *
+ * The mapping stays valid for the lifetime of the object, so loaders can parse
+ * straight out of the page cache instead of copying the file into a std::string.
+ */
+class MappedFile {
+public:
+    /** @brief How a range of the mapping is about to be read; see advise(). */
+    enum class Access {
+        Normal,
+        Sequential, // Read front to back once: read ahead aggressively, drop pages behind
+        Random,     // Scattered lookups: no read-ahead
+        WillNeed    // Needed soon: start reading it in now
+    };
+
+    MappedFile() = default;
+
+    /**
+     * @brief Maps the file at the given path.
+     *
+     * On failure the object is left empty; check with isOpen().
+     *
+     * @param path The path of the file to map.
+     */
+    explicit MappedFile(const std::string& path) {
+        open(path);
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            mappedData = other.mappedData;
+            mappedSize = other.mappedSize;
+            opened = other.opened;
+#ifdef _WIN32
+            fileHandle = other.fileHandle;
+            mappingHandle = other.mappingHandle;
+            other.fileHandle = INVALID_HANDLE_VALUE;
+            other.mappingHandle = nullptr;
+#endif
+            other.mappedData = nullptr;
+            other.mappedSize = 0;
+            other.opened = false;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Maps the file at the given path, releasing any previous mapping.
+     *
+     * Empty files are reported as open with a size of zero and a null data pointer.
+     *
+     * @param path The path of the file to map.
+     * @return True if the file could be opened and mapped.
+     */
+    bool open(const std::string& path) {
+        close();
+        opened = false;
+#ifdef _WIN32
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                 OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            std::cerr << "ERROR: Unable to map file: " << path << std::endl;
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(fileHandle, &size)) {
+            std::cerr << "ERROR: Unable to map file: " << path << std::endl;
+            close();
+            return false;
+        }
+
+        mappedSize = static_cast<size_t>(size.QuadPart);
+        if (mappedSize > 0) {
+            mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mappingHandle) {
+                mappedData = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            }
+            if (!mappedData) {
+                std::cerr << "ERROR: Unable to map file: " << path << std::endl;
+                close();
+                return false;
+            }
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "ERROR: Unable to map file: " << path << std::endl;
+            return false;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            std::cerr << "ERROR: Unable to map file: " << path << std::endl;
+            ::close(fd);
+            return false;
+        }
+
+        mappedSize = static_cast<size_t>(info.st_size);
+        if (mappedSize > 0) {
+            void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                std::cerr << "ERROR: Unable to map file: " << path << std::endl;
+                ::close(fd);
+                mappedSize = 0;
+                return false;
+            }
+            mappedData = static_cast<const char*>(address);
+        }
+        // The mapping keeps its own reference to the file.
+        ::close(fd);
+#endif
+        opened = true;
+        return true;
+    }
+
+    /**
+     * @brief Unmaps the file. Safe to call on an empty object.
+     */
+    void close() {
+#ifdef _WIN32
+        if (mappedData) UnmapViewOfFile(mappedData);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (mappedData) munmap(const_cast<char*>(mappedData), mappedSize);
+#endif
+        mappedData = nullptr;
+        mappedSize = 0;
+        opened = false;
+    }
+
+    /**
+     * @brief Drops the resident pages of a byte range from this process.
+     *
+     * The data stays valid: the pages are read back from the page cache on the next access.
+     * Streaming code calls this after consuming a range so resident memory stays bounded.
+     *
+     * @param offset First byte of the range.
+     * @param length Number of bytes.
+     */
+    void evict(size_t offset, size_t length) const {
+        if (!mappedData || offset >= mappedSize) return;
+        length = std::min(length, mappedSize - offset);
+#ifdef _WIN32
+        VirtualUnlock(const_cast<char*>(mappedData) + offset, length);
+#else
+        // madvise needs a page aligned start; only whole pages inside the range are dropped
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = (offset + page - 1) / page * page;
+        size_t end = (offset + length) / page * page;
+        if (end > begin) madvise(const_cast<char*>(mappedData) + begin, end - begin, MADV_DONTNEED);
+#endif
+    }
+
+    /**
+     * @brief Tells the kernel how a byte range will be read, so page faults find the data already read in.
+     *
+     * Only a hint: the data reads the same either way. A no-op on Windows, where the file is
+     * already opened for sequential scans.
+     *
+     * @param access The expected access pattern.
+     * @param offset First byte of the range.
+     * @param length Number of bytes; the rest of the file by default.
+     */
+    void advise(Access access, size_t offset = 0, size_t length = SIZE_MAX) const {
+        if (!mappedData || offset >= mappedSize) return;
+        length = std::min(length, mappedSize - offset);
+#ifndef _WIN32
+        static const int advice[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED };
+        // madvise needs a page aligned start; the page holding the first byte is included
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = offset / page * page;
+        madvise(const_cast<char*>(mappedData) + begin, offset + length - begin, advice[static_cast<int>(access)]);
+#endif
+    }
+
+    /** @brief The mapped bytes as text. */
+    std::string_view view() const { return std::string_view(mappedData, mappedSize); }
+
+    /** @brief The mapped bytes. */
+    std::span<const std::byte> bytes() const { return std::span<const std::byte>(reinterpret_cast<const std::byte*>(mappedData), mappedSize); }
+
+    /** @brief True if a file is currently mapped (possibly with zero length). */
+    bool isOpen() const { return opened; }
+
+    /** @brief Start of the mapped bytes, or nullptr for empty files. */
+    const char* data() const { return mappedData; }
+
+    /** @brief Number of mapped bytes. */
+    size_t size() const { return mappedSize; }
+
+private:
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+    bool opened = false;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#endif
+};
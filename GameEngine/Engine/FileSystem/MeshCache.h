@@ -0,0 +1,254 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
+#include "../Core.h"
+#include "../Objects/Mesh.h"
+#include "MappedFile.h"
+#include "File.h"
+#include "Hash.h"
+
+/// **MeshCache Class**
+/// Cooked binary meshes (.gmesh) written next to their source file.
+/// A cooked mesh holds the interleaved vertex blob, the index blob (all levels of detail), the
+/// VertexFormat description, the bounds, the UV density, the LOD ranges and the meshlets. It is keyed by the hash of the source
+/// bytes and by the vertex format, and is memory mapped on load so the blobs go straight to the GPU
+/// without any parsing.
+class MeshCache {
+public:
+    static constexpr uint32_t Version = 6;
+    static constexpr uint32_t MaxAttributes = 16;
+
+    struct AttributeRecord {
+        uint32_t count;
+        uint32_t type;
+        uint32_t normalized;
+        uint32_t stride;
+        uint64_t offset;
+    };
+
+    struct LodRecord {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float error;
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t formatHash;
+        uint32_t indexType;
+        uint32_t attributeCount;
+        AttributeRecord attributes[MaxAttributes];
+        float boundsMin[3];
+        float boundsMax[3];
+        float boundsRadius;
+        float positionScale[3];
+        float positionOffset[3];
+        float uvDensity;
+        uint32_t lodCount;
+        LodRecord lods[Mesh::MaxLods];
+        uint64_t vertexOffset;
+        uint64_t vertexSize;
+        uint64_t indexOffset;
+        uint64_t indexSize;
+        uint64_t meshletOffset;
+        uint64_t meshletCount;
+    };
+    static_assert(std::is_trivially_copyable_v<Header>, "Header is written to disk as raw bytes");
+    static_assert(std::is_trivially_copyable_v<Mesh::Meshlet>, "Meshlets are written to disk as raw bytes");
+
+    /// <summary>
+    /// Hashes the attribute layout of a VertexFormat.
+    /// </summary>
+    static uint64_t FormatHash(const VertexFormat& format) {
+        uint64_t h = Hash::Mix(format.getAttributes().size());
+        for (const auto& attribute : format.getAttributes()) {
+            AttributeRecord record = MakeRecord(attribute);
+            h = Hash::Bytes(&record, sizeof(record), h);
+        }
+        return h;
+    }
+
+    /// <summary>
+    /// Path of the cooked mesh for a source file, vertex format and import settings, e.g. "Test.obj.1a2b3c4d.gmesh".
+    /// Each combination has its own file, so loads with different settings don't overwrite each other's cook.
+    /// </summary>
+    /// <param name="settings">Hash of the import settings the mesh is cooked with (LOD ratios, optimization, ...).</param>
+    static std::string GetCachePath(const std::string& sourcePath, const VertexFormat& format, uint64_t settings) {
+        char tag[17];
+        std::snprintf(tag, sizeof(tag), "%08x", static_cast<uint32_t>(Hash::Combine(FormatHash(format), settings)));
+        return sourcePath + "." + tag + ".gmesh";
+    }
+
+    /// <summary>
+    /// Maps the cooked mesh for a source and points the Mesh at its blobs.
+    /// </summary>
+    /// <param name="sourcePath">Path of the source asset the cache was cooked from.</param>
+    /// <param name="sourceHash">Hash::Bytes of the current source contents.</param>
+    /// <param name="settings">Hash of the import settings (see GetCachePath).</param>
+    /// <param name="format">The VertexFormat the caller wants.</param>
+    /// <param name="mesh">Receives the mapped data on success.</param>
+    /// <returns>False if there is no valid cooked mesh for this source, settings and format.</returns>
+    static bool Load(const std::string& sourcePath, uint64_t sourceHash, uint64_t settings, const VertexFormat& format, Mesh& mesh) {
+        std::string cachePath = GetCachePath(sourcePath, format, settings);
+        std::error_code error;
+        if (!std::filesystem::exists(cachePath, error)) return false;
+
+        auto mapping = std::make_shared<MappedFile>(cachePath);
+        if (!mapping->isOpen() || mapping->size() < sizeof(Header)) return false;
+
+        Header header;
+        std::memcpy(&header, mapping->data(), sizeof(Header));
+        if (std::memcmp(header.magic, "GMSH", 4) != 0 || header.version != Version) return false;
+        if (header.sourceHash != sourceHash || header.formatHash != FormatHash(format)) return false;
+        if (header.indexType != GL_UNSIGNED_INT && header.indexType != GL_UNSIGNED_SHORT) return false;
+
+        uint64_t size = mapping->size();
+        if (header.vertexOffset > size || header.vertexSize > size - header.vertexOffset ||
+            header.indexOffset > size || header.indexSize > size - header.indexOffset ||
+            header.lodCount > Mesh::MaxLods || header.meshletOffset > size ||
+            header.meshletCount > (size - header.meshletOffset) / sizeof(Mesh::Meshlet)) {
+            std::cerr << "WARNING: Corrupt cooked mesh ignored: " << cachePath << std::endl;
+            return false;
+        }
+
+        const char* base = mapping->data();
+        mesh.SetMappedData(mapping,
+                           base + header.vertexOffset, static_cast<GLsizeiptr>(header.vertexSize),
+                           base + header.indexOffset, static_cast<GLsizeiptr>(header.indexSize),
+                           format,
+                           Vector3f(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]),
+                           Vector3f(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]));
+        mesh.indexType = header.indexType;
+        mesh.boundsRadius = header.boundsRadius;
+        mesh.uvDensity = header.uvDensity;
+        mesh.positionScale = Vector3f(header.positionScale[0], header.positionScale[1], header.positionScale[2]);
+        mesh.positionOffset = Vector3f(header.positionOffset[0], header.positionOffset[1], header.positionOffset[2]);
+        for (uint32_t i = 0; i < header.lodCount; ++i) {
+            Mesh::LodLevel lod;
+            lod.firstIndex = header.lods[i].firstIndex;
+            lod.indexCount = static_cast<GLsizei>(header.lods[i].indexCount);
+            lod.error = header.lods[i].error;
+            mesh.lods.push_back(lod);
+        }
+        mesh.meshlets.resize(header.meshletCount);
+        if (header.meshletCount > 0) {
+            std::memcpy(mesh.meshlets.data(), base + header.meshletOffset, header.meshletCount * sizeof(Mesh::Meshlet));
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Writes a cooked mesh next to its source. The file is written under a temporary name and
+    /// renamed into place so a crash never leaves a truncated cache behind.
+    /// </summary>
+    /// <returns>False if the cache could not be written (e.g. read-only asset folder).</returns>
+    static bool Write(const std::string& sourcePath, uint64_t sourceHash, uint64_t settings, const Mesh& mesh) {
+        const auto& attributes = mesh.vertexFormat.getAttributes();
+        if (attributes.size() > MaxAttributes || mesh.lods.size() > Mesh::MaxLods) return false;
+
+        Header header = MakeHeader(sourceHash, mesh.vertexFormat);
+        header.indexType = mesh.indexType;
+        header.boundsRadius = mesh.boundsRadius;
+        header.uvDensity = mesh.uvDensity;
+        for (int i = 0; i < 3; ++i) {
+            header.boundsMin[i] = mesh.boundsMin[i];
+            header.boundsMax[i] = mesh.boundsMax[i];
+            header.positionScale[i] = mesh.positionScale[i];
+            header.positionOffset[i] = mesh.positionOffset[i];
+        }
+        header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+        for (size_t i = 0; i < mesh.lods.size(); ++i) {
+            header.lods[i] = LodRecord{mesh.lods[i].firstIndex, static_cast<uint32_t>(mesh.lods[i].indexCount), mesh.lods[i].error};
+        }
+        header.vertexOffset = Align(sizeof(Header));
+        header.vertexSize = mesh.vertexDataSize;
+        header.indexOffset = Align(header.vertexOffset + header.vertexSize);
+        header.indexSize = mesh.indexDataSize;
+        header.meshletOffset = Align(header.indexOffset + header.indexSize);
+        header.meshletCount = mesh.meshlets.size();
+
+        std::string cachePath = GetCachePath(sourcePath, mesh.vertexFormat, settings);
+        std::string tempPath = File::tempPath(cachePath);
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "WARNING: Unable to write cooked mesh: " << cachePath << std::endl;
+                return false;
+            }
+
+            static const char padding[BlobAlignment] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            out.write(padding, header.vertexOffset - sizeof(Header));
+            out.write(static_cast<const char*>(mesh.GetVertexData()), header.vertexSize);
+            out.write(padding, header.indexOffset - (header.vertexOffset + header.vertexSize));
+            out.write(static_cast<const char*>(mesh.GetIndexData()), header.indexSize);
+            out.write(padding, header.meshletOffset - (header.indexOffset + header.indexSize));
+            out.write(reinterpret_cast<const char*>(mesh.meshlets.data()), header.meshletCount * sizeof(Mesh::Meshlet));
+            if (!out) {
+                std::cerr << "WARNING: Unable to write cooked mesh: " << cachePath << std::endl;
+                out.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error) {
+            std::cerr << "WARNING: Unable to write cooked mesh: " << cachePath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Header with the identification and vertex format filled in; the caller sets the blobs.
+    /// Used by Write and by writers that stream the blobs (see StreamingMeshImporter).
+    /// </summary>
+    static Header MakeHeader(uint64_t sourceHash, const VertexFormat& format) {
+        const auto& attributes = format.getAttributes();
+        Header header{};
+        std::memcpy(header.magic, "GMSH", 4);
+        header.version = Version;
+        header.sourceHash = sourceHash;
+        header.formatHash = FormatHash(format);
+        header.indexType = GL_UNSIGNED_INT;
+        header.attributeCount = static_cast<uint32_t>(std::min<size_t>(attributes.size(), MaxAttributes));
+        for (uint32_t i = 0; i < header.attributeCount; ++i) {
+            header.attributes[i] = MakeRecord(attributes[i]);
+        }
+        for (int i = 0; i < 3; ++i) header.positionScale[i] = 1.0f;
+        return header;
+    }
+
+    static constexpr uint64_t BlobAlignment = 16;
+
+    /// <summary>
+    /// Rounds a blob offset up to BlobAlignment.
+    /// </summary>
+    static uint64_t Align(uint64_t value) {
+        return (value + BlobAlignment - 1) & ~(BlobAlignment - 1);
+    }
+
+private:
+
+    static AttributeRecord MakeRecord(const VertexFormat::Attribute& attribute) {
+        AttributeRecord record{};
+        record.count = attribute.count;
+        record.type = attribute.type;
+        record.normalized = attribute.normalized;
+        record.stride = static_cast<uint32_t>(attribute.stride);
+        record.offset = reinterpret_cast<uintptr_t>(attribute.pointer);
+        return record;
+    }
+};
@@ -5,9 +5,23 @@
 #include <vector>
 #include <algorithm>
 #include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
 #include <glm/glm.hpp>
 #include "../Core.h"
 #include "../Objects/Mesh.h"
+#include "../Objects/MeshOptimizer.h"
+#include "../Objects/MeshQuantizer.h"
+#include "../Objects/MeshSimplifier.h"
+#include "../Objects/MeshletBuilder.h"
+#include "File.h"
+#include "ObjParser.h"
+#include "MeshCache.h"
+#include "StreamingMeshImporter.h"
+#include "GltfLoader.h"
+#include "Hash.h"
 
 // **MeshFormat Enum**
 enum class MeshFormat {
@@ -22,6 +36,19 @@ struct PairHash {
     }
 };
 
+/// <summary>
+/// Timing of an OBJ parse, used to track loader throughput.
+/// </summary>
+struct MeshLoadStats {
+    size_t bytes = 0;
+    double milliseconds = 0.0;
+    unsigned threads = 0;
+
+    double MegabytesPerSecond() const {
+        return milliseconds > 0.0 ? (bytes / (1024.0 * 1024.0)) / (milliseconds / 1000.0) : 0.0;
+    }
+};
+
 /// **MeshLoader Class**
 class MeshLoader {
 public:
@@ -30,170 +57,308 @@ public:
     /// </summary>
     /// <param name="file">A pointer to a File object (must not be nullptr).</param>
     /// <param name="format">The mesh format (OBJ or GLTF).</param>
-    /// <param name="vertexFormat">Desired VertexFormat (e.g. PositionUv or PositionUvNormal).</param>
+    /// <param name="vertexFormat">Desired VertexFormat (e.g. PositionUv, PositionUvNormal or a compact
+    /// PositionUvNormalQuantized/PositionUvNormalHalf encoding).</param>
+    /// <param name="source">The file's bytes if they were already read, e.g. by AsyncFileReader; the file is viewed otherwise.</param>
     /// <returns>A Mesh instance with its buffers set up.</returns>
-    static Mesh LoadMesh(File* file, MeshFormat format, VertexFormat& vertexFormat) {
+    static Mesh LoadMesh(File* file, MeshFormat format, VertexFormat& vertexFormat, const FileView* source = nullptr) {
         if (!file) {
             std::cerr << "ERROR: Invalid file provided!" << std::endl;
             return Mesh();
         }
 
+        Mesh mesh;
         switch (format) {
             case MeshFormat::OBJ:
-                return LoadOBJMesh(*file, &vertexFormat);
+                mesh = LoadOBJMesh(*file, &vertexFormat, source);
+                break;
             case MeshFormat::GLTF:
-                std::cerr << "GLTF parser not implemented yet." << std::endl;
-                return Mesh();
+                mesh = GltfLoader::Load(*file, MeshQuantizer::GetSourceFormat(vertexFormat), 0, source);
+                FinalizeMesh(mesh, vertexFormat, file->getPath());
+                break;
             default:
                 std::cerr << "Unsupported mesh format." << std::endl;
                 return Mesh();
         }
+        return mesh;
+    }
+
+    static MeshLoadStats lastLoadStats;
+
+    /// When true, OBJ loads go through cooked .gmesh files next to the source (see MeshCache).
+    static bool useMeshCache;
+
+    /// When true, loaded meshes are reordered for vertex cache, overdraw and fetch (see MeshOptimizer).
+    static bool optimizeMeshes;
+
+    static MeshOptimizationStats lastOptimizationStats;
+
+    /// Prints how many meshes were optimized and the vertex cache statistics of the last one.
+    static void PrintOptimizationReport(std::ostream& out = std::cout) {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        out << "Mesh optimizer: " << meshesOptimized << " mesh(es) optimized";
+        if (meshesOptimized > 0) {
+            out << ", last " << lastOptimizedPath
+                << ": ACMR " << lastOptimizationStats.before.acmr << " -> " << lastOptimizationStats.after.acmr
+                << ", ATVR " << lastOptimizationStats.before.atvr << " -> " << lastOptimizationStats.after.atvr;
+        }
+        out << std::endl;
+    }
+
+    /// Triangle ratios of the generated levels of detail, e.g. { 0.5f, 0.25f, 0.125f } (see MeshSimplifier).
+    /// Empty disables LOD generation.
+    static std::vector<float> lodRatios;
+
+    /// OBJ files of at least this many bytes are imported with StreamingMeshImporter in bounded memory
+    /// and always go through a cooked .gmesh file. 0 disables streaming. Keep it at or above
+    /// AsyncFileReader::mapThreshold so that meshes loaded through AssetService are mapped rather than read whole.
+    static size_t streamingThreshold;
+
+    /// Memory ceiling and progress callback of streamed imports.
+    static StreamingImportOptions streamingOptions;
+
+    /// When true, loaded meshes are split into meshlets for cluster culling (see MeshletBuilder).
+    static bool buildMeshlets;
+
+    /// <summary>
+    /// Loads several meshes at once, one file per worker thread, so the expensive import steps
+    /// (LOD generation, optimization) run in parallel across meshes.
+    /// </summary>
+    /// <param name="files">Files to load; nullptr entries produce empty meshes.</param>
+    /// <param name="format">The mesh format shared by all files.</param>
+    /// <param name="vertexFormat">Desired VertexFormat.</param>
+    /// <param name="maxThreads">Worker count, 0 uses all hardware threads.</param>
+    /// <returns>The meshes in the order of the files.</returns>
+    static std::vector<Mesh> LoadMeshes(const std::vector<File*>& files, MeshFormat format, VertexFormat& vertexFormat,
+                                        unsigned maxThreads = 0) {
+        std::vector<Mesh> meshes(files.size());
+        unsigned threadCount = maxThreads ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+        threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, files.size()));
+
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t i = next++; i < files.size(); i = next++) {
+                if (files[i]) meshes[i] = LoadMesh(files[i], format, vertexFormat);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < threadCount; ++i) threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads) thread.join();
+        return meshes;
+    }
+
+    /// <summary>
+    /// Parses an OBJ file repeatedly and reports the average parser throughput in MB/s.
+    /// The file is mapped once so the numbers measure parsing, not disk access.
+    /// </summary>
+    /// <param name="file">A pointer to a File object (must not be nullptr).</param>
+    /// <param name="vertexFormat">VertexFormat to parse for.</param>
+    /// <param name="iterations">Number of timed parses.</param>
+    /// <returns>Accumulated statistics over all iterations.</returns>
+    static MeshLoadStats BenchmarkOBJ(File* file, const VertexFormat& vertexFormat, int iterations = 10) {
+        MeshLoadStats stats;
+        bool includeUV, includeNormals;
+        if (!file || !GetOBJComponents(vertexFormat, includeUV, includeNormals)) {
+            std::cerr << "ERROR: Invalid OBJ benchmark input!" << std::endl;
+            return stats;
+        }
+
+        FileView source = file->view();
+        if (!source.isOpen()) return stats;
+
+        ObjParser::Result result;
+        for (int i = 0; i < iterations; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            ObjParser::Parse(source.data(), source.size(), includeUV, includeNormals, result);
+            auto end = std::chrono::steady_clock::now();
+
+            stats.bytes += source.size();
+            stats.milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+            stats.threads = result.threadsUsed;
+        }
+
+        std::cout << "OBJ benchmark: " << file->getPath() << ", " << iterations << " iterations, "
+                  << stats.threads << " thread(s), " << stats.MegabytesPerSecond() << " MB/s" << std::endl;
+        return stats;
+    }
+
+    /// <summary>
+    /// True if an OBJ source of this size goes through the StreamingMeshImporter. It reads the file
+    /// from disk, so files packed in an archive are always parsed whole.
+    /// </summary>
+    static bool IsStreamed(const File& file, size_t size) {
+        return streamingThreshold > 0 && size >= streamingThreshold && !file.isArchived();
+    }
+
+    /// <summary>
+    /// Hashes a source file's bytes. Streamed sources are hashed block by block and each block is dropped
+    /// from memory afterwards, so hashing does not pull the whole file into resident memory.
+    /// </summary>
+    static uint64_t HashSource(const FileView& source, bool streaming) {
+        if (!streaming) return Hash::Bytes(source.data(), source.size());
+
+        constexpr size_t BlockSize = size_t(16) << 20;
+        uint64_t hash = 0;
+        for (size_t offset = 0; offset < source.size(); offset += BlockSize) {
+            size_t length = std::min(BlockSize, source.size() - offset);
+            hash = Hash::Bytes(source.data() + offset, length, hash);
+            source.evict(offset, length);
+        }
+        return hash;
     }
 
 private:
+    // Guards the last*Stats members and console output when meshes load on several threads
+    static std::mutex statsMutex;
+    static std::string lastOptimizedPath;
+    static size_t meshesOptimized;
+
+    static void OptimizeMesh(Mesh& mesh, const std::string& path) {
+        MeshOptimizationStats stats = MeshOptimizer::Optimize(mesh);
+        std::lock_guard<std::mutex> lock(statsMutex);
+        lastOptimizationStats = stats;
+        lastOptimizedPath = path;
+        ++meshesOptimized;
+    }
+
     /// <summary>
-    /// Loads an OBJ mesh from a File and builds a Mesh based on the desired VertexFormat.
+    /// Shared tail of every loader: builds the LOD chain, optimizes, builds meshlets, converts to a compact vertex encoding if one was
+    /// requested, switches to 16-bit indices whenever all indices fit and measures the UV density stored in cooked meshes.
+    /// </summary>
+    static void FinalizeMesh(Mesh& mesh, const VertexFormat& vertexFormat, const std::string& path) {
+        if (mesh.vertexDataSize == 0) return;
+        if (!lodRatios.empty() && MeshSimplifier::BuildLodChain(mesh, lodRatios)) {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            std::cout << "Built " << mesh.lods.size() - 1 << " LOD level(s) for " << path
+                      << ", coarsest error " << mesh.lods.back().error << std::endl;
+        }
+        if (optimizeMeshes) OptimizeMesh(mesh, path);
+        if (buildMeshlets) MeshletBuilder::Build(mesh);
+        if (MeshQuantizer::IsQuantized(vertexFormat) && !MeshQuantizer::Quantize(mesh, vertexFormat)) {
+            std::cerr << "WARNING: Unable to quantize mesh: " << path << std::endl;
+        }
+        mesh.CompactIndices();
+        mesh.ComputeUvDensity();
+    }
+
+    /// <summary>
+    /// Cooks an OBJ with StreamingMeshImporter and maps the result. Nothing but the importer's
+    /// bounded buffers is held in memory; the returned Mesh points into the cooked file.
     /// </summary>
-    static Mesh LoadOBJMesh(File &file, const VertexFormat *vertexFormat) {
-        // **Inclusion options for vertex components; adjust these as needed**
-        bool includePosition;
-        bool includeUV;
-        bool includeNormals;
-
-        if (*vertexFormat == VertexFormat::Position) {
-            includePosition = true;
+    static Mesh LoadStreamedOBJ(File& file, uint64_t sourceHash, uint64_t settings, const VertexFormat& vertexFormat,
+                                bool includeUV, bool includeNormals, size_t sourceSize) {
+        Mesh mesh;
+        auto start = std::chrono::steady_clock::now();
+        if (!StreamingMeshImporter::CookOBJ(file.getPath(), sourceHash, settings, vertexFormat, includeUV, includeNormals, streamingOptions) ||
+            !MeshCache::Load(file.getPath(), sourceHash, settings, vertexFormat, mesh)) {
+            std::cerr << "ERROR: Streaming import failed: " << file.getPath() << std::endl;
+            return Mesh();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        lastLoadStats.bytes = sourceSize;
+        lastLoadStats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+        lastLoadStats.threads = 1;
+        return mesh;
+    }
+
+    /// <summary>
+    /// Maps a VertexFormat to the OBJ components it consumes. Position is always included.
+    /// </summary>
+    static bool GetOBJComponents(const VertexFormat& vertexFormat, bool& includeUV, bool& includeNormals) {
+        if (vertexFormat == VertexFormat::Position) {
             includeUV = false;
             includeNormals = false;
-        } else if (*vertexFormat == VertexFormat::PositionUv) {
-            includePosition = true;
+        } else if (vertexFormat == VertexFormat::PositionUv) {
             includeUV = true;
             includeNormals = false;
-        } else if (*vertexFormat == VertexFormat::PositionUvNormal) {
-            includePosition = true;
+        } else if (vertexFormat == VertexFormat::PositionUvNormal || MeshQuantizer::IsQuantized(vertexFormat)) {
             includeUV = true;
             includeNormals = true;
+        } else {
+            return false;
         }
+        return true;
+    }
 
-        // *Read the entire file content*
-        std::string content = file.read();
-        std::istringstream stream(content);
-
-        // **Temporary storages for positions, UVs, and normals**
-        std::vector<glm::vec3> tempPositions;
-        std::vector<glm::vec2> tempUVs;
-        std::vector<glm::vec3> tempNormals;
+    /// <summary>
+    /// Loads an OBJ mesh from a File and builds a Mesh based on the desired VertexFormat.
+    /// The file is viewed in its mapping (see File::view), unless its contents were already read, and handed to
+    /// ObjParser without copying it into a string.
+    /// If a cooked .gmesh for the same source contents and format exists it is mapped instead,
+    /// otherwise one is written after parsing.
+    /// </summary>
+    static Mesh LoadOBJMesh(File &file, const VertexFormat *vertexFormat, const FileView* contents = nullptr) {
+        bool includeUV, includeNormals;
+        if (!GetOBJComponents(*vertexFormat, includeUV, includeNormals)) {
+            std::cerr << "Unsupported vertex format for OBJ meshes." << std::endl;
+            return Mesh();
+        }
 
-        // **Final buffers: vertex data (floats) and index data**
-        std::vector<float> vertexData;
-        std::vector<GLuint> indices;
+        FileView source = contents ? *contents : file.view();
+        if (!source.isOpen()) {
+            return Mesh();
+        }
 
-        // **Map for deduplication: key -> vertex index**
-        std::unordered_map<std::string, GLuint> vertexMap;
+        Mesh mesh;
+        uint64_t sourceHash = 0, settings = 0;
+        bool streaming = IsStreamed(file, source.size());
+        if (useMeshCache || streaming) {
+            // Meshes cooked with different optimization, LOD or streaming settings go to different files,
+            // and the settings are part of the key stored in them too
+            if (streaming) {
+                settings = Hash::Combine(0, 4);
+            } else {
+                settings = Hash::Combine(0, (optimizeMeshes ? 1 : 0) | (buildMeshlets ? 2 : 0));
+                settings = Hash::Combine(settings, Hash::Bytes(lodRatios.data(), lodRatios.size() * sizeof(float)));
+            }
+            sourceHash = Hash::Combine(HashSource(source, streaming), settings);
+            if (MeshCache::Load(file.getPath(), sourceHash, settings, *vertexFormat, mesh)) {
+                return mesh;
+            }
+        }
 
-        // **Calculate stride (number of floats per vertex)**
-        size_t stride = 0;
-        if (includePosition) stride += 3;
-        if (includeUV)       stride += 2;
-        if (includeNormals)  stride += 3;
+        if (streaming) {
+            return LoadStreamedOBJ(file, sourceHash, settings, *vertexFormat, includeUV, includeNormals, source.size());
+        }
 
-        std::string line;
-        while (std::getline(stream, line)) {
-            std::istringstream s(line);
-            std::string prefix;
-            s >> prefix;
+        auto start = std::chrono::steady_clock::now();
+        ObjParser::Result result;
+        ObjParser::Parse(source.data(), source.size(), includeUV, includeNormals, result);
+        auto end = std::chrono::steady_clock::now();
 
-            if (prefix == "v" && includePosition) {
-                // *Parse vertex positions*
-                glm::vec3 pos;
-                s >> pos.x >> pos.y >> pos.z;
-                tempPositions.push_back(pos);
-            }
-            else if (prefix == "vt" && includeUV) {
-                // *Parse UV coordinates*
-                glm::vec2 uv;
-                s >> uv.x >> uv.y;
-                tempUVs.push_back(uv);
-            }
-            else if (prefix == "vn" && includeNormals) {
-                // *Parse normals*
-                glm::vec3 norm;
-                s >> norm.x >> norm.y >> norm.z;
-                tempNormals.push_back(norm);
-            }
-            else if (prefix == "f") {
-                // **Parse face definitions**
-                std::vector<GLuint> faceIndices;
-                std::string vertexToken;
-                while (s >> vertexToken) {
-                    // *Replace '/' with space to ease parsing*
-                    std::replace(vertexToken.begin(), vertexToken.end(), '/', ' ');
-                    std::istringstream vertexStream(vertexToken);
-
-                    GLuint posIndex = 0, uvIndex = 0, normIndex = 0;
-                    if (includePosition) vertexStream >> posIndex;
-                    if (includeUV)       vertexStream >> uvIndex;
-                    if (includeNormals)  vertexStream >> normIndex;
-
-                    // **Convert from 1-based to 0-based indexing**
-                    if (includePosition && posIndex > 0) posIndex--;
-                    if (includeUV       && uvIndex > 0)   uvIndex--;
-                    if (includeNormals  && normIndex > 0)  normIndex--;
-
-                // **Retrieve the corresponding data or default to zero**
-                    glm::vec3 pos  = (includePosition && posIndex < tempPositions.size()) ? tempPositions[posIndex] : glm::vec3(0.0f);
-                    glm::vec2 uv   = (includeUV && uvIndex < tempUVs.size())         ? tempUVs[uvIndex]         : glm::vec2(0.0f);
-                    glm::vec3 norm = (includeNormals && normIndex < tempNormals.size())   ? tempNormals[normIndex]   : glm::vec3(0.0f);
-
-                    // **Generate a unique key based on enabled components**
-                    std::string key;
-                    if (includePosition)
-                        key += std::to_string(pos.x) + "_" + std::to_string(pos.y) + "_" + std::to_string(pos.z);
-                    if (includeUV)
-                        key += "_" + std::to_string(uv.x) + "_" + std::to_string(uv.y);
-                    if (includeNormals)
-                        key += "_" + std::to_string(norm.x) + "_" + std::to_string(norm.y) + "_" + std::to_string(norm.z);
-
-                    GLuint vertexIndex;
-                    auto it = vertexMap.find(key);
-                    if (it == vertexMap.end()) {
-                        // **Add a new vertex**
-                        vertexIndex = vertexData.size() / stride;
-                        if (includePosition) {
-                            vertexData.push_back(pos.x);
-                            vertexData.push_back(pos.y);
-                            vertexData.push_back(pos.z);
-                        }
-                        if (includeUV) {
-                            vertexData.push_back(uv.x);
-                            vertexData.push_back(uv.y);
-                        }
-                        if (includeNormals) {
-                            vertexData.push_back(norm.x);
-                            vertexData.push_back(norm.y);
-                            vertexData.push_back(norm.z);
-                        }
-                        vertexMap[key] = vertexIndex;
-                    } else {
-                        vertexIndex = it->second;
-                    }
-                    faceIndices.push_back(vertexIndex);
-                }
-
-                // **Triangulate the face (supports triangles, quads, etc.)**
-                if (faceIndices.size() >= 3) {
-                    for (size_t i = 1; i < faceIndices.size() - 1; ++i) {
-                        indices.push_back(faceIndices[0]);
-                        indices.push_back(faceIndices[i]);
-                        indices.push_back(faceIndices[i + 1]);
-                    }
-                }
-            }
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            lastLoadStats.bytes = source.size();
+            lastLoadStats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+            lastLoadStats.threads = result.threadsUsed;
         }
 
-        Mesh mesh;
-        mesh.SetVertexData(vertexData.data(), vertexData.size() * sizeof(float),
-            indices.data(), indices.size() * sizeof(GLuint), *vertexFormat, GL_STATIC_DRAW);
+        mesh.SetVertexData(result.vertexData.data(), result.vertexData.size() * sizeof(float),
+            result.indices.data(), result.indices.size() * sizeof(GLuint),
+            MeshQuantizer::GetSourceFormat(*vertexFormat), GL_STATIC_DRAW);
+
+        FinalizeMesh(mesh, *vertexFormat, file.getPath());
+
+        if (useMeshCache) {
+            MeshCache::Write(file.getPath(), sourceHash, settings, mesh);
+        }
 
         return mesh;
     }
 };
+
+MeshLoadStats MeshLoader::lastLoadStats;
+bool MeshLoader::useMeshCache = true;
+bool MeshLoader::optimizeMeshes = false;
+MeshOptimizationStats MeshLoader::lastOptimizationStats;
+std::string MeshLoader::lastOptimizedPath;
+size_t MeshLoader::meshesOptimized = 0;
+std::vector<float> MeshLoader::lodRatios;
+bool MeshLoader::buildMeshlets = false;
+size_t MeshLoader::streamingThreshold = 0;
+StreamingImportOptions MeshLoader::streamingOptions;
+std::mutex MeshLoader::statsMutex;
@@ -0,0 +1,406 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include <thread>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+/// **ObjParser Class**
+/// Parses Wavefront OBJ text straight out of a memory buffer (usually a FileView).
+/// Lines are never copied: numbers are read with std::from_chars, big files are split into
+/// line-aligned chunks that are parsed on separate threads, and face corners are deduplicated
+/// through open-addressing tables keyed on integer (pos, uv, normal) index tuples.
+/// The output matches the original istringstream based loader byte for byte.
+class ObjParser {
+public:
+    /// <summary>
+    /// Interleaved vertex data and triangle indices produced by Parse.
+    /// </summary>
+    struct Result {
+        std::vector<float> vertexData;
+        std::vector<GLuint> indices;
+        unsigned threadsUsed = 1;
+    };
+
+    /// Files smaller than this are parsed on the calling thread only.
+    static constexpr size_t MinChunkSize = 1 << 20;
+
+    /// <summary>
+    /// Parses an OBJ buffer into interleaved vertex data (position, then UV, then normal).
+    /// </summary>
+    /// <param name="data">Start of the OBJ text (does not need to be null terminated).</param>
+    /// <param name="size">Size of the text in bytes.</param>
+    /// <param name="includeUV">Whether texture coordinates are part of the vertex.</param>
+    /// <param name="includeNormals">Whether normals are part of the vertex.</param>
+    /// <param name="result">Receives the vertex and index data.</param>
+    /// <param name="maxThreads">Upper bound on worker threads, 0 uses the hardware concurrency.</param>
+    static void Parse(const char* data, size_t size, bool includeUV, bool includeNormals,
+                      Result& result, unsigned maxThreads = 0) {
+        result.vertexData.clear();
+        result.indices.clear();
+
+        // **Split the buffer into line-aligned chunks**
+        unsigned threadCount = maxThreads ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+        size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / MinChunkSize));
+
+        std::vector<Chunk> chunks(chunkCount);
+        size_t begin = 0;
+        for (size_t i = 0; i < chunkCount; ++i) {
+            size_t end = (i + 1 == chunkCount) ? size : std::max(begin, size * (i + 1) / chunkCount);
+            while (end < size && data[end - 1] != '\n') ++end;
+            chunks[i].begin = data + begin;
+            chunks[i].end = data + end;
+            begin = end;
+        }
+
+        // **Parse every chunk; chunk 0 runs on the calling thread**
+        std::vector<std::thread> workers;
+        workers.reserve(chunkCount - 1);
+        for (size_t i = 1; i < chunkCount; ++i) {
+            workers.emplace_back(ParseChunk, std::ref(chunks[i]), includeUV, includeNormals);
+        }
+        ParseChunk(chunks[0], includeUV, includeNormals);
+        for (auto& worker : workers) worker.join();
+        result.threadsUsed = static_cast<unsigned>(chunkCount);
+
+        Assemble(chunks, includeUV, includeNormals, result);
+    }
+
+private:
+    // Shares the line level readers so streamed imports parse exactly like Parse
+    friend class StreamingMeshImporter;
+
+    static constexpr uint32_t Missing = 0xFFFFFFFFu;
+
+    struct Face {
+        uint32_t firstCorner;
+        uint32_t cornerCount;
+        uint32_t positionsSeen;
+        uint32_t uvsSeen;
+        uint32_t normalsSeen;
+    };
+
+    struct Chunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> uvs;
+        std::vector<glm::vec3> normals;
+        std::vector<uint32_t> corners; // 3 zero-based indices per face corner
+        std::vector<Face> faces;
+    };
+
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    // *Reads a float the way `stream >> value` does; on failure the value is zero*
+    static bool ReadFloat(const char*& p, const char* end, float& value) {
+        while (p < end && IsSpace(*p)) ++p;
+        if (p < end && *p == '+') ++p;
+        auto [next, error] = std::from_chars(p, end, value);
+        if (error != std::errc()) {
+            value = 0.0f;
+            return false;
+        }
+        p = next;
+        return true;
+    }
+
+    // *Reads an unsigned index the way `stream >> GLuint` does, with '/' treated as whitespace*
+    static GLuint ReadIndex(const char*& p, const char* end, bool& failed) {
+        if (failed) return 0;
+        while (p < end && *p == '/') ++p;
+
+        bool negative = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negative = *p == '-';
+            ++p;
+        }
+
+        uint64_t value = 0;
+        auto [next, error] = std::from_chars(p, end, value);
+        if (error == std::errc::result_out_of_range || (error == std::errc() && value > 0xFFFFFFFFull)) {
+            failed = true;
+            return Missing;
+        }
+        if (error != std::errc()) {
+            failed = true;
+            return 0;
+        }
+        p = next;
+        // Like the iostream extractor, negative input wraps around for unsigned targets
+        return negative ? static_cast<GLuint>(0u - static_cast<uint32_t>(value)) : static_cast<GLuint>(value);
+    }
+
+    static void ParseChunk(Chunk& chunk, bool includeUV, bool includeNormals) {
+        const char* p = chunk.begin;
+        const char* end = chunk.end;
+
+        while (p < end) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!lineEnd) lineEnd = end;
+
+            // *Read the prefix token*
+            const char* s = p;
+            while (s < lineEnd && IsSpace(*s)) ++s;
+            const char* prefix = s;
+            while (s < lineEnd && !IsSpace(*s)) ++s;
+            size_t prefixLength = s - prefix;
+
+            if (prefixLength == 1 && prefix[0] == 'v') {
+                glm::vec3 pos(0.0f);
+                ReadFloat(s, lineEnd, pos.x) && ReadFloat(s, lineEnd, pos.y) && ReadFloat(s, lineEnd, pos.z);
+                chunk.positions.push_back(pos);
+            }
+            else if (prefixLength == 2 && prefix[0] == 'v' && prefix[1] == 't' && includeUV) {
+                glm::vec2 uv(0.0f);
+                ReadFloat(s, lineEnd, uv.x) && ReadFloat(s, lineEnd, uv.y);
+                chunk.uvs.push_back(uv);
+            }
+            else if (prefixLength == 2 && prefix[0] == 'v' && prefix[1] == 'n' && includeNormals) {
+                glm::vec3 norm(0.0f);
+                ReadFloat(s, lineEnd, norm.x) && ReadFloat(s, lineEnd, norm.y) && ReadFloat(s, lineEnd, norm.z);
+                chunk.normals.push_back(norm);
+            }
+            else if (prefixLength == 1 && prefix[0] == 'f') {
+                Face face;
+                face.firstCorner = static_cast<uint32_t>(chunk.corners.size() / 3);
+                face.positionsSeen = static_cast<uint32_t>(chunk.positions.size());
+                face.uvsSeen = static_cast<uint32_t>(chunk.uvs.size());
+                face.normalsSeen = static_cast<uint32_t>(chunk.normals.size());
+
+                while (true) {
+                    while (s < lineEnd && IsSpace(*s)) ++s;
+                    if (s == lineEnd) break;
+                    const char* tokenEnd = s;
+                    while (tokenEnd < lineEnd && !IsSpace(*tokenEnd)) ++tokenEnd;
+
+                    bool failed = false;
+                    GLuint posIndex = ReadIndex(s, tokenEnd, failed);
+                    GLuint uvIndex = includeUV ? ReadIndex(s, tokenEnd, failed) : 0;
+                    GLuint normIndex = includeNormals ? ReadIndex(s, tokenEnd, failed) : 0;
+
+                    // **Convert from 1-based to 0-based indexing**
+                    chunk.corners.push_back(posIndex > 0 ? posIndex - 1 : 0);
+                    chunk.corners.push_back(uvIndex > 0 ? uvIndex - 1 : 0);
+                    chunk.corners.push_back(normIndex > 0 ? normIndex - 1 : 0);
+                    s = tokenEnd;
+                }
+
+                face.cornerCount = static_cast<uint32_t>(chunk.corners.size() / 3) - face.firstCorner;
+                chunk.faces.push_back(face);
+            }
+
+            p = lineEnd + 1;
+        }
+    }
+
+    static uint64_t Mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /// <summary>
+    /// Maps a float to an integer that is equal for two floats exactly when std::to_string prints
+    /// them the same way ("%f", six decimals, round half to even, sign kept for negative zero).
+    /// The original loader deduplicated on those strings, so this keeps its merging behaviour
+    /// without formatting anything.
+    /// </summary>
+    static uint64_t FixedPointKey(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint64_t sign = bits >> 31;
+        uint32_t exponent = (bits >> 23) & 0xFF;
+        uint32_t mantissa = bits & 0x7FFFFF;
+
+        if (exponent == 0xFF && mantissa != 0) return (1ull << 63) | sign;   // nan / -nan
+        if (exponent >= 127 + 31) return (1ull << 62) | bits;               // inf and integral values
+
+        uint64_t scaled = (exponent ? (mantissa | 0x800000u) : mantissa) * 1000000ull;
+        int shift = static_cast<int>(exponent ? exponent : 1) - 127 - 23;
+        uint64_t q;
+        if (shift >= 0) {
+            q = scaled << shift;
+        } else if (-shift >= 63) {
+            q = 0;
+        } else {
+            int s = -shift;
+            q = scaled >> s;
+            uint64_t remainder = scaled & ((1ull << s) - 1);
+            uint64_t half = 1ull << (s - 1);
+            if (remainder > half || (remainder == half && (q & 1))) ++q;
+        }
+        return (q << 1) | sign;
+    }
+
+    static uint64_t VertexHash(const float* vertex, size_t stride) {
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (size_t i = 0; i < stride; ++i) h = Mix(h ^ FixedPointKey(vertex[i]));
+        return h;
+    }
+
+    static bool SameVertex(const float* a, const float* b, size_t stride) {
+        for (size_t i = 0; i < stride; ++i) {
+            if (FixedPointKey(a[i]) != FixedPointKey(b[i])) return false;
+        }
+        return true;
+    }
+
+    // **Open addressing table: resolved (pos, uv, normal) tuple -> vertex index**
+    struct CornerSlot {
+        uint32_t pos, uv, normal;
+        GLuint vertex;
+    };
+
+    // **Open addressing table: vertex value hash -> vertex index**
+    struct ValueSlot {
+        uint64_t hash;
+        GLuint vertex;
+    };
+
+    template<typename Slot, typename Hash>
+    static void Grow(std::vector<Slot>& table, Hash hashOf) {
+        std::vector<Slot> old(table.size() * 2, Slot{});
+        old.swap(table);
+        size_t mask = table.size() - 1;
+        for (auto& slot : table) slot.vertex = Missing;
+        for (const auto& slot : old) {
+            if (slot.vertex == Missing) continue;
+            size_t i = hashOf(slot) & mask;
+            while (table[i].vertex != Missing) i = (i + 1) & mask;
+            table[i] = slot;
+        }
+    }
+
+    static void Assemble(std::vector<Chunk>& chunks, bool includeUV, bool includeNormals, Result& result) {
+        size_t stride = 3 + (includeUV ? 2 : 0) + (includeNormals ? 3 : 0);
+
+        // **Stitch the per-chunk attribute streams together**
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> uvs;
+        std::vector<glm::vec3> normals;
+        size_t totalCorners = 0, totalPositions = 0, totalUVs = 0, totalNormals = 0;
+        for (const auto& chunk : chunks) {
+            totalCorners += chunk.corners.size() / 3;
+            totalPositions += chunk.positions.size();
+            totalUVs += chunk.uvs.size();
+            totalNormals += chunk.normals.size();
+        }
+        positions.reserve(totalPositions);
+        uvs.reserve(totalUVs);
+        normals.reserve(totalNormals);
+
+        // Tables are kept at most half full and start sized for a typical corner/vertex ratio
+        size_t capacity = 64;
+        while (capacity < totalCorners / 2) capacity <<= 1;
+        std::vector<CornerSlot> cornerTable(capacity, CornerSlot{0, 0, 0, Missing});
+        std::vector<ValueSlot> valueTable(capacity, ValueSlot{0, Missing});
+        size_t vertexCount = 0;
+        size_t cornerEntries = 0;
+
+        auto cornerHash = [](const CornerSlot& slot) {
+            return Mix((static_cast<uint64_t>(slot.pos) << 32 | slot.uv) ^ Mix(slot.normal));
+        };
+        auto valueHash = [](const ValueSlot& slot) { return slot.hash; };
+
+        result.vertexData.reserve(totalCorners / 2 * stride);
+        result.indices.reserve(totalCorners * 2);
+        std::vector<GLuint> faceIndices;
+
+        for (auto& chunk : chunks) {
+            uint32_t positionBase = static_cast<uint32_t>(positions.size());
+            uint32_t uvBase = static_cast<uint32_t>(uvs.size());
+            uint32_t normalBase = static_cast<uint32_t>(normals.size());
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+            for (const auto& face : chunk.faces) {
+                // Indices only resolve against attributes declared before the face
+                uint32_t positionsSeen = positionBase + face.positionsSeen;
+                uint32_t uvsSeen = uvBase + face.uvsSeen;
+                uint32_t normalsSeen = normalBase + face.normalsSeen;
+
+                faceIndices.clear();
+                for (uint32_t c = 0; c < face.cornerCount; ++c) {
+                    const uint32_t* corner = &chunk.corners[(face.firstCorner + c) * 3];
+                    CornerSlot key;
+                    key.pos = corner[0] < positionsSeen ? corner[0] : Missing;
+                    key.uv = !includeUV ? 0 : (corner[1] < uvsSeen ? corner[1] : Missing);
+                    key.normal = !includeNormals ? 0 : (corner[2] < normalsSeen ? corner[2] : Missing);
+
+                    // **Fast path: this index tuple was seen before**
+                    size_t mask = cornerTable.size() - 1;
+                    size_t i = cornerHash(key) & mask;
+                    while (cornerTable[i].vertex != Missing &&
+                           (cornerTable[i].pos != key.pos || cornerTable[i].uv != key.uv || cornerTable[i].normal != key.normal)) {
+                        i = (i + 1) & mask;
+                    }
+                    if (cornerTable[i].vertex != Missing) {
+                        faceIndices.push_back(cornerTable[i].vertex);
+                        continue;
+                    }
+
+                    // **Retrieve the corresponding data or default to zero**
+                    float vertex[8];
+                    size_t n = 0;
+                    glm::vec3 pos = key.pos != Missing ? positions[key.pos] : glm::vec3(0.0f);
+                    vertex[n++] = pos.x; vertex[n++] = pos.y; vertex[n++] = pos.z;
+                    if (includeUV) {
+                        glm::vec2 uv = key.uv != Missing ? uvs[key.uv] : glm::vec2(0.0f);
+                        vertex[n++] = uv.x; vertex[n++] = uv.y;
+                    }
+                    if (includeNormals) {
+                        glm::vec3 norm = key.normal != Missing ? normals[key.normal] : glm::vec3(0.0f);
+                        vertex[n++] = norm.x; vertex[n++] = norm.y; vertex[n++] = norm.z;
+                    }
+
+                    // **Different tuples may still describe an identical vertex**
+                    uint64_t hash = VertexHash(vertex, stride);
+                    size_t valueMask = valueTable.size() - 1;
+                    size_t j = hash & valueMask;
+                    while (valueTable[j].vertex != Missing &&
+                           (valueTable[j].hash != hash ||
+                            !SameVertex(&result.vertexData[valueTable[j].vertex * stride], vertex, stride))) {
+                        j = (j + 1) & valueMask;
+                    }
+
+                    GLuint vertexIndex;
+                    if (valueTable[j].vertex != Missing) {
+                        vertexIndex = valueTable[j].vertex;
+                    } else {
+                        vertexIndex = static_cast<GLuint>(vertexCount++);
+                        result.vertexData.insert(result.vertexData.end(), vertex, vertex + stride);
+                        valueTable[j] = ValueSlot{hash, vertexIndex};
+                        if (vertexCount * 2 > valueTable.size()) Grow(valueTable, valueHash);
+                    }
+
+                    key.vertex = vertexIndex;
+                    cornerTable[i] = key;
+                    if (++cornerEntries * 2 > cornerTable.size()) Grow(cornerTable, cornerHash);
+                    faceIndices.push_back(vertexIndex);
+                }
+
+                // **Triangulate the face (supports triangles, quads, etc.)**
+                if (faceIndices.size() >= 3) {
+                    for (size_t k = 1; k < faceIndices.size() - 1; ++k) {
+                        result.indices.push_back(faceIndices[0]);
+                        result.indices.push_back(faceIndices[k]);
+                        result.indices.push_back(faceIndices[k + 1]);
+                    }
+                }
+            }
+
+            // Release chunk memory as soon as it has been merged
+            chunk = Chunk();
+        }
+    }
+};
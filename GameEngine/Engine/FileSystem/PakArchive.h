@@ -0,0 +1,440 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
+#include "MappedFile.h"
+#include "Hash.h"
+#include "Lz4.h"
+
+#ifdef PAK_ZSTD
+#include <zstd.h>
+#endif
+
+/// <summary>
+/// How the bytes of an archive entry are stored. Zstd entries need the engine built with PAK_ZSTD.
+/// </summary>
+enum class PakCompression : uint32_t {
+    None,
+    LZ4,
+    Zstd
+};
+
+/// **PakArchive Class**
+/// Many asset files packed into one, so loading them costs one open and one mapping instead of one per file.
+/// The archive is mapped whole. Its table of contents is sorted by path, so lookups are a binary search
+/// straight out of the mapping. Entries are stored raw or compressed in independent blocks of BlockSize
+/// bytes, which large entries decompress on several threads.
+///
+/// Layout: Header, Entry[entryCount], the entry paths back to back, then the entry data. Compressed data
+/// starts with blockCount + 1 offsets (relative to the entry) delimiting its blocks.
+///
+/// Mounted archives are searched by File::find and File::read before the filesystem, newest mount first.
+class PakArchive {
+public:
+    static constexpr uint32_t Version = 1;
+    static constexpr uint32_t DefaultBlockSize = 256 * 1024;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t blockSize;
+        uint64_t entriesOffset;
+        uint64_t namesOffset;
+    };
+    static_assert(std::is_trivially_copyable_v<Header>, "Header is written to disk as raw bytes");
+
+    struct Entry {
+        uint64_t nameOffset;  // Into the path block, relative to namesOffset
+        uint32_t nameLength;
+        uint32_t compression; // PakCompression
+        uint64_t offset;      // Of the stored bytes, from the start of the archive
+        uint64_t storedSize;
+        uint64_t size;        // Once decompressed
+        uint64_t contentHash; // Hash::Bytes of the decompressed bytes
+    };
+    static_assert(sizeof(Entry) == 48, "Entry is 48 bytes on disk");
+
+    /// <summary>
+    /// Maps an archive and checks its table of contents. On failure the archive is left empty; check isOpen().
+    /// </summary>
+    explicit PakArchive(const std::string& path) : archivePath(path) {
+        if (!mapping.open(path)) return;
+        if (!Validate()) {
+            std::cerr << "ERROR: Invalid asset archive: " << path << std::endl;
+            mapping.close();
+        }
+    }
+
+    bool isOpen() const { return mapping.isOpen(); }
+    const std::string& getPath() const { return archivePath; }
+    const MappedFile& getMapping() const { return mapping; }
+    size_t entryCount() const { return header.entryCount; }
+    const Entry& entryAt(size_t index) const { return entries()[index]; }
+
+    /// <summary>
+    /// Path of an entry as stored (see NormalizeName).
+    /// </summary>
+    std::string_view getName(const Entry& entry) const {
+        return std::string_view(mapping.data() + header.namesOffset + entry.nameOffset, entry.nameLength);
+    }
+
+    /// <summary>
+    /// Looks up an entry by path, spelled as it would be relative to the working directory.
+    /// </summary>
+    /// <returns>The entry, or nullptr if the archive does not contain the file.</returns>
+    const Entry* find(std::string_view path) const {
+        std::string name = NormalizeName(path);
+        const Entry* first = entries();
+        const Entry* last = first + header.entryCount;
+        const Entry* found = std::lower_bound(first, last, name, [this](const Entry& entry, const std::string& key) {
+            return getName(entry) < std::string_view(key);
+        });
+        return found != last && getName(*found) == name ? found : nullptr;
+    }
+
+    static bool IsCompressed(const Entry& entry) {
+        return static_cast<PakCompression>(entry.compression) != PakCompression::None;
+    }
+
+    /// <summary>
+    /// The stored bytes of an uncompressed entry, inside the mapping; empty for compressed entries.
+    /// </summary>
+    std::string_view getRawView(const Entry& entry) const {
+        if (IsCompressed(entry)) return {};
+        return std::string_view(mapping.data() + entry.offset, entry.size);
+    }
+
+    /// <summary>
+    /// Decompresses an entry into a buffer of entry.size bytes, spreading its blocks over up to maxThreads threads.
+    /// </summary>
+    /// <returns>False if the entry is corrupt or uses a compression this build does not support.</returns>
+    bool extract(const Entry& entry, char* destination, unsigned maxThreads = 0) const {
+        const char* stored = mapping.data() + entry.offset;
+        PakCompression compression = static_cast<PakCompression>(entry.compression);
+        if (compression == PakCompression::None) {
+            if (entry.size > 0) std::memcpy(destination, stored, entry.size);
+            return true;
+        }
+
+        size_t blockCount = BlockCount(entry.size, header.blockSize);
+        if ((blockCount + 1) * sizeof(uint64_t) > entry.storedSize) return false;
+        std::vector<uint64_t> blockOffsets(blockCount + 1);
+        std::memcpy(blockOffsets.data(), stored, blockOffsets.size() * sizeof(uint64_t));
+        if (blockOffsets.back() > entry.storedSize) return false;
+
+        std::atomic<bool> valid = true;
+        ForEachBlock(blockCount, maxThreads, [&](size_t block) {
+            uint64_t begin = blockOffsets[block];
+            uint64_t end = blockOffsets[block + 1];
+            size_t outputOffset = block * header.blockSize;
+            size_t outputSize = std::min<size_t>(header.blockSize, entry.size - outputOffset);
+            if (begin > end || !DecompressBlock(compression, stored + begin, end - begin, destination + outputOffset, outputSize)) {
+                valid = false;
+            }
+        });
+        if (!valid) std::cerr << "ERROR: Corrupt entry " << getName(entry) << " in archive: " << archivePath << std::endl;
+        return valid;
+    }
+
+    /// <summary>
+    /// Reads a whole entry into a string; empty if it is corrupt.
+    /// </summary>
+    std::string read(const Entry& entry) const {
+        std::string contents(entry.size, '\0');
+        if (!extract(entry, contents.data())) return "";
+        return contents;
+    }
+
+    /// <summary>
+    /// Mounts an archive so File resolves the paths it contains from it. Later mounts take precedence.
+    /// </summary>
+    /// <returns>False if the archive cannot be opened.</returns>
+    static bool Mount(const std::string& path) {
+        auto archive = std::make_shared<PakArchive>(path);
+        if (!archive->isOpen()) {
+            std::cerr << "ERROR: Unable to mount asset archive: " << path << std::endl;
+            return false;
+        }
+        std::unique_lock<std::shared_mutex> lock(mountMutex);
+        mounted.insert(mounted.begin(), std::move(archive));
+        return true;
+    }
+
+    /// <summary>
+    /// Unmounts an archive. Files already resolved from it keep it mapped until they are done with it.
+    /// </summary>
+    static void Unmount(const std::string& path) {
+        std::unique_lock<std::shared_mutex> lock(mountMutex);
+        mounted.erase(std::remove_if(mounted.begin(), mounted.end(), [&path](const auto& archive) {
+            return archive->getPath() == path;
+        }), mounted.end());
+    }
+
+    /// <summary>
+    /// Finds a path in the mounted archives, newest mount first. Thread safe.
+    /// </summary>
+    /// <param name="path">The path as passed to File::find.</param>
+    /// <param name="archive">Receives the archive holding the entry, which keeps the entry valid.</param>
+    /// <returns>The entry, or nullptr if no mounted archive contains the path.</returns>
+    static const Entry* FindMounted(std::string_view path, std::shared_ptr<const PakArchive>& archive) {
+        std::shared_lock<std::shared_mutex> lock(mountMutex);
+        for (const auto& candidate : mounted) {
+            if (const Entry* entry = candidate->find(path)) {
+                archive = candidate;
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    /// <summary>
+    /// Path as stored in archives: relative to the working directory, normalized, with forward slashes.
+    /// </summary>
+    static std::string NormalizeName(std::string_view path) {
+        std::filesystem::path name(path);
+        if (name.is_absolute()) {
+            std::error_code error;
+            std::filesystem::path relative = name.lexically_relative(std::filesystem::current_path(error));
+            if (!error && !relative.empty()) name = relative;
+        }
+        std::string normalized = name.lexically_normal().generic_string();
+        return normalized.rfind("./", 0) == 0 ? normalized.substr(2) : normalized;
+    }
+
+    /// <summary>
+    /// Packs every file below a directory into an archive, except the caches the engine writes next to the
+    /// assets (.gmesh, .ktx2, .glprog and their .tmp files). Entries are named by their path relative to the
+    /// working directory, e.g. "Assets/Shaders/Test.vert" when packing "Assets", so the archive answers the
+    /// same paths as the loose files. Entries that do not shrink by at least 1/16 are stored raw. The file is
+    /// written under a temporary name and renamed into place.
+    /// </summary>
+    /// <returns>False if a file could not be read or the archive could not be written.</returns>
+    static bool Build(const std::string& archivePath, const std::string& directory,
+                      PakCompression compression = PakCompression::LZ4, uint32_t blockSize = DefaultBlockSize) {
+#ifndef PAK_ZSTD
+        if (compression == PakCompression::Zstd) {
+            std::cerr << "ERROR: Zstd asset archives need a build with PAK_ZSTD" << std::endl;
+            return false;
+        }
+#endif
+        std::vector<std::string> names;
+        std::error_code error;
+        for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+             !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if (it->is_regular_file() && !IsCacheFile(it->path())) names.push_back(NormalizeName(it->path().generic_string()));
+        }
+        if (error) {
+            std::cerr << "ERROR: Unable to list asset directory: " << directory << std::endl;
+            return false;
+        }
+        std::sort(names.begin(), names.end());
+
+        Header header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.entryCount = static_cast<uint32_t>(names.size());
+        header.blockSize = blockSize;
+        header.entriesOffset = sizeof(Header);
+        header.namesOffset = header.entriesOffset + names.size() * sizeof(Entry);
+
+        std::vector<Entry> table(names.size());
+        uint64_t namesSize = 0;
+        for (size_t i = 0; i < names.size(); ++i) {
+            table[i].nameOffset = namesSize;
+            table[i].nameLength = static_cast<uint32_t>(names[i].size());
+            namesSize += names[i].size();
+        }
+
+        std::string tempPath = archivePath + ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "ERROR: Unable to write asset archive: " << archivePath << std::endl;
+                return false;
+            }
+
+            // The table is written last, once the entry offsets are known
+            std::vector<char> placeholder(header.namesOffset, 0);
+            out.write(placeholder.data(), placeholder.size());
+            for (const std::string& name : names) out.write(name.data(), name.size());
+
+            uint64_t offset = header.namesOffset + namesSize;
+            for (size_t i = 0; i < names.size(); ++i) {
+                MappedFile source(names[i]);
+                if (!source.isOpen()) {
+                    out.close();
+                    std::remove(tempPath.c_str());
+                    return false;
+                }
+
+                Entry& entry = table[i];
+                entry.size = source.size();
+                entry.contentHash = Hash::Bytes(source.data(), source.size());
+                std::vector<char> stored = compression == PakCompression::None
+                    ? std::vector<char>() : CompressEntry(source, compression, blockSize);
+
+                // Offsets are 8-byte aligned so raw entries can be read in place as any scalar type
+                uint64_t aligned = (offset + 7) / 8 * 8;
+                out.write(Padding, aligned - offset);
+                entry.offset = aligned;
+                if (!stored.empty() && stored.size() <= source.size() - source.size() / 16) {
+                    entry.compression = static_cast<uint32_t>(compression);
+                    entry.storedSize = stored.size();
+                    out.write(stored.data(), stored.size());
+                } else {
+                    entry.compression = static_cast<uint32_t>(PakCompression::None);
+                    entry.storedSize = source.size();
+                    out.write(source.data(), source.size());
+                }
+                offset = aligned + entry.storedSize;
+            }
+
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Entry));
+            if (!out) {
+                std::cerr << "ERROR: Unable to write asset archive: " << archivePath << std::endl;
+                out.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tempPath, archivePath, error);
+        if (error) {
+            std::cerr << "ERROR: Unable to write asset archive: " << archivePath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr char Magic[4] = { 'G', 'P', 'A', 'K' };
+    static constexpr char Padding[8] = {};
+
+    std::string archivePath;
+    MappedFile mapping;
+    Header header{};
+
+    static std::vector<std::shared_ptr<const PakArchive>> mounted;
+    static std::shared_mutex mountMutex;
+
+    const Entry* entries() const {
+        return reinterpret_cast<const Entry*>(mapping.data() + header.entriesOffset);
+    }
+
+    // Checks that the header, table and every entry lie inside the mapping, so lookups need no bounds checks
+    bool Validate() {
+        if (mapping.size() < sizeof(Header)) return false;
+        std::memcpy(&header, mapping.data(), sizeof(Header));
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.blockSize == 0) return false;
+        // Sizes are compared against what is left after an offset, so crafted values cannot wrap around
+        uint64_t size = mapping.size();
+        if (header.entriesOffset % alignof(Entry) != 0 || header.namesOffset > size || header.entriesOffset > header.namesOffset ||
+            static_cast<uint64_t>(header.entryCount) * sizeof(Entry) > header.namesOffset - header.entriesOffset) return false;
+
+        uint64_t namesSize = size - header.namesOffset;
+        for (uint32_t i = 0; i < header.entryCount; ++i) {
+            const Entry& entry = entries()[i];
+            if (entry.nameOffset > namesSize || entry.nameLength > namesSize - entry.nameOffset ||
+                entry.offset > size || entry.storedSize > size - entry.offset || entry.compression > static_cast<uint32_t>(PakCompression::Zstd) ||
+                (entry.compression == static_cast<uint32_t>(PakCompression::None) && entry.storedSize != entry.size)) return false;
+            if (i > 0 && !(getName(entries()[i - 1]) < getName(entry))) return false;
+        }
+        return true;
+    }
+
+    // Caches the engine writes next to the assets (see MeshCache, TextureCache, ProgramCache), and their temporary files
+    static bool IsCacheFile(const std::filesystem::path& path) {
+        std::string extension = path.extension().string();
+        return extension == ".gmesh" || extension == ".ktx2" || extension == ".glprog" || extension == ".tmp";
+    }
+
+    static size_t BlockCount(uint64_t size, uint32_t blockSize) {
+        return static_cast<size_t>((size + blockSize - 1) / blockSize);
+    }
+
+    // Block offset table followed by the compressed blocks
+    static std::vector<char> CompressEntry(const MappedFile& source, PakCompression compression, uint32_t blockSize) {
+        size_t blockCount = BlockCount(source.size(), blockSize);
+        std::vector<std::vector<char>> blocks(blockCount);
+        ForEachBlock(blockCount, 0, [&](size_t block) {
+            size_t begin = block * blockSize;
+            size_t size = std::min<size_t>(blockSize, source.size() - begin);
+            blocks[block] = CompressBlock(compression, source.data() + begin, size);
+        });
+
+        std::vector<char> stored((blockCount + 1) * sizeof(uint64_t));
+        uint64_t offset = stored.size();
+        for (size_t block = 0; block <= blockCount; ++block) {
+            std::memcpy(stored.data() + block * sizeof(uint64_t), &offset, sizeof(uint64_t));
+            if (block < blockCount) offset += blocks[block].size();
+        }
+        for (const auto& block : blocks) stored.insert(stored.end(), block.begin(), block.end());
+        return stored;
+    }
+
+    static std::vector<char> CompressBlock(PakCompression compression, const char* data, size_t size) {
+        std::vector<char> block;
+        if (compression == PakCompression::Zstd) {
+#ifdef PAK_ZSTD
+            block.resize(ZSTD_compressBound(size));
+            size_t written = ZSTD_compress(block.data(), block.size(), data, size, 3);
+            block.resize(ZSTD_isError(written) ? 0 : written);
+#endif
+            return block; // Build refuses Zstd without PAK_ZSTD
+        }
+        block.resize(Lz4::CompressBound(size));
+        block.resize(Lz4::Compress(data, size, block.data()));
+        return block;
+    }
+
+    static bool DecompressBlock(PakCompression compression, const char* data, size_t size, char* destination, size_t decompressedSize) {
+        if (compression == PakCompression::LZ4) return Lz4::Decompress(data, size, destination, decompressedSize);
+#ifdef PAK_ZSTD
+        if (compression == PakCompression::Zstd) {
+            size_t written = ZSTD_decompress(destination, decompressedSize, data, size);
+            return !ZSTD_isError(written) && written == decompressedSize;
+        }
+#endif
+        return false;
+    }
+
+    // Runs work(block) for every block, on up to maxThreads threads (0 for one per core)
+    template <typename Work>
+    static void ForEachBlock(size_t blockCount, unsigned maxThreads, const Work& work) {
+        unsigned threadCount = maxThreads ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+        threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, blockCount));
+        if (threadCount <= 1) {
+            for (size_t block = 0; block < blockCount; ++block) work(block);
+            return;
+        }
+
+        std::atomic<size_t> next = 0;
+        auto worker = [&]() {
+            for (size_t block = next++; block < blockCount; block = next++) work(block);
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threadCount; ++t) workers.emplace_back(worker);
+        worker();
+        for (auto& thread : workers) thread.join();
+    }
+};
+
+std::vector<std::shared_ptr<const PakArchive>> PakArchive::mounted;
+std::shared_mutex PakArchive::mountMutex;
@@ -0,0 +1,230 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <type_traits>
+#include <initializer_list>
+#include <chrono>
+#include <algorithm>
+#include "../Core.h"
+#include "MappedFile.h"
+#include "File.h"
+#include "Hash.h"
+
+/// <summary>
+/// Program binary cache hits and misses since startup. Render thread only.
+/// </summary>
+struct ProgramCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;            // No binary, or one built from other sources, defines or another driver
+    size_t rejected = 0;          // Binaries the driver refused, e.g. after a driver update that kept its version string
+    double millisecondsSaved = 0; // Compile and link time of the cached programs, minus the time to load them
+
+    double HitRate() const {
+        size_t total = hits + misses + rejected;
+        return total ? static_cast<double>(hits) / total : 0.0;
+    }
+};
+
+/// **ProgramCache Class**
+/// Linked shader programs cached with glGetProgramBinary next to their vertex shader, e.g.
+/// "Test.vert.1a2b3c4d.glprog" where the tag is the hash of the fragment shader's path and of the variant's
+/// defines. A binary is keyed by the hash of the shader sources and defines and of the GL vendor, renderer and
+/// version, so editing a shader or changing the driver rebuilds it. The driver may still reject a binary it wrote, in which case the
+/// program is compiled from source again.
+class ProgramCache {
+public:
+    static constexpr uint32_t Version = 1;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t binaryFormat;
+        uint32_t binaryLength;
+        double compileMilliseconds; // Time the program took to build from source
+    };
+    static_assert(std::is_trivially_copyable_v<Header>, "Header is written to disk as raw bytes");
+
+    /// <summary>
+    /// A cached binary read from disk, to be handed to Load on the render thread.
+    /// </summary>
+    struct Binary {
+        Header header{};
+        std::vector<char> data;
+    };
+
+    /// Set to false to always compile from source, e.g. to compare startup times.
+    static bool enabled;
+
+    static ProgramCacheStats stats;
+
+    /// <summary>
+    /// Path of the cached binary of the program linked from a vertex and a fragment shader.
+    /// </summary>
+    /// <param name="variantKey">Defines of the variant (see ShaderPreprocessor::VariantKey); each variant has its own binary.</param>
+    static std::string GetCachePath(const std::string& vertexPath, const std::string& fragmentPath, std::string_view variantKey = {}) {
+        uint64_t hash = Hash::String(File::canonicalPath(fragmentPath));
+        if (!variantKey.empty()) hash = Hash::String(variantKey, hash);
+        char tag[9];
+        std::snprintf(tag, sizeof(tag), "%08x", static_cast<uint32_t>(hash));
+        return vertexPath + "." + tag + ".glprog";
+    }
+
+    /// <summary>
+    /// Key of a program built from the given sources and defines with the current driver. Render thread only.
+    /// </summary>
+    static uint64_t Key(std::initializer_list<std::string_view> sources, std::string_view defines = {}) {
+        uint64_t key = Hash::String(defines, Hash::Combine(GetDriverHash(), Version));
+        for (std::string_view source : sources) key = Hash::String(source, Hash::Mix(key));
+        return key;
+    }
+
+    /// <summary>
+    /// Reads a cached binary. Does no GL calls, so it can run on a loader thread.
+    /// </summary>
+    /// <returns>False if there is no cache file or it is malformed.</returns>
+    static bool Read(const std::string& cachePath, Binary& binary) {
+        if (!enabled || !File::isRegularFile(cachePath)) return false;
+
+        MappedFile mapping(cachePath);
+        if (!mapping.isOpen() || mapping.size() < sizeof(Header)) return false;
+        std::memcpy(&binary.header, mapping.data(), sizeof(Header));
+        const Header& header = binary.header;
+        if (std::memcmp(header.magic, "GPRG", 4) != 0 || header.version != Version ||
+            header.binaryLength == 0 || header.binaryLength != mapping.size() - sizeof(Header)) {
+            std::cerr << "WARNING: Corrupt program cache ignored: " << cachePath << std::endl;
+            return false;
+        }
+        binary.data.assign(mapping.data() + sizeof(Header), mapping.data() + mapping.size());
+        return true;
+    }
+
+    /// <summary>
+    /// Loads a cached binary into a new program with glProgramBinary. Render thread only.
+    /// </summary>
+    /// <param name="binary">The binary from Read, or an empty one if there was none.</param>
+    /// <param name="key">Key of the sources the program is wanted for.</param>
+    /// <returns>False if the binary is missing, stale or rejected; the program must then be built from source.</returns>
+    static bool Load(const Binary& binary, uint64_t key, ShaderProgram& program) {
+        if (!enabled || binary.data.empty() || binary.header.key != key) {
+            ++stats.misses;
+            return false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        glProgramBinary(program.ID, binary.header.binaryFormat, binary.data.data(), static_cast<GLsizei>(binary.data.size()));
+        GLint success = GL_FALSE;
+        glGetProgramiv(program.ID, GL_LINK_STATUS, &success);
+        if (!success) {
+            ++stats.rejected;
+            return false;
+        }
+
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        ++stats.hits;
+        stats.millisecondsSaved += std::max(0.0, binary.header.compileMilliseconds - milliseconds);
+        return true;
+    }
+
+    /// <summary>
+    /// Writes the binary of a linked program. The program must have been linked with
+    /// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set (see PrepareForCaching). Render thread only.
+    /// </summary>
+    /// <returns>False if the driver has no binary formats or the file could not be written.</returns>
+    static bool Write(const std::string& cachePath, uint64_t key, const ShaderProgram& program, double compileMilliseconds) {
+        if (!enabled || !SupportsBinaries()) return false;
+
+        GLint length = 0;
+        glGetProgramiv(program.ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return false;
+
+        Header header{};
+        std::memcpy(header.magic, "GPRG", 4);
+        header.version = Version;
+        header.key = key;
+        header.compileMilliseconds = compileMilliseconds;
+        std::vector<char> data(static_cast<size_t>(length));
+        GLenum format = 0;
+        glGetProgramBinary(program.ID, length, &length, &format, data.data());
+        if (length <= 0) return false;
+        header.binaryFormat = format;
+        header.binaryLength = static_cast<uint32_t>(length);
+
+        std::string tempPath = File::tempPath(cachePath);
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "WARNING: Unable to write program cache: " << cachePath << std::endl;
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            out.write(data.data(), header.binaryLength);
+            if (!out) {
+                std::cerr << "WARNING: Unable to write program cache: " << cachePath << std::endl;
+                out.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error) {
+            std::cerr << "WARNING: Unable to write program cache: " << cachePath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Asks the driver to keep the binary of a program that is about to be linked, so Write can read it back.
+    /// </summary>
+    static void PrepareForCaching(const ShaderProgram& program) {
+        if (enabled && SupportsBinaries()) glProgramParameteri(program.ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    /// Prints the hit rate and the compile time saved.
+    static void PrintReport(std::ostream& out = std::cout) {
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << "Program cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.rejected << " rejected ("
+            << std::fixed << std::setprecision(1) << stats.HitRate() * 100.0 << "% hit rate), "
+            << std::setprecision(2) << stats.millisecondsSaved << " ms of compiling saved" << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    static bool SupportsBinaries() {
+        static const bool supported = []() {
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            return formats > 0;
+        }();
+        return supported;
+    }
+
+    static uint64_t GetDriverHash() {
+        static const uint64_t hash = []() {
+            uint64_t h = 0;
+            for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION }) {
+                const GLubyte* value = glGetString(name);
+                h = Hash::String(value ? reinterpret_cast<const char*>(value) : "", Hash::Mix(h));
+            }
+            return h;
+        }();
+        return hash;
+    }
+};
+
+bool ProgramCache::enabled = true;
+ProgramCacheStats ProgramCache::stats;
@@ -0,0 +1,169 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include "File.h"
+
+/**
+ * @class ShaderPreprocessor
+ * @brief Resolves #include directives in GLSL sources and injects the #defines of a shader variant.
+ *
+ * `#include "path"` is resolved relative to the including file, through File::find so that shaders in mounted
+ * archives can include each other. Every file is included at most once per shader, which also breaks include
+ * cycles. `#line` directives keep compiler messages pointing at the original lines; their source string
+ * number is the index of the file in the list returned by Process, where 0 is the shader itself.
+ * Does no GL calls, so it can run on a loader thread.
+ */
+class ShaderPreprocessor {
+public:
+    /**
+     * @brief Builds the key of a variant from its defines, so the same set in any order gives the same key.
+     *
+     * @param defines Defines as "NAME" or "NAME=VALUE".
+     * @return The sorted, deduplicated defines, one per line; empty for the default variant.
+     */
+    static std::string VariantKey(std::vector<std::string> defines) {
+        std::sort(defines.begin(), defines.end());
+        defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+        std::string key;
+        for (const std::string& define : defines) {
+            if (define.empty()) continue;
+            key += define;
+            key += '\n';
+        }
+        return key;
+    }
+
+    /**
+     * @brief Expands the includes of a shader and inserts the defines of a variant after its #version line.
+     *
+     * @param path Path of the shader, which relative includes are resolved against.
+     * @param source Source text of the shader.
+     * @param variantKey Defines of the variant, see VariantKey.
+     * @param output Receives the source to compile.
+     * @param files If given, receives the path of the shader followed by the paths of the files it includes.
+     * @return False if an included file is missing.
+     */
+    static bool Process(const std::string& path, std::string_view source, std::string_view variantKey, std::string& output,
+                        std::vector<std::string>* files = nullptr) {
+        std::vector<std::string> included = { path };
+        std::unordered_set<std::string> seen = { File::canonicalPath(path) };
+        output.clear();
+        output.reserve(source.size() + variantKey.size() * 2);
+
+        // The defines go right after #version, which must stay the first directive
+        size_t versionEnd = 0;
+        size_t linesBefore = 0;
+        ForEachLine(source, [&](std::string_view line, size_t number, size_t end) {
+            if (versionEnd == 0 && StartsWithDirective(line, "#version")) {
+                versionEnd = end;
+                linesBefore = number + 1;
+            }
+        });
+        output.append(source.substr(0, versionEnd));
+        if (versionEnd > 0 && output.back() != '\n') output += '\n';
+        AppendDefines(variantKey, output);
+        output += "#line " + std::to_string(linesBefore + 1) + " 0\n";
+
+        bool success = Expand(path, source.substr(versionEnd), linesBefore, 0, output, included, seen);
+        if (files) *files = std::move(included);
+        return success;
+    }
+
+    /**
+     * @brief Lists the files a shader includes, directly or through other includes, e.g. to watch them for changes.
+     *
+     * @param path Path of the shader.
+     * @return The paths of the included files, without the shader itself.
+     */
+    static std::vector<std::string> ListIncludes(const std::string& path) {
+        std::vector<std::string> files;
+        const File* file = File::find(path);
+        if (!file) return files;
+        FileView contents = file->view();
+        std::string output;
+        Process(path, contents.text(), {}, output, &files);
+        if (!files.empty()) files.erase(files.begin());
+        return files;
+    }
+
+private:
+    // Calls visit(line, index, end) for each line, with the zero based line index and the offset past its newline
+    template <typename Visit>
+    static void ForEachLine(std::string_view text, Visit&& visit) {
+        size_t start = 0;
+        for (size_t number = 0; start < text.size(); ++number) {
+            size_t newline = text.find('\n', start);
+            size_t end = newline == std::string_view::npos ? text.size() : newline + 1;
+            visit(text.substr(start, end - start), number, end);
+            start = end;
+        }
+    }
+
+    static bool StartsWithDirective(std::string_view line, std::string_view directive) {
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string_view::npos || line.substr(first, directive.size()) != directive) return false;
+        char next = first + directive.size() < line.size() ? line[first + directive.size()] : '\n';
+        return next == ' ' || next == '\t' || next == '\r' || next == '\n' || next == '"' || next == '<';
+    }
+
+    static void AppendDefines(std::string_view variantKey, std::string& output) {
+        ForEachLine(variantKey, [&](std::string_view define, size_t, size_t) {
+            while (!define.empty() && (define.back() == '\n' || define.back() == '\r')) define.remove_suffix(1);
+            if (define.empty()) return;
+            std::string line = "#define " + std::string(define);
+            size_t equals = line.find('=');
+            if (equals != std::string::npos) line[equals] = ' ';
+            output += line;
+            output += '\n';
+        });
+    }
+
+    // Appends text (which follows linesBefore lines of file index) to output, replacing #include lines by the files they name
+    static bool Expand(const std::string& path, std::string_view text, size_t linesBefore, size_t index, std::string& output,
+                       std::vector<std::string>& included, std::unordered_set<std::string>& seen) {
+        bool success = true;
+        ForEachLine(text, [&](std::string_view line, size_t number, size_t) {
+            if (!success) return;
+            if (!StartsWithDirective(line, "#include")) {
+                output.append(line);
+                if (line.empty() || line.back() != '\n') output += '\n';
+                return;
+            }
+
+            size_t lineNumber = linesBefore + number + 1;
+            size_t open = line.find_first_of("\"<");
+            size_t close = open == std::string_view::npos ? open : line.find(line[open] == '"' ? '"' : '>', open + 1);
+            if (close == std::string_view::npos) {
+                std::cerr << "ERROR: Malformed #include in " << path << ":" << lineNumber << std::endl;
+                success = false;
+                return;
+            }
+
+            std::string name(line.substr(open + 1, close - open - 1));
+            std::string includePath = (std::filesystem::path(path).parent_path() / name).generic_string();
+            if (!seen.insert(File::canonicalPath(includePath)).second) {
+                output += '\n'; // Already included; keeps the line numbers
+                return;
+            }
+            const File* file = File::find(includePath);
+            if (!file) {
+                std::cerr << "ERROR: Shader include not found: " << name << " (included from " << path << ":" << lineNumber << ")" << std::endl;
+                success = false;
+                return;
+            }
+
+            FileView contents = file->view();
+            size_t includeIndex = included.size();
+            included.push_back(includePath);
+            output += "#line 1 " + std::to_string(includeIndex) + "\n";
+            success = Expand(includePath, contents.text(), 0, includeIndex, output, included, seen);
+            output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+        });
+        return success;
+    }
+};
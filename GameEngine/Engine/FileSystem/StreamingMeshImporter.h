@@ -0,0 +1,466 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <filesystem>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <glm/glm.hpp>
+#include "../Core.h"
+#include "../Objects/Mesh.h"
+#include "../Objects/MeshQuantizer.h"
+#include "MappedFile.h"
+#include "File.h"
+#include "MeshCache.h"
+#include "ObjParser.h"
+
+/// <summary>
+/// Progress of a streaming import, reported after every block of input.
+/// </summary>
+struct StreamingImportProgress {
+    int pass = 0;                // 1 = attribute pass, 2 = face pass
+    uint64_t bytesProcessed = 0; // Input bytes consumed by the current pass
+    uint64_t totalBytes = 0;
+    uint64_t vertices = 0;
+    uint64_t triangles = 0;
+
+    /// Overall completion in [0, 1]; both passes read the whole file.
+    float Fraction() const {
+        if (totalBytes == 0) return pass >= 2 ? 1.0f : 0.0f;
+        return (static_cast<float>(pass - 1) + static_cast<float>(bytesProcessed) / static_cast<float>(totalBytes)) * 0.5f;
+    }
+};
+
+/// <summary>
+/// Settings of a streaming import.
+/// </summary>
+struct StreamingImportOptions {
+    /// Upper bound for the importer's own buffers and tables, in bytes.
+    size_t memoryLimit = size_t(256) << 20;
+
+    /// Called after every block of input; may be empty.
+    std::function<void(const StreamingImportProgress&)> progress;
+};
+
+/// **StreamingMeshImporter Class**
+/// Cooks OBJ files that do not fit in memory straight into a .gmesh file (see MeshCache) with a
+/// fixed memory budget. The source is read twice in blocks:
+///  1. v/vt/vn lines are appended to spill files next to the cache, and the position bounds are taken.
+///  2. Faces are resolved against the memory mapped spill files. Vertices are written to the cooked
+///     file page by page, indices to a spill file that is appended once the index type is known.
+/// Face corners are deduplicated on their (position, uv, normal) index tuple through a table sized
+/// from the budget; when it fills up it is cleared, which may duplicate some vertices but never
+/// changes the geometry. Mapped pages are dropped after every block so resident memory stays flat.
+/// Streamed meshes are not optimized, simplified or split into meshlets, since those passes need the
+/// whole mesh in memory.
+class StreamingMeshImporter {
+public:
+    /// <summary>
+    /// Cooks an OBJ file into the .gmesh that MeshCache::Load expects for the source and format.
+    /// </summary>
+    /// <param name="sourcePath">Path of the OBJ file.</param>
+    /// <param name="sourceHash">Key stored in the cooked file (see MeshCache::Load).</param>
+    /// <param name="settings">Hash of the import settings, part of the cooked file's name (see MeshCache::GetCachePath).</param>
+    /// <param name="format">Requested VertexFormat; compact formats are quantized on the fly.</param>
+    /// <param name="includeUV">Whether texture coordinates are part of the vertex.</param>
+    /// <param name="includeNormals">Whether normals are part of the vertex.</param>
+    /// <param name="options">Memory ceiling and progress callback.</param>
+    /// <returns>False if the source could not be read or the cooked file could not be written.</returns>
+    static bool CookOBJ(const std::string& sourcePath, uint64_t sourceHash, uint64_t settings, const VertexFormat& format,
+                        bool includeUV, bool includeNormals, const StreamingImportOptions& options) {
+        std::error_code error;
+        uint64_t totalBytes = std::filesystem::file_size(sourcePath, error);
+        if (error) {
+            std::cerr << "ERROR: Unable to open mesh for streaming: " << sourcePath << std::endl;
+            return false;
+        }
+
+        // **Split the budget: input block, vertex and index pages, the rest for the corner table**
+        size_t blockSize = std::clamp<size_t>(options.memoryLimit / 8, MinBlockSize, MaxBlockSize);
+        size_t tableCapacity = 1024;
+        while (tableCapacity * 2 * sizeof(CornerSlot) <= options.memoryLimit / 2) tableCapacity *= 2;
+
+        std::string cachePath = MeshCache::GetCachePath(sourcePath, format, settings);
+        SpillFiles spill(cachePath, includeUV, includeNormals);
+        StreamingImportProgress progress;
+        progress.totalBytes = totalBytes;
+
+        // **Pass 1: attributes to spill files**
+        progress.pass = 1;
+        glm::vec3 sourceMin(std::numeric_limits<float>::max());
+        glm::vec3 sourceMax(std::numeric_limits<float>::lowest());
+        {
+            std::ofstream positions(spill.positions, std::ios::binary | std::ios::trunc);
+            std::ofstream uvs, normals;
+            if (includeUV) uvs.open(spill.uvs, std::ios::binary | std::ios::trunc);
+            if (includeNormals) normals.open(spill.normals, std::ios::binary | std::ios::trunc);
+            if (!positions || (includeUV && !uvs) || (includeNormals && !normals)) {
+                std::cerr << "ERROR: Unable to write streaming spill files for: " << cachePath << std::endl;
+                return false;
+            }
+
+            bool read = StreamLines(sourcePath, blockSize, [&](const char* s, const char* lineEnd) {
+                std::string_view prefix = ReadPrefix(s, lineEnd);
+                if (prefix == "v") {
+                    glm::vec3 pos(0.0f);
+                    ObjParser::ReadFloat(s, lineEnd, pos.x) && ObjParser::ReadFloat(s, lineEnd, pos.y) && ObjParser::ReadFloat(s, lineEnd, pos.z);
+                    positions.write(reinterpret_cast<const char*>(&pos), sizeof(pos));
+                    sourceMin = glm::min(sourceMin, pos);
+                    sourceMax = glm::max(sourceMax, pos);
+                } else if (prefix == "vt" && includeUV) {
+                    glm::vec2 uv(0.0f);
+                    ObjParser::ReadFloat(s, lineEnd, uv.x) && ObjParser::ReadFloat(s, lineEnd, uv.y);
+                    uvs.write(reinterpret_cast<const char*>(&uv), sizeof(uv));
+                } else if (prefix == "vn" && includeNormals) {
+                    glm::vec3 norm(0.0f);
+                    ObjParser::ReadFloat(s, lineEnd, norm.x) && ObjParser::ReadFloat(s, lineEnd, norm.y) && ObjParser::ReadFloat(s, lineEnd, norm.z);
+                    normals.write(reinterpret_cast<const char*>(&norm), sizeof(norm));
+                }
+            }, [&](uint64_t consumed) {
+                progress.bytesProcessed = consumed;
+                if (options.progress) options.progress(progress);
+            });
+            if (!read || !positions || (includeUV && !uvs) || (includeNormals && !normals)) {
+                std::cerr << "ERROR: Streaming import failed in pass 1: " << sourcePath << std::endl;
+                return false;
+            }
+        }
+
+        MappedFile positionFile(spill.positions);
+        MappedFile uvFile, normalFile;
+        if (includeUV) uvFile.open(spill.uvs);
+        if (includeNormals) normalFile.open(spill.normals);
+        if (!positionFile.isOpen() || (includeUV && !uvFile.isOpen()) || (includeNormals && !normalFile.isOpen())) return false;
+
+        // **Pass 2: resolve faces, write vertex pages into the cooked file and index pages to a spill file**
+        bool quantized = MeshQuantizer::IsQuantized(format);
+        bool half = format == VertexFormat::PositionUvNormalHalf;
+        size_t floatStride = 3 + (includeUV ? 2 : 0) + (includeNormals ? 3 : 0);
+        size_t vertexBytes = quantized ? MeshQuantizer::TargetStride : floatStride * sizeof(float);
+        glm::vec3 offset(0.0f), scale(1.0f);
+        if (quantized && positionFile.size() > 0) {
+            MeshQuantizer::GetDequantization(sourceMin, sourceMax, offset, scale);
+        }
+
+        std::string tempPath = File::tempPath(cachePath);
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        std::ofstream indexOut(spill.indices, std::ios::binary | std::ios::trunc);
+        if (!out || !indexOut) {
+            std::cerr << "ERROR: Unable to write cooked mesh: " << cachePath << std::endl;
+            return false;
+        }
+
+        MeshCache::Header header = MeshCache::MakeHeader(sourceHash, format);
+        header.vertexOffset = MeshCache::Align(sizeof(MeshCache::Header));
+        std::vector<char> zeros(header.vertexOffset, 0);
+        out.write(zeros.data(), zeros.size());
+
+        std::vector<uint8_t> vertexPage;
+        vertexPage.reserve(blockSize);
+        std::vector<GLuint> indexPage;
+        indexPage.reserve(blockSize / sizeof(GLuint));
+        std::vector<CornerSlot> table(tableCapacity, CornerSlot{0, 0, 0, Missing});
+        size_t tableEntries = 0;
+        glm::vec3 emittedMin(std::numeric_limits<float>::max());
+        glm::vec3 emittedMax(std::numeric_limits<float>::lowest());
+
+        uint32_t positionsSeen = 0, uvsSeen = 0, normalsSeen = 0;
+        uint64_t vertexCount = 0;
+        bool overflow = false;
+        std::vector<uint32_t> corners;
+        std::vector<GLuint> faceIndices;
+        std::vector<std::pair<uint32_t, uint32_t>> facePositionsUvs; // Source position and UV of every corner
+        double surfaceArea = 0.0, uvArea = 0.0;
+
+        auto flushVertices = [&]() {
+            out.write(reinterpret_cast<const char*>(vertexPage.data()), vertexPage.size());
+            vertexPage.clear();
+        };
+        auto flushIndices = [&]() {
+            indexOut.write(reinterpret_cast<const char*>(indexPage.data()), indexPage.size() * sizeof(GLuint));
+            indexPage.clear();
+        };
+
+        auto emitVertex = [&](uint32_t pos, uint32_t uv, uint32_t normal) -> GLuint {
+            float vertex[8] = {};
+            size_t n = 0;
+            glm::vec3 p(0.0f);
+            if (pos != Missing) std::memcpy(&p, positionFile.data() + static_cast<size_t>(pos) * sizeof(glm::vec3), sizeof(p));
+            vertex[n++] = p.x; vertex[n++] = p.y; vertex[n++] = p.z;
+            if (includeUV) {
+                glm::vec2 t(0.0f);
+                if (uv != Missing) std::memcpy(&t, uvFile.data() + static_cast<size_t>(uv) * sizeof(glm::vec2), sizeof(t));
+                vertex[n++] = t.x; vertex[n++] = t.y;
+            }
+            if (includeNormals) {
+                glm::vec3 v(0.0f);
+                if (normal != Missing) std::memcpy(&v, normalFile.data() + static_cast<size_t>(normal) * sizeof(glm::vec3), sizeof(v));
+                vertex[n++] = v.x; vertex[n++] = v.y; vertex[n++] = v.z;
+            }
+            emittedMin = glm::min(emittedMin, p);
+            emittedMax = glm::max(emittedMax, p);
+
+            size_t at = vertexPage.size();
+            vertexPage.resize(at + vertexBytes);
+            if (quantized) {
+                MeshQuantizer::EncodeVertex(vertex, vertexPage.data() + at, offset, scale, half);
+            } else {
+                std::memcpy(vertexPage.data() + at, vertex, vertexBytes);
+            }
+            if (vertexPage.size() + vertexBytes > blockSize) flushVertices();
+            return static_cast<GLuint>(vertexCount++);
+        };
+
+        progress.pass = 2;
+        progress.bytesProcessed = 0;
+        bool read = StreamLines(sourcePath, blockSize, [&](const char* s, const char* lineEnd) {
+            std::string_view prefix = ReadPrefix(s, lineEnd);
+            if (prefix == "v") {
+                ++positionsSeen;
+            } else if (prefix == "vt" && includeUV) {
+                ++uvsSeen;
+            } else if (prefix == "vn" && includeNormals) {
+                ++normalsSeen;
+            } else if (prefix == "f") {
+                // Same corner rules as ObjParser::ParseChunk
+                corners.clear();
+                while (true) {
+                    while (s < lineEnd && ObjParser::IsSpace(*s)) ++s;
+                    if (s == lineEnd) break;
+                    const char* tokenEnd = s;
+                    while (tokenEnd < lineEnd && !ObjParser::IsSpace(*tokenEnd)) ++tokenEnd;
+
+                    bool failed = false;
+                    GLuint posIndex = ObjParser::ReadIndex(s, tokenEnd, failed);
+                    GLuint uvIndex = includeUV ? ObjParser::ReadIndex(s, tokenEnd, failed) : 0;
+                    GLuint normIndex = includeNormals ? ObjParser::ReadIndex(s, tokenEnd, failed) : 0;
+                    corners.push_back(posIndex > 0 ? posIndex - 1 : 0);
+                    corners.push_back(uvIndex > 0 ? uvIndex - 1 : 0);
+                    corners.push_back(normIndex > 0 ? normIndex - 1 : 0);
+                    s = tokenEnd;
+                }
+
+                faceIndices.clear();
+                facePositionsUvs.clear();
+                for (size_t c = 0; c < corners.size(); c += 3) {
+                    CornerSlot key;
+                    key.pos = corners[c] < positionsSeen ? corners[c] : Missing;
+                    key.uv = !includeUV ? 0 : (corners[c + 1] < uvsSeen ? corners[c + 1] : Missing);
+                    key.normal = !includeNormals ? 0 : (corners[c + 2] < normalsSeen ? corners[c + 2] : Missing);
+                    facePositionsUvs.emplace_back(key.pos, includeUV ? key.uv : Missing);
+
+                    size_t mask = table.size() - 1;
+                    size_t i = HashCorner(key) & mask;
+                    while (table[i].vertex != Missing &&
+                           (table[i].pos != key.pos || table[i].uv != key.uv || table[i].normal != key.normal)) {
+                        i = (i + 1) & mask;
+                    }
+                    if (table[i].vertex != Missing) {
+                        faceIndices.push_back(table[i].vertex);
+                        continue;
+                    }
+
+                    if (vertexCount >= Missing) {
+                        overflow = true;
+                        return;
+                    }
+                    key.vertex = emitVertex(key.pos, key.uv, key.normal);
+                    faceIndices.push_back(key.vertex);
+
+                    // Full table: forget everything seen so far instead of growing past the budget
+                    if (++tableEntries * 2 > table.size()) {
+                        std::fill(table.begin(), table.end(), CornerSlot{0, 0, 0, Missing});
+                        tableEntries = 0;
+                    } else {
+                        table[i] = key;
+                    }
+                }
+
+                for (size_t k = 1; k + 1 < faceIndices.size(); ++k) {
+                    indexPage.push_back(faceIndices[0]);
+                    indexPage.push_back(faceIndices[k]);
+                    indexPage.push_back(faceIndices[k + 1]);
+                    ++progress.triangles;
+
+                    // UV density from the source values, as Mesh::ComputeUvDensity would measure it after the import
+                    if (includeUV) {
+                        Vector3f position[3];
+                        Vector2f uv[3];
+                        size_t triangle[3] = { 0, k, k + 1 };
+                        for (int t = 0; t < 3; ++t) {
+                            auto [pos, texcoord] = facePositionsUvs[triangle[t]];
+                            position[t] = Vector3f(0.0f);
+                            uv[t] = Vector2f(0.0f);
+                            if (pos != Missing) std::memcpy(&position[t], positionFile.data() + static_cast<size_t>(pos) * sizeof(glm::vec3), sizeof(glm::vec3));
+                            if (texcoord != Missing) std::memcpy(&uv[t], uvFile.data() + static_cast<size_t>(texcoord) * sizeof(glm::vec2), sizeof(glm::vec2));
+                        }
+                        Mesh::AddUvArea(position, uv, surfaceArea, uvArea);
+                    }
+                }
+                if (indexPage.size() * sizeof(GLuint) + 3 * sizeof(GLuint) > blockSize) flushIndices();
+            }
+        }, [&](uint64_t consumed) {
+            // The spill mappings are only read through the page cache; drop what this block touched
+            positionFile.evict(0, positionFile.size());
+            uvFile.evict(0, uvFile.size());
+            normalFile.evict(0, normalFile.size());
+            progress.bytesProcessed = consumed;
+            progress.vertices = vertexCount;
+            if (options.progress) options.progress(progress);
+        });
+        flushVertices();
+        flushIndices();
+        indexOut.close();
+
+        if (!read || overflow || !out || !indexOut) {
+            std::cerr << "ERROR: Streaming import failed in pass 2: " << sourcePath << std::endl;
+            out.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        // **Append the indices, narrowed to 16 bits when every vertex is addressable**
+        header.vertexSize = vertexCount * vertexBytes;
+        header.indexOffset = MeshCache::Align(header.vertexOffset + header.vertexSize);
+        header.indexType = vertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        out.write(zeros.data(), header.indexOffset - (header.vertexOffset + header.vertexSize));
+
+        uint64_t indexCount = progress.triangles * 3;
+        header.indexSize = indexCount * Mesh::IndexSize(header.indexType);
+        {
+            std::ifstream in(spill.indices, std::ios::binary);
+            std::vector<GLuint> wide(blockSize / sizeof(GLuint));
+            std::vector<GLushort> narrow(header.indexType == GL_UNSIGNED_SHORT ? wide.size() : 0);
+            for (uint64_t done = 0; done < indexCount && in;) {
+                size_t count = static_cast<size_t>(std::min<uint64_t>(wide.size(), indexCount - done));
+                in.read(reinterpret_cast<char*>(wide.data()), count * sizeof(GLuint));
+                if (header.indexType == GL_UNSIGNED_SHORT) {
+                    for (size_t i = 0; i < count; ++i) narrow[i] = static_cast<GLushort>(wide[i]);
+                    out.write(reinterpret_cast<const char*>(narrow.data()), count * sizeof(GLushort));
+                } else {
+                    out.write(reinterpret_cast<const char*>(wide.data()), count * sizeof(GLuint));
+                }
+                done += count;
+            }
+        }
+
+        header.meshletOffset = MeshCache::Align(header.indexOffset + header.indexSize);
+        header.meshletCount = 0;
+        out.write(zeros.data(), header.meshletOffset - (header.indexOffset + header.indexSize));
+        if (vertexCount == 0) emittedMin = emittedMax = glm::vec3(0.0f);
+        header.boundsRadius = glm::length(emittedMax - emittedMin) * 0.5f; // The positions are gone by now; a looser sphere
+        header.uvDensity = surfaceArea > 0.0 && uvArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / surfaceArea)) : 0.0f;
+        for (int i = 0; i < 3; ++i) {
+            header.boundsMin[i] = emittedMin[i];
+            header.boundsMax[i] = emittedMax[i];
+            header.positionScale[i] = scale[i];
+            header.positionOffset[i] = offset[i];
+        }
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.close();
+        positionFile.close();
+        uvFile.close();
+        normalFile.close();
+
+        if (!out) {
+            std::cerr << "ERROR: Unable to write cooked mesh: " << cachePath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error) {
+            std::cerr << "ERROR: Unable to write cooked mesh: " << cachePath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t MinBlockSize = size_t(64) << 10;
+    static constexpr size_t MaxBlockSize = size_t(64) << 20;
+    static constexpr uint32_t Missing = 0xFFFFFFFFu;
+
+    struct CornerSlot {
+        uint32_t pos, uv, normal;
+        GLuint vertex;
+    };
+
+    // Temporary files next to the cooked mesh, removed when the import ends
+    struct SpillFiles {
+        std::string positions, uvs, normals, indices;
+
+        SpillFiles(const std::string& cachePath, bool includeUV, bool includeNormals)
+            : positions(File::tempPath(cachePath + ".v")), uvs(includeUV ? File::tempPath(cachePath + ".vt") : ""),
+              normals(includeNormals ? File::tempPath(cachePath + ".vn") : ""), indices(File::tempPath(cachePath + ".f")) {}
+
+        ~SpillFiles() {
+            for (const auto* path : { &positions, &uvs, &normals, &indices }) {
+                if (!path->empty()) std::remove(path->c_str());
+            }
+        }
+    };
+
+    static uint64_t HashCorner(const CornerSlot& slot) {
+        uint64_t h = (static_cast<uint64_t>(slot.pos) << 32 | slot.uv) ^ (static_cast<uint64_t>(slot.normal) * 0x9E3779B97F4A7C15ull);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // Reads the prefix token of an OBJ line and leaves s just behind it
+    static std::string_view ReadPrefix(const char*& s, const char* lineEnd) {
+        while (s < lineEnd && ObjParser::IsSpace(*s)) ++s;
+        const char* prefix = s;
+        while (s < lineEnd && !ObjParser::IsSpace(*s)) ++s;
+        return std::string_view(prefix, s - prefix);
+    }
+
+    // Reads a file block by block and calls onLine(begin, end) for every line (without the '\n').
+    // Only lines longer than a block make the buffer grow.
+    template<typename OnLine, typename OnBlock>
+    static bool StreamLines(const std::string& path, size_t blockSize, OnLine&& onLine, OnBlock&& onBlock) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+
+        std::vector<char> buffer(blockSize);
+        size_t filled = 0;
+        uint64_t consumed = 0;
+        while (true) {
+            in.read(buffer.data() + filled, static_cast<std::streamsize>(buffer.size() - filled));
+            if (in.bad()) return false;
+            filled += static_cast<size_t>(in.gcount());
+            bool last = in.eof();
+
+            const char* p = buffer.data();
+            const char* end = p + filled;
+            while (p < end) {
+                const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                if (!lineEnd) break;
+                onLine(p, lineEnd);
+                p = lineEnd + 1;
+            }
+
+            size_t rest = static_cast<size_t>(end - p);
+            if (last) {
+                if (rest > 0) onLine(p, end);
+                onBlock(consumed + filled);
+                return true;
+            }
+
+            consumed += filled - rest;
+            std::memmove(buffer.data(), p, rest);
+            filled = rest;
+            if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+            onBlock(consumed);
+        }
+    }
+};
@@ -0,0 +1,350 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <numeric>
+#include <filesystem>
+#include <type_traits>
+#include "../Core.h"
+#include "MappedFile.h"
+#include "File.h"
+#include "Hash.h"
+
+/// **TextureCache Class**
+/// Mip chains cached as KTX2 files next to their source image, e.g. "Test.jpg.bc5.ktx2" for block compressed
+/// levels or "Test.jpg.mips.ktx2" for 8-bit pixels. The files are standard KTX2 (one 2D image, no
+/// supercompression) so external tools can inspect them. The hash of the source bytes and build settings is
+/// stored under the "GameEngine.sourceHash" key, so editing the image, changing its settings or changing the
+/// encoders (Version) rebuilds it on the next load.
+class TextureCache {
+public:
+    static constexpr uint32_t Version = 2;
+
+    struct Header {
+        unsigned char identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "KTX2 header is 80 bytes");
+    static_assert(std::is_trivially_copyable_v<Header>, "Header is written to disk as raw bytes");
+
+    struct LevelRecord {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    /// <summary>
+    /// Path of the cache for a source image and compressed GL format (0 for 8-bit pixels), e.g. "Test.jpg.bc5.ktx2".
+    /// </summary>
+    static std::string GetCachePath(const std::string& sourcePath, GLenum format) {
+        return sourcePath + "." + GetFormatTag(format) + ".ktx2";
+    }
+
+    /// <summary>
+    /// Reads the cached mip chain of a source image.
+    /// </summary>
+    /// <param name="sourcePath">Path of the source image the cache was encoded from.</param>
+    /// <param name="sourceHash">Hash::Bytes of the current source contents, combined with the build settings.</param>
+    /// <param name="format">The compressed GL format the caller wants, or 0 for 8-bit pixels of any channel count.
+    /// Either the sRGB or the linear variant is returned.</param>
+    /// <param name="chain">Receives the levels on success.</param>
+    /// <returns>False if there is no valid cache for this source and format.</returns>
+    static bool Load(const std::string& sourcePath, uint64_t sourceHash, GLenum format, TextureMipChain& chain) {
+        std::string cachePath = GetCachePath(sourcePath, format);
+        std::error_code error;
+        if (!std::filesystem::exists(cachePath, error)) return false;
+
+        MappedFile mapping(cachePath);
+        if (!mapping.isOpen() || mapping.size() < sizeof(Header)) return false;
+
+        Header header;
+        std::memcpy(&header, mapping.data(), sizeof(Header));
+        if (std::memcmp(header.identifier, Identifier, sizeof(Identifier)) != 0) return false;
+        const Format* info = FindFormat(header.vkFormat);
+        // sRGB and linear variants share a cache file; the settings in the source hash tell them apart
+        if (!info || std::strcmp(GetFormatTag(info->glFormat), GetFormatTag(format)) != 0 || header.supercompressionScheme != 0) return false;
+
+        uint64_t size = mapping.size();
+        uint64_t levelTableEnd = sizeof(Header) + static_cast<uint64_t>(header.levelCount) * sizeof(LevelRecord);
+        if (header.levelCount == 0 || header.levelCount > 32 || header.pixelWidth == 0 || header.pixelHeight == 0 ||
+            header.pixelDepth != 0 || header.faceCount != 1 || levelTableEnd > size ||
+            header.kvdByteOffset > size || header.kvdByteLength > size - header.kvdByteOffset) {
+            std::cerr << "WARNING: Corrupt texture cache ignored: " << cachePath << std::endl;
+            return false;
+        }
+
+        const char* base = mapping.data();
+        if (FindValue(base + header.kvdByteOffset, header.kvdByteLength, SourceHashKey) != HashString(sourceHash)) return false;
+
+        std::vector<TextureMip> levels(header.levelCount);
+        for (uint32_t i = 0; i < header.levelCount; ++i) {
+            LevelRecord record;
+            std::memcpy(&record, base + sizeof(Header) + i * sizeof(LevelRecord), sizeof(LevelRecord));
+            TextureMip& level = levels[i];
+            level.width = std::max(1, static_cast<int>(header.pixelWidth >> i));
+            level.height = std::max(1, static_cast<int>(header.pixelHeight >> i));
+            uint64_t expected = LevelBytes(*info, level.width, level.height);
+            if (record.byteOffset > size || record.byteLength != expected || record.byteLength > size - record.byteOffset) {
+                std::cerr << "WARNING: Corrupt texture cache ignored: " << cachePath << std::endl;
+                return false;
+            }
+            level.pixels.assign(base + record.byteOffset, base + record.byteOffset + record.byteLength);
+        }
+
+        chain.channels = info->channels;
+        chain.compressedFormat = info->compressed ? info->glFormat : 0;
+        chain.srgb = info->srgb;
+        chain.levels = std::move(levels);
+        return true;
+    }
+
+    /// <summary>
+    /// Writes a compressed mip chain as KTX2 next to its source. The file is written under a temporary
+    /// name and renamed into place so a crash never leaves a truncated cache behind.
+    /// </summary>
+    /// <returns>False if the cache could not be written (e.g. read-only asset folder).</returns>
+    static bool Write(const std::string& sourcePath, uint64_t sourceHash, const TextureMipChain& chain) {
+        const Format* info = FindFormat(chain);
+        if (!info || chain.levels.empty()) return false;
+
+        std::vector<unsigned char> dfd = MakeDataFormatDescriptor(*info);
+        std::vector<unsigned char> kvd;
+        AppendValue(kvd, SourceHashKey, HashString(sourceHash));
+        AppendValue(kvd, "KTXwriter", "GameEngine TextureCache");
+
+        Header header{};
+        std::memcpy(header.identifier, Identifier, sizeof(Identifier));
+        header.vkFormat = info->vkFormat;
+        header.typeSize = 1;
+        header.pixelWidth = static_cast<uint32_t>(chain.levels[0].width);
+        header.pixelHeight = static_cast<uint32_t>(chain.levels[0].height);
+        header.faceCount = 1;
+        header.levelCount = static_cast<uint32_t>(chain.levels.size());
+        header.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + chain.levels.size() * sizeof(LevelRecord));
+        header.dfdByteLength = static_cast<uint32_t>(dfd.size());
+        header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+        header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+        // Level data is stored smallest first, each level aligned to the texel block size and to 4 bytes
+        uint64_t alignment = std::lcm<uint64_t>(info->blockBytes, 4);
+        std::vector<LevelRecord> records(chain.levels.size());
+        uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+        for (size_t i = chain.levels.size(); i-- > 0;) {
+            offset = (offset + alignment - 1) / alignment * alignment;
+            records[i].byteOffset = offset;
+            records[i].byteLength = chain.levels[i].pixels.size();
+            records[i].uncompressedByteLength = chain.levels[i].pixels.size();
+            offset += records[i].byteLength;
+        }
+
+        std::string cachePath = GetCachePath(sourcePath, chain.compressedFormat);
+        std::string tempPath = File::tempPath(cachePath);
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                std::cerr << "WARNING: Unable to write texture cache: " << cachePath << std::endl;
+                return false;
+            }
+
+            static const char padding[16] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(LevelRecord));
+            out.write(reinterpret_cast<const char*>(dfd.data()), dfd.size());
+            out.write(reinterpret_cast<const char*>(kvd.data()), kvd.size());
+            uint64_t position = header.kvdByteOffset + header.kvdByteLength;
+            for (size_t i = chain.levels.size(); i-- > 0;) {
+                out.write(padding, records[i].byteOffset - position);
+                out.write(reinterpret_cast<const char*>(chain.levels[i].pixels.data()), records[i].byteLength);
+                position = records[i].byteOffset + records[i].byteLength;
+            }
+            if (!out) {
+                std::cerr << "WARNING: Unable to write texture cache: " << cachePath << std::endl;
+                out.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error) {
+            std::cerr << "WARNING: Unable to write texture cache: " << cachePath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr unsigned char Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    static constexpr const char* SourceHashKey = "GameEngine.sourceHash";
+
+    struct Format {
+        GLenum glFormat;
+        uint32_t vkFormat;
+        int channels;
+        bool srgb;
+        bool compressed;     // 4x4 blocks
+        uint8_t colorModel;
+        uint32_t blockBytes; // Bytes of one texel or block
+    };
+
+    // VkFormat values and KTX data format descriptor color models
+    static constexpr Format Formats[] = {
+        { GL_R8, 9, 1, false, false, 1, 1 },                                     // VK_FORMAT_R8_UNORM
+        { GL_RGB8, 23, 3, false, false, 1, 3 },                                  // VK_FORMAT_R8G8B8_UNORM
+        { GL_SRGB8, 29, 3, true, false, 1, 3 },                                  // VK_FORMAT_R8G8B8_SRGB
+        { GL_RGBA8, 37, 4, false, false, 1, 4 },                                 // VK_FORMAT_R8G8B8A8_UNORM
+        { GL_SRGB8_ALPHA8, 43, 4, true, false, 1, 4 },                           // VK_FORMAT_R8G8B8A8_SRGB
+        { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 131, 3, false, true, 128, 8 },        // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+        { GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 132, 3, true, true, 128, 8 },        // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+        { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 137, 4, false, true, 130, 16 },      // VK_FORMAT_BC3_UNORM_BLOCK
+        { GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 138, 4, true, true, 130, 16 }, // VK_FORMAT_BC3_SRGB_BLOCK
+        { GL_COMPRESSED_RG_RGTC2, 141, 2, false, true, 132, 16 },                // VK_FORMAT_BC5_UNORM_BLOCK
+        { GL_COMPRESSED_RGBA_BPTC_UNORM, 145, 4, false, true, 134, 16 },         // VK_FORMAT_BC7_UNORM_BLOCK
+        { GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 146, 4, true, true, 134, 16 },    // VK_FORMAT_BC7_SRGB_BLOCK
+    };
+
+    static const Format* FindFormat(uint32_t vkFormat) {
+        for (const Format& format : Formats) {
+            if (format.vkFormat == vkFormat) return &format;
+        }
+        return nullptr;
+    }
+
+    static const Format* FindFormat(const TextureMipChain& chain) {
+        for (const Format& format : Formats) {
+            if (chain.compressedFormat ? format.glFormat == chain.compressedFormat
+                                       : !format.compressed && format.channels == chain.channels && format.srgb == chain.srgb) {
+                return &format;
+            }
+        }
+        return nullptr;
+    }
+
+    static const char* GetFormatTag(GLenum format) {
+        switch (format) {
+            case 0:
+            case GL_R8:
+            case GL_RGB8:
+            case GL_SRGB8:
+            case GL_RGBA8:
+            case GL_SRGB8_ALPHA8: return "mips";
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: return "bc1";
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: return "bc3";
+            case GL_COMPRESSED_RG_RGTC2: return "bc5";
+            case GL_COMPRESSED_RGBA_BPTC_UNORM:
+            case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM: return "bc7";
+            default: return "raw";
+        }
+    }
+
+    static uint64_t LevelBytes(const Format& format, int width, int height) {
+        if (format.compressed) return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * format.blockBytes;
+        return static_cast<uint64_t>(width) * height * format.blockBytes;
+    }
+
+    // Basic data format descriptor block as required by the KTX2 specification
+    static std::vector<unsigned char> MakeDataFormatDescriptor(const Format& format) {
+        struct Sample {
+            uint16_t bitOffset;
+            uint8_t bitLength; // Minus one
+            uint8_t channelType;
+        };
+        std::vector<Sample> samples;
+        switch (format.colorModel) {
+            case 128: samples = { {0, 63, 0} }; break;              // BC1A, color
+            case 130: samples = { {0, 63, 15}, {64, 63, 0} }; break; // BC3, alpha then color
+            case 132: samples = { {0, 63, 0}, {64, 63, 1} }; break;  // BC5, red then green
+            case 134: samples = { {0, 127, 0} }; break;              // BC7, color
+            default:                                                 // RGBSDA, one byte per channel
+                for (int c = 0; c < format.channels; ++c) {
+                    samples.push_back({ static_cast<uint16_t>(c * 8), 7, static_cast<uint8_t>(c == 3 ? 15 : c) });
+                }
+                break;
+        }
+
+        uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+        std::vector<unsigned char> dfd;
+        auto put32 = [&](uint32_t value) {
+            for (int i = 0; i < 4; ++i) dfd.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        };
+        put32(4 + blockSize);                 // dfdTotalSize
+        put32(0);                             // Khronos vendor, basic descriptor type
+        put32(2 | (blockSize << 16));         // Version 1.3, block size
+        dfd.push_back(format.colorModel);
+        dfd.push_back(1);                     // BT.709 primaries
+        dfd.push_back(format.srgb ? 2 : 1);   // sRGB or linear transfer
+        dfd.push_back(0);                     // Straight alpha
+        put32(format.compressed ? 0x00000303 : 0); // 4x4x1x1 or 1x1x1x1 texel block
+        put32(format.blockBytes);
+        put32(0);
+        for (const Sample& sample : samples) {
+            // Alpha stays linear in sRGB formats
+            uint8_t channelType = sample.channelType | (format.srgb && sample.channelType == 15 ? 0x10 : 0);
+            put32(sample.bitOffset | (static_cast<uint32_t>(sample.bitLength) << 16) | (static_cast<uint32_t>(channelType) << 24));
+            put32(0);                         // Sample position
+            put32(0);                         // Lower
+            put32(format.compressed ? 0xFFFFFFFFu : 255u); // Upper
+        }
+        return dfd;
+    }
+
+    static std::string HashString(uint64_t sourceHash) {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(Hash::Combine(sourceHash, Version)));
+        return text;
+    }
+
+    // Appends a key/value entry; entries must be appended in key order
+    static void AppendValue(std::vector<unsigned char>& kvd, const std::string& key, const std::string& value) {
+        uint32_t length = static_cast<uint32_t>(key.size() + 1 + value.size() + 1);
+        for (int i = 0; i < 4; ++i) kvd.push_back(static_cast<unsigned char>(length >> (8 * i)));
+        kvd.insert(kvd.end(), key.begin(), key.end());
+        kvd.push_back(0);
+        kvd.insert(kvd.end(), value.begin(), value.end());
+        kvd.push_back(0);
+        while (kvd.size() % 4) kvd.push_back(0);
+    }
+
+    static std::string FindValue(const char* kvd, uint32_t size, const std::string& key) {
+        uint32_t position = 0;
+        while (position + 4 <= size) {
+            uint32_t length;
+            std::memcpy(&length, kvd + position, 4);
+            position += 4;
+            if (length > size - position) break;
+            std::string entry(kvd + position, length);
+            size_t split = entry.find('\0');
+            if (split != std::string::npos && entry.compare(0, split, key) == 0) {
+                std::string value = entry.substr(split + 1);
+                if (!value.empty() && value.back() == '\0') value.pop_back();
+                return value;
+            }
+            position += (length + 3) & ~3u;
+        }
+        return "";
+    }
+};
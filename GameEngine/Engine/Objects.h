@@ -2,9 +2,19 @@
 
 #include "Objects/Transform.h"
 #include "Objects/Camera.h"
+#include "Objects/GeometryArena.h"
 #include "Objects/GeometryContainer.h"
 #include "Objects/Mesh.h"
+#include "Objects/MeshOptimizer.h"
+#include "Objects/MeshQuantizer.h"
+#include "Objects/MeshSimplifier.h"
+#include "Objects/MeshletBuilder.h"
+#include "Objects/ClusterCuller.h"
+#include "Objects/Bounds.h"
+#include "Objects/FrustumCuller.h"
+#include "Objects/Bvh.h"
 #include "Objects/Material.h"
 #include "Objects/Scene.h"
+#include "Objects/RenderQueue.h"
 #include "Objects/Instance.h"
 #include "Objects/Instances.h"
\ No newline at end of file
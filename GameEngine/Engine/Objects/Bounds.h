@@ -0,0 +1,35 @@
+#pragma once
+#include <cmath>
+#include <glm/glm.hpp>
+#include "../../Utilities.h"
+
+// Bounding volumes of an object: an axis aligned box (center and half extent) and a sphere around the same
+// center. Culling keeps an object only if both overlap a plane's inner side, so the tighter one decides.
+struct Bounds {
+	Vector3f center = Vector3f(0.0f);
+	Vector3f extent = Vector3f(0.0f);
+	float radius = 0.0f;
+
+	static Bounds FromBox(const Vector3f& minimum, const Vector3f& maximum, float radius) {
+		Bounds bounds;
+		bounds.center = (minimum + maximum) * 0.5f;
+		bounds.extent = (maximum - minimum) * 0.5f;
+		bounds.radius = radius;
+		return bounds;
+	}
+
+	// Bounds of the volume after a transform. The box is refitted around the transformed box (Arvo's method),
+	// and the sphere grows with the largest axis scale.
+	Bounds Transformed(const Matrix4f& matrix) const {
+		Bounds result;
+		result.center = Vector3f(matrix * glm::vec4(center, 1.0f));
+		for (int axis = 0; axis < 3; ++axis) {
+			result.extent[axis] = std::abs(matrix[0][axis]) * extent.x + std::abs(matrix[1][axis]) * extent.y +
+			                      std::abs(matrix[2][axis]) * extent.z;
+		}
+		float scale = std::sqrt(glm::max(glm::dot(Vector3f(matrix[0]), Vector3f(matrix[0])),
+		                        glm::max(glm::dot(Vector3f(matrix[1]), Vector3f(matrix[1])), glm::dot(Vector3f(matrix[2]), Vector3f(matrix[2])))));
+		result.radius = radius * scale;
+		return result;
+	}
+};
@@ -0,0 +1,504 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "ClusterCuller.h"
+
+// Dynamic bounding volume hierarchy of axis aligned boxes, one item per leaf.
+// Leaves are inserted next to the sibling that grows the surface area of the tree least, and on the way back
+// up every ancestor is refit and rotated (a child swapped with a grandchild) when that shrinks it, which keeps
+// the tree close to what a full build would give. Moving leaves may be fattened by a margin, so small moves
+// cost nothing and large ones re-insert the leaf. Rebuild replaces the inner nodes with a binned SAH build,
+// best after loading static content. Leaf indices (proxies) stay valid until the leaf is removed.
+// Queries are not thread safe against modifications.
+template <typename T>
+class Bvh {
+public:
+	static constexpr int Null = -1;
+
+	struct Node {
+		Vector3f min;
+		Vector3f max;
+		int parent = Null;   // Next free node while the node is unused
+		int child1 = Null;   // Null for leaves
+		int child2 = Null;
+		int height = -1;     // 0 for leaves, -1 while the node is unused
+		T item{};
+
+		bool IsLeaf() const { return child1 == Null; }
+	};
+
+	// Adds a leaf and returns its proxy. The stored box is grown by margin on every side.
+	int Insert(const Vector3f& min, const Vector3f& max, const T& item, float margin = 0.0f) {
+		int leaf = Allocate();
+		nodes[leaf].min = min - Vector3f(margin);
+		nodes[leaf].max = max + Vector3f(margin);
+		nodes[leaf].item = item;
+		nodes[leaf].height = 0;
+		InsertLeaf(leaf);
+		++leafCount;
+		return leaf;
+	}
+
+	void Remove(int proxy) {
+		RemoveLeaf(proxy);
+		Free(proxy);
+		--leafCount;
+	}
+
+	// Updates the box of a leaf. Returns false if it still fits the stored (fattened) box and nothing changed;
+	// otherwise the leaf is re-inserted with the new box grown by margin.
+	bool Move(int proxy, const Vector3f& min, const Vector3f& max, float margin = 0.0f) {
+		Node& node = nodes[proxy];
+		if (glm::all(glm::lessThanEqual(node.min, min)) && glm::all(glm::lessThanEqual(max, node.max))) return false;
+		RemoveLeaf(proxy);
+		nodes[proxy].min = min - Vector3f(margin);
+		nodes[proxy].max = max + Vector3f(margin);
+		InsertLeaf(proxy);
+		return true;
+	}
+
+	const T& GetItem(int proxy) const { return nodes[proxy].item; }
+	const Node& GetNode(int index) const { return nodes[index]; }
+	int GetRoot() const { return root; }
+	size_t size() const { return leafCount; }
+	int GetHeight() const { return root == Null ? 0 : nodes[root].height; }
+
+	// Sum of the surface areas of the inner nodes divided by that of the root; lower is a better tree
+	float GetAreaRatio() const {
+		if (root == Null) return 0.0f;
+		float total = 0.0f;
+		for (const Node& node : nodes) {
+			if (node.height > 0) total += Area(node.min, node.max);
+		}
+		float rootArea = Area(nodes[root].min, nodes[root].max);
+		return rootArea > 0.0f ? total / rootArea : 0.0f;
+	}
+
+	// Rebuilds the inner nodes top down, splitting each range where the binned surface area heuristic is
+	// cheapest. Proxies stay the same.
+	void Rebuild() {
+		std::vector<int> leaves;
+		leaves.reserve(leafCount);
+		for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+			if (nodes[i].height == 0) {
+				leaves.push_back(i);
+			} else if (nodes[i].height > 0) {
+				Free(i);
+			}
+		}
+		root = leaves.empty() ? Null : Build(leaves.data(), leaves.size());
+		if (root != Null) nodes[root].parent = Null;
+	}
+
+	// Calls visit(item) for the leaves overlapping a box. Returns the number of nodes visited.
+	template <typename Visit>
+	size_t QueryAabb(const Vector3f& min, const Vector3f& max, Visit&& visit) const {
+		return Traverse([&](const Node& node) {
+			return glm::all(glm::lessThanEqual(node.min, max)) && glm::all(glm::lessThanEqual(min, node.max));
+		}, visit);
+	}
+
+	// Calls visit(item) for the leaves whose box reaches into a sphere. Returns the number of nodes visited.
+	template <typename Visit>
+	size_t QuerySphere(const Vector3f& center, float radius, Visit&& visit) const {
+		return Traverse([&](const Node& node) {
+			Vector3f closest = glm::clamp(center, node.min, node.max);
+			return glm::dot(closest - center, closest - center) <= radius * radius;
+		}, visit);
+	}
+
+	// Calls visit(item, inside) for the leaves whose box is not entirely outside a plane of the frustum; inside
+	// is true when the box is entirely inside. Subtrees entirely inside are reported without further tests.
+	// Returns the number of nodes visited.
+	template <typename Visit>
+	size_t QueryFrustum(const ClusterCuller::Frustum& frustum, Visit&& visit) const {
+		if (root == Null) return 0;
+		size_t visited = 0;
+		std::vector<std::pair<int, uint8_t>> stack;
+		stack.reserve(64);
+		stack.emplace_back(root, uint8_t(0x3F)); // One bit per plane still crossing the node
+		while (!stack.empty()) {
+			auto [index, mask] = stack.back();
+			stack.pop_back();
+			const Node& node = nodes[index];
+			++visited;
+
+			Vector3f center = (node.min + node.max) * 0.5f;
+			Vector3f extent = (node.max - node.min) * 0.5f;
+			bool outside = false;
+			for (int p = 0; p < 6 && !outside; ++p) {
+				if (!(mask & (1 << p))) continue;
+				const glm::vec4& plane = frustum.planes[p];
+				float distance = glm::dot(Vector3f(plane), center) + plane.w;
+				float reach = glm::dot(glm::abs(Vector3f(plane)), extent);
+				if (distance + reach < 0.0f) outside = true;
+				else if (distance - reach >= 0.0f) mask &= ~(1 << p);
+			}
+			if (outside) continue;
+
+			if (mask == 0) {
+				visited += VisitSubtree(index, [&](const T& item) { visit(item, true); });
+			} else if (node.IsLeaf()) {
+				visit(node.item, false);
+			} else {
+				stack.emplace_back(node.child1, mask);
+				stack.emplace_back(node.child2, mask);
+			}
+		}
+		return visited;
+	}
+
+	// Calls visit(item, entry) for the leaves a ray passes through within maxDistance, where entry is the
+	// distance at which the ray enters the leaf's box. visit returns the distance later leaves must start
+	// before, e.g. the exact hit distance to find the closest hit, maxDistance to find all, or 0 to stop.
+	// The direction need not be normalized; distances are in multiples of it. Returns the number of nodes visited.
+	template <typename Visit>
+	size_t Raycast(const Vector3f& origin, const Vector3f& direction, float maxDistance, Visit&& visit) const {
+		if (root == Null) return 0;
+		Vector3f inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		size_t visited = 0;
+		std::vector<int> stack;
+		stack.reserve(64);
+		stack.push_back(root);
+		while (!stack.empty() && maxDistance > 0.0f) {
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			++visited;
+
+			float entry;
+			if (!RayHitsBox(origin, inverse, node.min, node.max, maxDistance, entry)) continue;
+			if (node.IsLeaf()) {
+				maxDistance = std::min(maxDistance, visit(node.item, entry));
+				continue;
+			}
+			// Nearer child on top of the stack, so closest hit queries tighten maxDistance early
+			float entry1 = std::numeric_limits<float>::max(), entry2 = std::numeric_limits<float>::max();
+			bool hit1 = RayHitsBox(origin, inverse, nodes[node.child1].min, nodes[node.child1].max, maxDistance, entry1);
+			bool hit2 = RayHitsBox(origin, inverse, nodes[node.child2].min, nodes[node.child2].max, maxDistance, entry2);
+			if (hit1 && hit2) {
+				stack.push_back(entry1 <= entry2 ? node.child2 : node.child1);
+				stack.push_back(entry1 <= entry2 ? node.child1 : node.child2);
+			} else if (hit1) {
+				stack.push_back(node.child1);
+			} else if (hit2) {
+				stack.push_back(node.child2);
+			}
+		}
+		return visited;
+	}
+
+	// Slab test of a ray, given the inverse of its direction, against a box. entry receives the distance at which
+	// the ray enters the box, 0 if it starts inside.
+	static bool RayHitsBox(const Vector3f& origin, const Vector3f& inverse, const Vector3f& min, const Vector3f& max,
+	                       float maxDistance, float& entry) {
+		Vector3f t1 = (min - origin) * inverse;
+		Vector3f t2 = (max - origin) * inverse;
+		Vector3f nearest = glm::min(t1, t2);
+		Vector3f farthest = glm::max(t1, t2);
+		entry = std::max(0.0f, std::max(nearest.x, std::max(nearest.y, nearest.z)));
+		float exit = std::min(farthest.x, std::min(farthest.y, farthest.z));
+		return entry <= exit && entry <= maxDistance;
+	}
+
+private:
+	static constexpr int BinCount = 16;
+
+	static float Area(const Vector3f& min, const Vector3f& max) {
+		Vector3f d = max - min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	static float UnionArea(const Node& a, const Node& b) {
+		return Area(glm::min(a.min, b.min), glm::max(a.max, b.max));
+	}
+
+	template <typename Overlaps, typename Visit>
+	size_t Traverse(Overlaps&& overlaps, Visit&& visit) const {
+		if (root == Null) return 0;
+		size_t visited = 0;
+		std::vector<int> stack;
+		stack.reserve(64);
+		stack.push_back(root);
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			++visited;
+			if (!overlaps(node)) continue;
+			if (node.IsLeaf()) {
+				visit(node.item);
+			} else {
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+		return visited;
+	}
+
+	// Reports every leaf below a node; returns the number of nodes below it
+	template <typename Visit>
+	size_t VisitSubtree(int index, Visit&& visit) const {
+		size_t visited = 0;
+		std::vector<int> stack = { index };
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			if (node.IsLeaf()) {
+				visit(node.item);
+			} else {
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+				visited += 2;
+			}
+		}
+		return visited;
+	}
+
+	int Allocate() {
+		if (freeList == Null) {
+			nodes.emplace_back();
+			return static_cast<int>(nodes.size()) - 1;
+		}
+		int index = freeList;
+		freeList = nodes[index].parent;
+		nodes[index] = Node();
+		return index;
+	}
+
+	void Free(int index) {
+		nodes[index] = Node();
+		nodes[index].parent = freeList;
+		freeList = index;
+	}
+
+	void InsertLeaf(int leaf) {
+		if (root == Null) {
+			root = leaf;
+			nodes[leaf].parent = Null;
+			return;
+		}
+
+		// Walk down towards the cheapest sibling: pairing with a node costs the area of the new parent, and
+		// every ancestor on the way grows by the leaf too
+		const Node& box = nodes[leaf];
+		int index = root;
+		while (!nodes[index].IsLeaf()) {
+			const Node& node = nodes[index];
+			float area = Area(node.min, node.max);
+			float combinedArea = UnionArea(node, box);
+			float cost = 2.0f * combinedArea;
+			float inheritance = 2.0f * (combinedArea - area);
+
+			auto childCost = [&](int child) {
+				const Node& c = nodes[child];
+				float grown = UnionArea(c, box);
+				return (c.IsLeaf() ? grown : grown - Area(c.min, c.max)) + inheritance;
+			};
+			float cost1 = childCost(node.child1);
+			float cost2 = childCost(node.child2);
+			if (cost < cost1 && cost < cost2) break;
+			index = cost1 < cost2 ? node.child1 : node.child2;
+		}
+
+		int sibling = index;
+		int oldParent = nodes[sibling].parent;
+		int newParent = Allocate();
+		Node& parent = nodes[newParent];
+		parent.parent = oldParent;
+		parent.min = glm::min(nodes[leaf].min, nodes[sibling].min);
+		parent.max = glm::max(nodes[leaf].max, nodes[sibling].max);
+		parent.height = nodes[sibling].height + 1;
+		parent.child1 = sibling;
+		parent.child2 = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+		if (oldParent == Null) {
+			root = newParent;
+		} else if (nodes[oldParent].child1 == sibling) {
+			nodes[oldParent].child1 = newParent;
+		} else {
+			nodes[oldParent].child2 = newParent;
+		}
+
+		Refit(nodes[leaf].parent);
+	}
+
+	void RemoveLeaf(int leaf) {
+		if (leaf == root) {
+			root = Null;
+			return;
+		}
+
+		int parent = nodes[leaf].parent;
+		int grandParent = nodes[parent].parent;
+		int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+		Free(parent);
+		nodes[sibling].parent = grandParent;
+		if (grandParent == Null) {
+			root = sibling;
+			return;
+		}
+		if (nodes[grandParent].child1 == parent) {
+			nodes[grandParent].child1 = sibling;
+		} else {
+			nodes[grandParent].child2 = sibling;
+		}
+		Refit(grandParent);
+	}
+
+	// Refits the boxes and heights from a node up to the root, rotating each node on the way
+	void Refit(int index) {
+		while (index != Null) {
+			Node& node = nodes[index];
+			const Node& a = nodes[node.child1];
+			const Node& b = nodes[node.child2];
+			node.min = glm::min(a.min, b.min);
+			node.max = glm::max(a.max, b.max);
+			node.height = 1 + std::max(a.height, b.height);
+			Rotate(index);
+			index = nodes[index].parent;
+		}
+	}
+
+	// Swaps a child of the node with a grandchild on the other side when that shrinks the other child
+	void Rotate(int index) {
+		Node& node = nodes[index];
+		int b = node.child1;
+		int c = node.child2;
+
+		// Candidates: (child kept, its sibling that takes the grandchild's place, grandchild)
+		int bestChild = Null, bestGrandChild = Null;
+		float bestGain = 0.0f;
+		auto consider = [&](int moving, int other) {
+			const Node& target = nodes[other];
+			if (target.IsLeaf()) return;
+			float area = Area(target.min, target.max);
+			for (int grandChild : { target.child1, target.child2 }) {
+				int kept = grandChild == target.child1 ? target.child2 : target.child1;
+				// After the swap, other holds moving and kept
+				float gain = area - UnionArea(nodes[moving], nodes[kept]);
+				if (gain > bestGain) {
+					bestGain = gain;
+					bestChild = moving;
+					bestGrandChild = grandChild;
+				}
+			}
+		};
+		consider(b, c);
+		consider(c, b);
+		if (bestChild == Null) return;
+
+		int other = bestChild == b ? c : b;
+		Node& target = nodes[other];
+		if (target.child1 == bestGrandChild) {
+			target.child1 = bestChild;
+		} else {
+			target.child2 = bestChild;
+		}
+		if (node.child1 == bestChild) {
+			node.child1 = bestGrandChild;
+		} else {
+			node.child2 = bestGrandChild;
+		}
+		nodes[bestChild].parent = other;
+		nodes[bestGrandChild].parent = index;
+
+		const Node& t1 = nodes[target.child1];
+		const Node& t2 = nodes[target.child2];
+		target.min = glm::min(t1.min, t2.min);
+		target.max = glm::max(t1.max, t2.max);
+		target.height = 1 + std::max(t1.height, t2.height);
+		node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+	}
+
+	// Builds the subtree over a range of leaves and returns its root
+	int Build(int* leaves, size_t count) {
+		if (count == 1) return leaves[0];
+
+		Vector3f centroidMin(std::numeric_limits<float>::max());
+		Vector3f centroidMax(std::numeric_limits<float>::lowest());
+		for (size_t i = 0; i < count; ++i) {
+			Vector3f centroid = nodes[leaves[i]].min + nodes[leaves[i]].max;
+			centroidMin = glm::min(centroidMin, centroid);
+			centroidMax = glm::max(centroidMax, centroid);
+		}
+		Vector3f spread = centroidMax - centroidMin;
+		int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+		size_t split = count / 2;
+		if (spread[axis] > 0.0f) {
+			struct Bin {
+				Vector3f min = Vector3f(std::numeric_limits<float>::max());
+				Vector3f max = Vector3f(std::numeric_limits<float>::lowest());
+				size_t count = 0;
+			} bins[BinCount];
+			float scale = BinCount / spread[axis] * 0.9999f;
+			auto binOf = [&](int leaf) {
+				float centroid = nodes[leaf].min[axis] + nodes[leaf].max[axis];
+				return std::min(BinCount - 1, static_cast<int>((centroid - centroidMin[axis]) * scale));
+			};
+			for (size_t i = 0; i < count; ++i) {
+				Bin& bin = bins[binOf(leaves[i])];
+				bin.min = glm::min(bin.min, nodes[leaves[i]].min);
+				bin.max = glm::max(bin.max, nodes[leaves[i]].max);
+				++bin.count;
+			}
+
+			// Cost of splitting after bin s: area of each side times the leaves on it
+			float rightCost[BinCount] = {};
+			Bin right;
+			for (int s = BinCount - 1; s > 0; --s) {
+				right.min = glm::min(right.min, bins[s].min);
+				right.max = glm::max(right.max, bins[s].max);
+				right.count += bins[s].count;
+				rightCost[s] = right.count ? Area(right.min, right.max) * right.count : 0.0f;
+			}
+			Bin left;
+			float bestCost = std::numeric_limits<float>::max();
+			int bestBin = -1;
+			for (int s = 1; s < BinCount; ++s) {
+				left.min = glm::min(left.min, bins[s - 1].min);
+				left.max = glm::max(left.max, bins[s - 1].max);
+				left.count += bins[s - 1].count;
+				if (left.count == 0 || left.count == count) continue;
+				float cost = Area(left.min, left.max) * left.count + rightCost[s];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestBin = s;
+				}
+			}
+			if (bestBin > 0) {
+				int* middle = std::partition(leaves, leaves + count, [&](int leaf) { return binOf(leaf) < bestBin; });
+				split = static_cast<size_t>(middle - leaves);
+			}
+		}
+		if (split == 0 || split == count || spread[axis] <= 0.0f) {
+			// Identical centroids: halve by count
+			split = count / 2;
+			std::nth_element(leaves, leaves + split, leaves + count, [&](int a, int b) {
+				return nodes[a].min[axis] + nodes[a].max[axis] < nodes[b].min[axis] + nodes[b].max[axis];
+			});
+		}
+
+		int child1 = Build(leaves, split);
+		int child2 = Build(leaves + split, count - split);
+		int index = Allocate();
+		Node& node = nodes[index];
+		node.child1 = child1;
+		node.child2 = child2;
+		node.min = glm::min(nodes[child1].min, nodes[child2].min);
+		node.max = glm::max(nodes[child1].max, nodes[child2].max);
+		node.height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+		nodes[child1].parent = index;
+		nodes[child2].parent = index;
+		return index;
+	}
+
+	std::vector<Node> nodes;
+	int root = Null;
+	int freeList = Null;
+	size_t leafCount = 0;
+};
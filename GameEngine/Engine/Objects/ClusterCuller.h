@@ -0,0 +1,123 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLUSTER_CULLER_SSE2 1
+#endif
+
+// Culls meshlets against a frustum and against their normal cones on the CPU.
+// Bounds are kept as structure of arrays padded to a multiple of four, so the SSE2 path tests
+// four meshlets per iteration; other targets use the scalar path.
+// All tests run in object space: frustum planes come straight from the model-view-projection
+// matrix and the camera position is transformed into object space.
+class ClusterCuller {
+public:
+	// Frustum planes (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside, normalized
+	struct Frustum {
+		glm::vec4 planes[6];
+
+		static Frustum FromMatrix(const glm::mat4& m) {
+			Frustum frustum;
+			glm::vec4 rows[4];
+			for (int i = 0; i < 4; ++i) rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+			frustum.planes[0] = rows[3] + rows[0];
+			frustum.planes[1] = rows[3] - rows[0];
+			frustum.planes[2] = rows[3] + rows[1];
+			frustum.planes[3] = rows[3] - rows[1];
+			frustum.planes[4] = rows[3] + rows[2];
+			frustum.planes[5] = rows[3] - rows[2];
+			for (auto& plane : frustum.planes) {
+				float length = glm::length(glm::vec3(plane));
+				if (length > 0.0f) plane /= length;
+			}
+			return frustum;
+		}
+	};
+
+	void SetMeshlets(const std::vector<Mesh::Meshlet>& meshlets) {
+		count = meshlets.size();
+		size_t padded = (count + 3) & ~size_t(3);
+		for (auto* column : { &centerX, &centerY, &centerZ, &radius, &axisX, &axisY, &axisZ, &cutoff }) {
+			column->assign(padded, 0.0f);
+		}
+		for (size_t i = 0; i < count; ++i) {
+			const auto& meshlet = meshlets[i];
+			centerX[i] = meshlet.center.x;
+			centerY[i] = meshlet.center.y;
+			centerZ[i] = meshlet.center.z;
+			radius[i] = meshlet.radius;
+			axisX[i] = meshlet.coneAxis.x;
+			axisY[i] = meshlet.coneAxis.y;
+			axisZ[i] = meshlet.coneAxis.z;
+			cutoff[i] = meshlet.coneCutoff;
+		}
+	}
+
+	size_t size() const { return count; }
+
+	// Writes 1 for every visible meshlet. Pass coneCulling = false for mirrored model matrices.
+	void Cull(const Frustum& frustum, const glm::vec3& cameraPosition, bool coneCulling, std::vector<uint8_t>& visible) const {
+		visible.resize((count + 3) & ~size_t(3));
+		size_t i = 0;
+#ifdef CLUSTER_CULLER_SSE2
+		const __m128 camX = _mm_set1_ps(cameraPosition.x);
+		const __m128 camY = _mm_set1_ps(cameraPosition.y);
+		const __m128 camZ = _mm_set1_ps(cameraPosition.z);
+		const __m128 zero = _mm_setzero_ps();
+		for (; i < visible.size(); i += 4) {
+			__m128 cx = _mm_loadu_ps(&centerX[i]);
+			__m128 cy = _mm_loadu_ps(&centerY[i]);
+			__m128 cz = _mm_loadu_ps(&centerZ[i]);
+			__m128 r = _mm_loadu_ps(&radius[i]);
+			__m128 negativeR = _mm_sub_ps(zero, r);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const auto& plane : frustum.planes) {
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+				                      _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negativeR));
+			}
+
+			if (coneCulling) {
+				__m128 dx = _mm_sub_ps(cx, camX);
+				__m128 dy = _mm_sub_ps(cy, camY);
+				__m128 dz = _mm_sub_ps(cz, camZ);
+				__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+				__m128 facing = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&axisX[i])), _mm_mul_ps(dy, _mm_loadu_ps(&axisY[i]))),
+				                           _mm_mul_ps(dz, _mm_loadu_ps(&axisZ[i])));
+				__m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cutoff[i]), distance), r);
+				inside = _mm_andnot_ps(_mm_cmpge_ps(facing, limit), inside);
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			visible[i] = mask & 1;
+			visible[i + 1] = (mask >> 1) & 1;
+			visible[i + 2] = (mask >> 2) & 1;
+			visible[i + 3] = (mask >> 3) & 1;
+		}
+#endif
+		for (; i < visible.size(); ++i) {
+			bool inside = true;
+			for (const auto& plane : frustum.planes) {
+				inside = inside && plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w >= -radius[i];
+			}
+			if (inside && coneCulling) {
+				glm::vec3 d(centerX[i] - cameraPosition.x, centerY[i] - cameraPosition.y, centerZ[i] - cameraPosition.z);
+				float facing = d.x * axisX[i] + d.y * axisY[i] + d.z * axisZ[i];
+				inside = facing < cutoff[i] * glm::length(d) + radius[i];
+			}
+			visible[i] = inside ? 1 : 0;
+		}
+		visible.resize(count);
+	}
+
+private:
+	size_t count = 0;
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<float> axisX, axisY, axisZ, cutoff;
+};
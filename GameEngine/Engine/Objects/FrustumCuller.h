@@ -0,0 +1,162 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "Bounds.h"
+#include "ClusterCuller.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX2 1
+#if defined(__GNUC__) || defined(__clang__)
+// Compiled for AVX2 on its own, so the rest of the engine needs no -mavx2 and older CPUs take the scalar path
+#define FRUSTUM_CULLER_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#include <intrin.h>
+#define FRUSTUM_CULLER_AVX2_TARGET
+#endif
+#endif
+
+// Objects tested and kept by the last Renderer::Render call or Scene::QueryFrustum
+struct FrustumCullStats {
+	size_t tested = 0;
+	size_t visible = 0;
+	size_t culled = 0;
+	size_t unbounded = 0;   // Instances without bounds, which are always drawn
+	size_t nodesVisited = 0; // Nodes of the scene's Bvh visited
+	double milliseconds = 0;
+	bool simd = false;      // Whether the AVX2 kernel ran
+};
+
+// Culls world space bounds against a camera frustum.
+// Bounds are kept as structure of arrays padded to a multiple of eight, so the AVX2 kernel tests eight
+// objects per iteration; it is picked at run time when the CPU has AVX2, and the scalar loop runs otherwise.
+// An object is kept unless its box or its sphere lies entirely outside one of the planes.
+class FrustumCuller {
+public:
+	using Frustum = ClusterCuller::Frustum;
+
+	// Set to false to always take the scalar path, e.g. to compare timings
+	static bool useSimd;
+
+	void Clear() {
+		count = 0;
+		for (auto* column : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius }) column->clear();
+	}
+
+	void Reserve(size_t capacity) {
+		for (auto* column : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius }) column->reserve(Padded(capacity));
+	}
+
+	// Adds the world space bounds of an object; returns its index in the visibility results
+	size_t Add(const Bounds& bounds) {
+		centerX.push_back(bounds.center.x);
+		centerY.push_back(bounds.center.y);
+		centerZ.push_back(bounds.center.z);
+		extentX.push_back(bounds.extent.x);
+		extentY.push_back(bounds.extent.y);
+		extentZ.push_back(bounds.extent.z);
+		radius.push_back(bounds.radius);
+		return count++;
+	}
+
+	size_t size() const { return count; }
+
+	// Writes 1 for every object that may be visible. Returns true if the AVX2 kernel ran.
+	bool Cull(const Frustum& frustum, std::vector<uint8_t>& visible) {
+		// Padding entries sit at the origin with no size and are cut off again below
+		size_t padded = Padded(count);
+		for (auto* column : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius }) column->resize(padded, 0.0f);
+		visible.resize(padded);
+
+		bool simd = false;
+#ifdef FRUSTUM_CULLER_AVX2
+		if (useSimd && HasAvx2()) {
+			CullAvx2(frustum, visible.data(), padded);
+			simd = true;
+		}
+#endif
+		if (!simd) CullScalar(frustum, visible.data(), padded);
+
+		for (auto* column : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius }) column->resize(count);
+		visible.resize(count);
+		return simd;
+	}
+
+	static bool HasAvx2() {
+#ifdef FRUSTUM_CULLER_AVX2
+		static const bool supported = []() {
+#if defined(__GNUC__) || defined(__clang__)
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") != 0;
+#else
+			int info[4];
+			__cpuid(info, 1);
+			bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+			__cpuidex(info, 7, 0);
+			return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#endif
+		}();
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+private:
+	static size_t Padded(size_t n) { return (n + 7) & ~size_t(7); }
+
+	// Signed distance of the center to each plane must not fall below the smaller of the box's and the
+	// sphere's reach towards the plane
+	void CullScalar(const Frustum& frustum, uint8_t* visible, size_t padded) const {
+		for (size_t i = 0; i < padded; ++i) {
+			bool inside = true;
+			for (const auto& plane : frustum.planes) {
+				float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+				float boxReach = std::abs(plane.x) * extentX[i] + std::abs(plane.y) * extentY[i] + std::abs(plane.z) * extentZ[i];
+				inside = inside && distance >= -glm::min(boxReach, radius[i]);
+			}
+			visible[i] = inside ? 1 : 0;
+		}
+	}
+
+#ifdef FRUSTUM_CULLER_AVX2
+	FRUSTUM_CULLER_AVX2_TARGET void CullAvx2(const Frustum& frustum, uint8_t* visible, size_t padded) const {
+		const __m256 signBit = _mm256_set1_ps(-0.0f);
+		for (size_t i = 0; i < padded; i += 8) {
+			__m256 cx = _mm256_loadu_ps(&centerX[i]);
+			__m256 cy = _mm256_loadu_ps(&centerY[i]);
+			__m256 cz = _mm256_loadu_ps(&centerZ[i]);
+			__m256 ex = _mm256_loadu_ps(&extentX[i]);
+			__m256 ey = _mm256_loadu_ps(&extentY[i]);
+			__m256 ez = _mm256_loadu_ps(&extentZ[i]);
+			__m256 r = _mm256_loadu_ps(&radius[i]);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (const auto& plane : frustum.planes) {
+				__m256 nx = _mm256_set1_ps(plane.x);
+				__m256 ny = _mm256_set1_ps(plane.y);
+				__m256 nz = _mm256_set1_ps(plane.z);
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, nx), _mm256_mul_ps(cy, ny)),
+				                                _mm256_add_ps(_mm256_mul_ps(cz, nz), _mm256_set1_ps(plane.w)));
+				__m256 boxReach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_andnot_ps(signBit, nx)),
+				                                              _mm256_mul_ps(ey, _mm256_andnot_ps(signBit, ny))),
+				                                _mm256_mul_ps(ez, _mm256_andnot_ps(signBit, nz)));
+				__m256 reach = _mm256_min_ps(boxReach, r);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+
+			int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; ++lane) visible[i + lane] = (mask >> lane) & 1;
+		}
+	}
+#endif
+
+	size_t count = 0;
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	std::vector<float> radius;
+};
+
+bool FrustumCuller::useSimd = true;
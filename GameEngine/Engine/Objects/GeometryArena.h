@@ -0,0 +1,179 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "../Core.h"
+#include "Mesh.h"
+
+class GeometryArena;
+
+// Ranges of one mesh in a GeometryArena, in vertices and indices
+struct ArenaAllocation {
+  GeometryArena* arena = nullptr;
+  GLuint firstVertex = 0;
+  GLuint vertexCount = 0;
+  GLuint firstIndex = 0;
+  GLuint indexCount = 0;
+};
+
+// One vertex buffer and one index buffer holding the meshes of a vertex format and index type, so all of
+// them draw from one vertex array and a whole pass can go out in one glMultiDrawElementsIndirect call.
+// Meshes are copied in on the GPU from the buffers GeometryContainer uploaded them to, which stay in use
+// by the other draw paths. Ranges are allocated first fit; when none fits, the buffers double and the
+// old contents are copied over, so allocations keep their offsets.
+class GeometryArena {
+public:
+  // Copies every mesh GeometryContainer::SetVertexData uploads into the arena of its format
+  static bool enabled;
+
+  // The arena of a vertex format and index type, created on first use
+  static GeometryArena& Get(const VertexFormat& format, GLenum indexType) {
+    for (GeometryArena* arena : arenas) {
+      if (arena->format == format && arena->indexType == indexType) return *arena;
+    }
+    arenas.push_back(new GeometryArena(format, indexType, static_cast<uint32_t>(arenas.size())));
+    return *arenas.back();
+  }
+
+  static const std::vector<GeometryArena*>& GetArenas() {
+    return arenas;
+  }
+
+  // Copies a mesh's vertex and index buffers into the arena
+  bool Add(const VertexBuffer& vertices, const ElementBuffer& indices, ArenaAllocation& allocation) {
+    GLuint vertexCount = static_cast<GLuint>(vertices.bufferSize / stride);
+    GLuint indexCount = static_cast<GLuint>(indices.bufferSize / Mesh::IndexSize(indexType));
+    if (vertexCount == 0 || indexCount == 0) return false;
+
+    allocation = ArenaAllocation();
+    allocation.arena = this;
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indexCount;
+    allocation.firstVertex = Allocate(vertexRanges, vertexCount);
+    allocation.firstIndex = Allocate(indexRanges, indexCount);
+    Reserve(vertexRanges.end, indexRanges.end);
+
+    Copy(vertices.ID, vertexBuffer->ID, 0, GLintptr(allocation.firstVertex) * stride, vertices.bufferSize);
+    Copy(indices.ID, indexBuffer->ID, 0, GLintptr(allocation.firstIndex) * Mesh::IndexSize(indexType), indices.bufferSize);
+    return true;
+  }
+
+  // Returns the ranges of a mesh to the arena
+  void Free(const ArenaAllocation& allocation) {
+    Release(vertexRanges, allocation.firstVertex, allocation.vertexCount);
+    Release(indexRanges, allocation.firstIndex, allocation.indexCount);
+  }
+
+  void Bind() const {
+    vertexArray.Bind();
+  }
+
+  GLenum GetIndexType() const { return indexType; }
+  uint32_t GetIndex() const { return index; }
+
+  // Vertices and indices in use, and the capacity of the buffers in bytes
+  size_t GetVertexCount() const { return vertexRanges.used; }
+  size_t GetIndexCount() const { return indexRanges.used; }
+  size_t GetCapacityBytes() const {
+    return (vertexBuffer ? vertexBuffer->bufferSize : 0) + (indexBuffer ? indexBuffer->bufferSize : 0);
+  }
+
+private:
+  struct Range {
+    GLuint start;
+    GLuint count;
+  };
+
+  // Free ranges sorted by start, below the end of the used part
+  struct RangeList {
+    std::vector<Range> free;
+    GLuint end = 0;
+    size_t used = 0;
+  };
+
+  GeometryArena(const VertexFormat& format, GLenum indexType, uint32_t index)
+    : format(format), indexType(indexType), index(index) {
+    stride = format.getAttributes().empty() ? 1 : format.getAttributes()[0].stride;
+  }
+
+  static GLuint Allocate(RangeList& list, GLuint count) {
+    list.used += count;
+    for (size_t i = 0; i < list.free.size(); ++i) {
+      Range& range = list.free[i];
+      if (range.count < count) continue;
+      GLuint start = range.start;
+      range.start += count;
+      range.count -= count;
+      if (range.count == 0) list.free.erase(list.free.begin() + i);
+      return start;
+    }
+    GLuint start = list.end;
+    list.end += count;
+    return start;
+  }
+
+  // Inserts a range into the free list, merging it with its neighbours and with the unused tail
+  static void Release(RangeList& list, GLuint start, GLuint count) {
+    list.used -= count;
+    auto next = std::lower_bound(list.free.begin(), list.free.end(), start, [](const Range& range, GLuint value) {
+      return range.start < value;
+    });
+    next = list.free.insert(next, { start, count });
+    if (next + 1 != list.free.end() && next->start + next->count == (next + 1)->start) {
+      next->count += (next + 1)->count;
+      list.free.erase(next + 1);
+    }
+    if (next != list.free.begin() && (next - 1)->start + (next - 1)->count == next->start) {
+      (next - 1)->count += next->count;
+      next = list.free.erase(next) - 1;
+    }
+    if (next->start + next->count == list.end) {
+      list.end = next->start;
+      list.free.erase(next);
+    }
+  }
+
+  // Grows the buffers to hold the given number of vertices and indices
+  void Reserve(GLuint vertices, GLuint indices) {
+    bool grown = Grow(vertexBuffer, GLsizeiptr(vertices) * stride);
+    grown = Grow(indexBuffer, GLsizeiptr(indices) * Mesh::IndexSize(indexType)) || grown;
+    if (!grown) return;
+    vertexArray.AddVertexBuffer(*vertexBuffer, format);
+    vertexArray.AddIndexBuffer(*indexBuffer);
+  }
+
+  template<typename BufferType>
+  static bool Grow(std::unique_ptr<BufferType>& buffer, GLsizeiptr size) {
+    GLsizeiptr capacity = buffer ? buffer->bufferSize : 0;
+    if (size <= capacity) return false;
+    auto grown = std::make_unique<BufferType>();
+    grown->SetData(nullptr, std::max({ size, capacity * 2, GLsizeiptr(1) << 20 }), GL_STATIC_DRAW);
+    if (buffer) Copy(buffer->ID, grown->ID, 0, 0, capacity);
+    buffer = std::move(grown);
+    return true;
+  }
+
+  static void Copy(GLuint source, GLuint destination, GLintptr sourceOffset, GLintptr destinationOffset, GLsizeiptr size) {
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destinationOffset, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  VertexFormat format;
+  GLenum indexType;
+  uint32_t index;
+  GLsizei stride;
+  std::unique_ptr<VertexBuffer> vertexBuffer;
+  std::unique_ptr<ElementBuffer> indexBuffer;
+  VertexArray vertexArray;
+  RangeList vertexRanges;
+  RangeList indexRanges;
+
+  // Never deleted: containers may return their ranges while static objects are destroyed
+  static std::vector<GeometryArena*> arenas;
+};
+
+bool GeometryArena::enabled = false;
+std::vector<GeometryArena*> GeometryArena::arenas;
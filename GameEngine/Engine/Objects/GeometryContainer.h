@@ -1,5 +1,18 @@
 #pragma once
+#include <vector>
+#include <algorithm>
 #include "../Core.h"
+#include "Mesh.h"
+#include "ClusterCuller.h"
+#include "GeometryArena.h"
+
+// Result of the last DrawClusters call
+struct ClusterCullStats {
+  size_t clusters = 0;
+  size_t visibleClusters = 0;
+  size_t draws = 0;
+  size_t triangles = 0;
+};
 
 class GeometryContainer {
 public:
@@ -9,22 +22,81 @@ public:
   // VertexArray object
   VertexArray vertexArray;
 
+  // Index ranges copied from the mesh; empty draws the whole index buffer
+  std::vector<Mesh::SubMesh> subMeshes;
+
+  // Level of detail ranges copied from the mesh; empty when the mesh has no chain
+  std::vector<Mesh::LodLevel> lods;
+
+  // Meshlets of level 0, culled by DrawClusters; empty when the mesh has none
+  std::vector<Mesh::Meshlet> meshlets;
+  ClusterCuller clusterCuller;
+  ClusterCullStats lastClusterStats;
+
+  // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT, copied from the mesh
+  GLenum indexType = GL_UNSIGNED_INT;
+
+  // Dequantization for compact position encodings; Object sets it as the positionScale/positionOffset
+  // uniforms, or folds it into the model matrices of multi draws
+  Vector3f positionScale = Vector3f(1.0f);
+  Vector3f positionOffset = Vector3f(0.0f);
+
+  // Object space bounds and UV density copied from the mesh, used to cull and to estimate texture detail on screen
+  Vector3f boundsMin = Vector3f(0.0f);
+  Vector3f boundsMax = Vector3f(0.0f);
+  float boundsRadius = 0.0f;
+  float uvDensity = 0.0f;
+
+  // Copy of the mesh in the GeometryArena of its format, drawn by multi draw indirect; no arena unless
+  // GeometryArena::enabled was set when the mesh was uploaded
+  ArenaAllocation arenaAllocation;
+
   // Constructor: Initialize with empty buffers
   GeometryContainer() = default;
 
+  ~GeometryContainer() {
+    if (arenaAllocation.arena) arenaAllocation.arena->Free(arenaAllocation);
+  }
+
   // Set vertex data and index data
   void SetVertexData(const Mesh& mesh) {
     // Set data for vertex buffer
-    vertexBuffer.SetData(mesh.vertexData.get(), mesh.vertexDataSize, mesh.usage);
+    if (!mesh.vertexData && mesh.mappedStorage) {
+      UploadPaged(vertexBuffer, *mesh.mappedStorage, mesh.GetVertexData(), mesh.vertexDataSize, mesh.usage);
+    } else {
+      vertexBuffer.SetData(mesh.GetVertexData(), mesh.vertexDataSize, mesh.usage);
+    }
 
     // Set data for index buffer
-    indexBuffer.SetData(mesh.indexData.get(), mesh.indexDataSize, mesh.usage);
+    if (!mesh.indexData && mesh.mappedStorage) {
+      UploadPaged(indexBuffer, *mesh.mappedStorage, mesh.GetIndexData(), mesh.indexDataSize, mesh.usage);
+    } else {
+      indexBuffer.SetData(mesh.GetIndexData(), mesh.indexDataSize, mesh.usage);
+    }
 
     // Bind vertex array and add the buffers
     vertexArray.Bind();
     vertexArray.AddVertexBuffer(vertexBuffer, mesh.vertexFormat);
     vertexArray.AddIndexBuffer(indexBuffer);
     vertexArray.Unbind();
+
+    subMeshes = mesh.subMeshes;
+    lods = mesh.lods;
+    meshlets = mesh.meshlets;
+    clusterCuller.SetMeshlets(meshlets);
+    indexType = mesh.indexType;
+    positionScale = mesh.positionScale;
+    positionOffset = mesh.positionOffset;
+    boundsMin = mesh.boundsMin;
+    boundsMax = mesh.boundsMax;
+    boundsRadius = mesh.boundsRadius;
+    uvDensity = mesh.uvDensity;
+
+    if (arenaAllocation.arena) arenaAllocation.arena->Free(arenaAllocation);
+    arenaAllocation = ArenaAllocation();
+    if (GeometryArena::enabled) {
+      GeometryArena::Get(mesh.vertexFormat, indexType).Add(vertexBuffer, indexBuffer, arenaAllocation);
+    }
   }
 
   // Bind and unbind Mesh (VAO will handle everything)
@@ -41,11 +113,163 @@ public:
   }
 
   void Draw() const {
+    if (!lods.empty()) {
+      DrawLod(0);
+      return;
+    }
+
+    if (subMeshes.empty()) {
+      glDrawElements(
+        GL_TRIANGLES,
+        indexBuffer.bufferSize/Mesh::IndexSize(indexType),
+        indexType,
+        0
+      );
+      return;
+    }
+
+    for (size_t i = 0; i < subMeshes.size(); ++i) {
+      DrawSubMesh(i);
+    }
+  }
+
+  // Draw a single submesh (e.g. to bind a different material per glTF primitive)
+  void DrawSubMesh(size_t index) const {
+    const Mesh::SubMesh& subMesh = subMeshes[index];
+    glDrawElementsBaseVertex(
+      GL_TRIANGLES,
+      subMesh.indexCount,
+      indexType,
+      (void*)(subMesh.firstIndex * Mesh::IndexSize(indexType)),
+      subMesh.baseVertex
+    );
+  }
+
+  // Draw one level of detail (0 = full mesh)
+  void DrawLod(size_t level) const {
+    const Mesh::LodLevel& lod = lods[level];
     glDrawElements(
       GL_TRIANGLES,
-      indexBuffer.bufferSize/sizeof(unsigned int),
-      GL_UNSIGNED_INT,
-      0
+      lod.indexCount,
+      indexType,
+      (void*)(lod.firstIndex * Mesh::IndexSize(indexType))
+    );
+  }
+
+  // Draws instanceCount copies of one level of detail (0 = full mesh) in one call; the shader tells them
+  // apart by gl_InstanceID
+  void DrawInstanced(size_t level, GLsizei instanceCount) const {
+    size_t indexSize = Mesh::IndexSize(indexType);
+    if (!lods.empty()) {
+      const Mesh::LodLevel& lod = lods[level];
+      glDrawElementsInstanced(GL_TRIANGLES, lod.indexCount, indexType, (void*)(lod.firstIndex * indexSize), instanceCount);
+      return;
+    }
+
+    if (subMeshes.empty()) {
+      glDrawElementsInstanced(GL_TRIANGLES, indexBuffer.bufferSize / indexSize, indexType, 0, instanceCount);
+      return;
+    }
+
+    for (const Mesh::SubMesh& subMesh : subMeshes) {
+      glDrawElementsInstancedBaseVertex(GL_TRIANGLES, subMesh.indexCount, indexType,
+                                        (void*)(subMesh.firstIndex * indexSize), instanceCount, subMesh.baseVertex);
+    }
+  }
+
+  // Appends the indirect draw commands of one level of detail (0 = full mesh) in the arena, one per
+  // submesh, each drawing one instance starting at baseInstance
+  void AppendDrawCommands(size_t level, GLuint baseInstance, std::vector<DrawElementsIndirectCommand>& commands) const {
+    const ArenaAllocation& range = arenaAllocation;
+    if (!lods.empty()) {
+      const Mesh::LodLevel& lod = lods[level];
+      commands.push_back({ GLuint(lod.indexCount), 1, range.firstIndex + lod.firstIndex, GLint(range.firstVertex), baseInstance });
+      return;
+    }
+
+    if (subMeshes.empty()) {
+      commands.push_back({ range.indexCount, 1, range.firstIndex, GLint(range.firstVertex), baseInstance });
+      return;
+    }
+
+    for (const Mesh::SubMesh& subMesh : subMeshes) {
+      commands.push_back({ GLuint(subMesh.indexCount), 1, range.firstIndex + subMesh.firstIndex,
+                           GLint(range.firstVertex) + subMesh.baseVertex, baseInstance });
+    }
+  }
+
+  // Coarsest level whose error stays below maxPixelError on screen.
+  // pixelsPerUnit is the projected size of one object space unit at distance 1.
+  size_t SelectLod(float distance, float pixelsPerUnit, float maxPixelError) const {
+    size_t level = 0;
+    while (level + 1 < lods.size() && lods[level + 1].error * pixelsPerUnit <= maxPixelError * distance) {
+      ++level;
+    }
+    return level;
+  }
+
+  // Culls the meshlets against the frustum of modelViewProjection and their normal cones, then draws
+  // the surviving ones. Neighbouring survivors are merged into one range and all ranges go out in a
+  // single glMultiDrawElementsBaseVertex call. objectSpaceCamera is the camera position in object space.
+  void DrawClusters(const Matrix4f& modelViewProjection, const Vector3f& objectSpaceCamera, bool coneCulling = true) {
+    clusterCuller.Cull(ClusterCuller::Frustum::FromMatrix(modelViewProjection), objectSpaceCamera, coneCulling, visibleClusters);
+
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    lastClusterStats = ClusterCullStats();
+    lastClusterStats.clusters = meshlets.size();
+
+    size_t indexSize = Mesh::IndexSize(indexType);
+    GLuint end = 0;
+    for (size_t i = 0; i < meshlets.size(); ++i) {
+      if (!visibleClusters[i]) continue;
+      const Mesh::Meshlet& meshlet = meshlets[i];
+      lastClusterStats.visibleClusters++;
+      lastClusterStats.triangles += meshlet.indexCount / 3;
+
+      if (!drawCounts.empty() && meshlet.firstIndex == end && meshlet.baseVertex == drawBaseVertices.back()) {
+        drawCounts.back() += meshlet.indexCount;
+      } else {
+        drawCounts.push_back(meshlet.indexCount);
+        drawOffsets.push_back((const void*)(meshlet.firstIndex * indexSize));
+        drawBaseVertices.push_back(meshlet.baseVertex);
+      }
+      end = meshlet.firstIndex + meshlet.indexCount;
+    }
+
+    lastClusterStats.draws = drawCounts.size();
+    if (drawCounts.empty()) return;
+    glMultiDrawElementsBaseVertex(
+      GL_TRIANGLES,
+      drawCounts.data(),
+      indexType,
+      drawOffsets.data(),
+      static_cast<GLsizei>(drawCounts.size()),
+      drawBaseVertices.data()
     );
   }
+
+private:
+  static constexpr GLsizeiptr UploadPageSize = GLsizeiptr(4) << 20;
+
+  // Uploads a blob that lives in a mapping page by page and drops every page from memory once it
+  // is on the GPU, so large cooked meshes never become resident all at once
+  template<typename BufferType>
+  static void UploadPaged(BufferType& buffer, const MappedFile& storage, const void* data, GLsizeiptr size, GLenum usage) {
+    buffer.SetData(nullptr, size, usage);
+    const char* bytes = static_cast<const char*>(data);
+    size_t offset = static_cast<size_t>(bytes - storage.data());
+    for (GLsizeiptr done = 0; done < size; done += UploadPageSize) {
+      GLsizeiptr page = std::min(UploadPageSize, size - done);
+      buffer.SetSubData(done, bytes + done, page);
+      storage.evict(offset + static_cast<size_t>(done), static_cast<size_t>(page));
+    }
+  }
+
+  // Scratch storage reused by DrawClusters every frame
+  std::vector<uint8_t> visibleClusters;
+  std::vector<GLsizei> drawCounts;
+  std::vector<const void*> drawOffsets;
+  std::vector<GLint> drawBaseVertices;
 };
\ No newline at end of file
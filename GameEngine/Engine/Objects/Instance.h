@@ -3,9 +3,11 @@
 #include <string>
 #include <memory>
 #include <iomanip>
-#
+#include "Bounds.h"
 
 class Scene;
+class RenderQueue;
+struct RenderPacket;
 
 static std::vector<int> idVector; // Vector storing the IDs (last used ID at the end)
 
@@ -43,6 +45,28 @@ public:
     virtual void OnCreation() = 0;  // Must be overridden
     virtual void Render() = 0;
 
+    // World space bounds used to cull the instance; instances without bounds are always rendered
+    virtual bool GetWorldBounds(Bounds& /*bounds*/) const { return false; }
+
+    // Queues the draws of a visible instance for the frame (see RenderQueue); by default one packet that
+    // renders before everything else of the first pass
+    virtual void Submit(RenderQueue& queue, const Vector3f& viewPosition);
+
+    // Renders a run of consecutive packets submitted with the same batch value, the first of which is this
+    // instance's; by default one after the other
+    virtual void RenderBatch(const RenderPacket* packets, size_t count, RenderQueue& queue);
+
+    // World space bounds as of the scene's last update of the instance; unset while it has no bounds
+    const Bounds& GetIndexedBounds() const { return worldBounds; }
+
+    // Has the scene refit the instance in its spatial index on its next Update; call after anything its world
+    // bounds depend on changed (Object does so for its transform and geometry)
+    void MarkDirty();
+
+    // Static instances are stored in the scene's spatial index with tight bounds, dynamic ones (the default)
+    // with a margin so small moves leave the index untouched
+    bool IsStatic() const { return isStatic; }
+
     // Getters
     const std::string& getId() const { return id; }
     const std::string& getName() const { return name; }
@@ -51,4 +75,14 @@ public:
     // Static creation method (One-line instance creation)
     template <typename T, typename... Args>
     static T* Create(Scene& targetScene, const std::string& instanceName, Args&&... args);
+
+private:
+    friend class Scene;
+
+    // Kept by the scene: leaf of the instance in its Bvh (-1 while it has no bounds) and the bounds stored there
+    int spatialProxy = -1;
+    bool isStatic = false;
+    bool dirty = false; // In the scene's list of instances to refit on the next update
+    bool unboundedListed = false; // In the scene's list of instances without bounds, retried on every update
+    Bounds worldBounds;
 };
\ No newline at end of file
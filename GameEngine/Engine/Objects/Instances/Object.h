@@ -3,31 +3,198 @@
 #include "../Instance.h"
 #include "../Transform.h"
 #include "../Material.h"
+#include "../RenderQueue.h"
 
 class Object : public Instance {
   public:
 	Transform transform;
-	GeometryContainer geometry;
+	// Shared between objects drawing the same mesh (see AssetService::LoadGeometryAsync); null until a mesh is set
+	std::shared_ptr<GeometryContainer> geometry;
     Material* material;
 
 	Object(const std::string& name, Scene* scene, Material* material) : Instance(name, scene), material(material) {
 		transform = Transform();
+		// Moving the object has the scene refit it on its next update
+		transform.onChanged = [this]() { MarkDirty(); };
 	}
 
      ~Object() = default;
 
 	void OnCreation() override {};
 
+	// Uploads the mesh into buffers owned by this object
 	void SetMesh(const Mesh* mesh) {
-		geometry.SetVertexData(*mesh);
+		geometry = std::make_shared<GeometryContainer>();
+		geometry->SetVertexData(*mesh);
+		MarkDirty();
+	}
+
+	// Draws geometry that is already uploaded, without a copy of its buffers
+	void SetGeometry(std::shared_ptr<GeometryContainer> sharedGeometry) {
+		geometry = std::move(sharedGeometry);
+		MarkDirty();
 	}
 
      void Render() override {
-     	geometry.Bind();
+		// Nothing to draw until a mesh is set, e.g. while it is still loading
+		if (!geometry || geometry->indexBuffer.bufferSize == 0) return;
+
+     	geometry->Bind();
 		material->Use(this);
+		SetPositionDequantization(*material->shader);
 
-       	geometry.Draw();
+		const Camera* camera = Renderer::activeCamera;
+		if (camera && !material->textures.empty()) RequestTextureResolution(*camera);
+		size_t level = geometry->lods.size() > 1 && camera ? SelectLod(*camera) : 0;
+		if (level == 0 && !geometry->meshlets.empty() && camera) {
+			Matrix4f model = transform.GetModelMatrix();
+			Vector3f objectSpaceCamera = Vector3f(glm::inverse(model) * glm::vec4(camera->transform.position, 1.0f));
+			// Mirrored transforms flip the winding, which the normal cones assume
+			geometry->DrawClusters(camera->GetProjectionMatrix() * camera->GetViewMatrix() * model, objectSpaceCamera,
+			                      glm::determinant(model) > 0.0f);
+		} else if (level > 0) {
+			geometry->DrawLod(level);
+		} else {
+			geometry->Draw();
+		}
 
 
      }
-};
\ No newline at end of file
+
+	// Keyed by shader, material and mesh, so objects sharing them draw together, and by the squared distance
+	// of the bounds' center to the camera. With a multi draw shader in the material, objects whose meshes are in
+	// the same arena are batched: the batch value holds the material and the arena. Otherwise, with an instanced
+	// shader, objects drawing the same level of detail of the mesh are: the batch value holds the material, the
+	// vertex array and the level.
+	void Submit(RenderQueue& queue, const Vector3f& viewPosition) override {
+		if (!geometry || geometry->indexBuffer.bufferSize == 0) return;
+		Vector3f offset = GetIndexedBounds().center - viewPosition;
+		uint64_t key = RenderQueue::MakeKey(material->pass, material->transparent, material->shader->ID, material->sortId,
+		                                    geometry->vertexArray.ID, glm::dot(offset, offset));
+		uint64_t batch = 0;
+		if (material->multiDrawShader && geometry->arenaAllocation.arena) {
+			batch = MultiDrawBatch | (uint64_t(material->sortId) << 24) | geometry->arenaAllocation.arena->GetIndex();
+		} else if (material->instancedShader) {
+			const Camera* camera = Renderer::activeCamera;
+			size_t level = geometry->lods.size() > 1 && camera ? SelectLod(*camera) : 0;
+			batch = (uint64_t(material->sortId) << 40) | (uint64_t(geometry->vertexArray.ID) << 8) | level;
+		}
+		queue.Submit(key, this, batch);
+	}
+
+	// Draws the objects of a batch (see Submit) with one instanced draw of the material's instanced shader.
+	// The material's uniforms are set for this object only; the model matrices go to the instance buffer.
+	// All objects of a batch draw the same mesh, so they share its position dequantization.
+	void RenderBatch(const RenderPacket* packets, size_t count, RenderQueue& queue) override {
+		if (packets[0].batch & MultiDrawBatch) {
+			RenderMultiDraw(packets, count, queue);
+			return;
+		}
+
+		const Camera* camera = Renderer::activeCamera;
+		batchMatrices.resize(count);
+		for (size_t i = 0; i < count; ++i) {
+			const Object* object = static_cast<const Object*>(packets[i].instance);
+			batchMatrices[i] = object->transform.GetModelMatrix();
+			if (camera && !material->textures.empty()) object->RequestTextureResolution(*camera);
+		}
+		GLint base = queue.UploadInstanceData(batchMatrices.data(), count * sizeof(Matrix4f), sizeof(Matrix4f));
+
+		geometry->Bind();
+		material->Use(this, material->instancedShader);
+		SetPositionDequantization(*material->instancedShader);
+		material->instancedShader->SetUniform("instanceBase", base);
+		geometry->DrawInstanced(static_cast<size_t>(packets[0].batch & 0xFF), static_cast<GLsizei>(count));
+	}
+
+	// Bounds of the geometry under the current transform; none until a mesh is set
+	bool GetWorldBounds(Bounds& bounds) const override {
+		if (!geometry || geometry->indexBuffer.bufferSize == 0) return false;
+		bounds = Bounds::FromBox(geometry->boundsMin, geometry->boundsMax, geometry->boundsRadius).Transformed(transform.GetModelMatrix());
+		return true;
+	}
+
+	// Level of detail whose error projects to at most Renderer::lodPixelError pixels
+	size_t SelectLod(const Camera& camera) const {
+		float scale = glm::max(transform.scale.x, glm::max(transform.scale.y, transform.scale.z));
+		float distance = glm::max(glm::length(camera.transform.position - transform.position), camera.nearPlane);
+		float pixelsPerUnit = camera.GetProjectionMatrix()[1][1] * 0.5f * static_cast<float>(Screen::height) * scale;
+		return geometry->SelectLod(distance, pixelsPerUnit, Renderer::lodPixelError);
+	}
+
+	// Tells the texture streamer how many pixels one UV unit of the material's textures covers at the
+	// nearest point of the bounds
+	void RequestTextureResolution(const Camera& camera) const {
+		float scale = glm::max(transform.scale.x, glm::max(transform.scale.y, transform.scale.z));
+		Vector3f extent = geometry->boundsMax - geometry->boundsMin;
+		Vector3f center = Vector3f(transform.GetModelMatrix() * glm::vec4((geometry->boundsMin + geometry->boundsMax) * 0.5f, 1.0f));
+		float radius = glm::length(extent) * 0.5f * scale;
+		float distance = glm::max(glm::length(camera.transform.position - center) - radius, camera.nearPlane);
+		float pixelsPerUnit = camera.GetProjectionMatrix()[1][1] * 0.5f * static_cast<float>(Screen::height) * scale;
+		// Without UVs, assume the texture is stretched once over the largest side
+		float largestSide = glm::max(extent.x, glm::max(extent.y, extent.z));
+		float uvDensity = geometry->uvDensity > 0.0f ? geometry->uvDensity : 1.0f / glm::max(largestSide, 1e-6f);
+		float pixelsPerUv = pixelsPerUnit / (distance * uvDensity);
+		for (const Texture* texture : material->textures) TextureStreamer::RequestResolution(texture, pixelsPerUv);
+	}
+
+	// Sets the positionScale/positionOffset uniforms of shaders reading compact vertex encodings (see
+	// MeshQuantizer). Shaders of float meshes don't declare them and are left alone.
+	void SetPositionDequantization(ShaderProgram& program) const {
+		if (!program.HasUniform("positionScale")) return;
+		program.SetUniform("positionScale", geometry->positionScale);
+		program.SetUniform("positionOffset", geometry->positionOffset);
+	}
+
+private:
+	static constexpr uint64_t MultiDrawBatch = uint64_t(1) << 63;
+
+	// Draws a multi draw batch (see Submit) from the arena with one glMultiDrawElementsIndirect call: one
+	// command per mesh range, with consecutive objects drawing the same level of the same mesh merged into
+	// one command of several instances. Each object's matrix includes its mesh's position dequantization.
+	void RenderMultiDraw(const RenderPacket* packets, size_t count, RenderQueue& queue) {
+		const Camera* camera = Renderer::activeCamera;
+		batchMatrices.resize(count);
+		batchCommands.clear();
+		const GeometryContainer* previous = nullptr;
+		size_t previousLevel = 0;
+		size_t previousCommands = 0; // First command of the previous object
+		for (size_t i = 0; i < count; ++i) {
+			const Object* object = static_cast<const Object*>(packets[i].instance);
+			const GeometryContainer& mesh = *object->geometry;
+			Matrix4f model = object->transform.GetModelMatrix();
+			if (mesh.positionScale != Vector3f(1.0f) || mesh.positionOffset != Vector3f(0.0f)) {
+				model = glm::scale(glm::translate(model, mesh.positionOffset), mesh.positionScale);
+			}
+			batchMatrices[i] = model;
+			if (camera && !material->textures.empty()) object->RequestTextureResolution(*camera);
+
+			size_t level = mesh.lods.size() > 1 && camera ? object->SelectLod(*camera) : 0;
+			if (&mesh == previous && level == previousLevel) {
+				for (size_t c = previousCommands; c < batchCommands.size(); ++c) batchCommands[c].instanceCount++;
+				continue;
+			}
+			previous = &mesh;
+			previousLevel = level;
+			previousCommands = batchCommands.size();
+			mesh.AppendDrawCommands(level, static_cast<GLuint>(i), batchCommands);
+		}
+
+		GLint base = queue.UploadInstanceData(batchMatrices.data(), count * sizeof(Matrix4f), sizeof(Matrix4f));
+		for (DrawElementsIndirectCommand& command : batchCommands) command.baseInstance += static_cast<GLuint>(base);
+		size_t offset = queue.UploadDrawCommands(batchCommands.data(), batchCommands.size());
+
+		GeometryArena& arena = *geometry->arenaAllocation.arena;
+		arena.Bind();
+		material->Use(this, material->multiDrawShader);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, arena.GetIndexType(), (const void*)offset,
+		                            static_cast<GLsizei>(batchCommands.size()), 0);
+	}
+
+	// Model matrices and indirect draw commands of the batch being drawn
+	static std::vector<Matrix4f> batchMatrices;
+	static std::vector<DrawElementsIndirectCommand> batchCommands;
+};
+
+std::vector<Matrix4f> Object::batchMatrices;
+std::vector<DrawElementsIndirectCommand> Object::batchCommands;
\ No newline at end of file
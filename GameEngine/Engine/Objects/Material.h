@@ -28,10 +28,27 @@ class Material {
 public:
     std::vector<UniformValue> uniforms;
     ShaderProgram* shader;
+    // Textures sampled by the material; streamed ones keep the mips the objects drawn with it need
+    std::vector<Texture*> textures;
+
+    // Drawn after the opaque geometry of its pass, farthest first, with alpha blending and no depth writes
+    bool transparent = false;
+    // Render queue pass, 0 to 15; lower passes draw first
+    uint8_t pass = 0;
+    // Variant of the shader built with the INSTANCED define (see ShaderVariants), which reads the model
+    // matrices from RenderQueue's instance buffer. When set, visible objects sharing the material and a mesh
+    // are drawn with one instanced draw call.
+    ShaderProgram* instancedShader = nullptr;
+    // Variant built with the MULTI_DRAW define, which reads the model matrices at gl_BaseInstance + gl_InstanceID.
+    // When set, visible objects sharing the material whose meshes are in the same GeometryArena are drawn with
+    // one glMultiDrawElementsIndirect call, whatever their meshes; this takes precedence over instancedShader.
+    ShaderProgram* multiDrawShader = nullptr;
+    // Identifies the material in render queue keys
+    const uint32_t sortId;
 
     // Constructor that allows adding uniforms directly to the Material
     template<typename... Args>
-    Material(ShaderProgram* program, Args&&... args) {
+    Material(ShaderProgram* program, Args&&... args) : sortId(nextSortId++) {
         shader = program;
         (AddUniform(std::forward<Args>(args)), ...); // Renamed SetUniform to AddUniform
     }
@@ -41,11 +58,21 @@ public:
         uniforms.push_back(uniform);
     }
 
+    // Function to register a texture the material samples
+    void AddTexture(Texture* texture) {
+        textures.push_back(texture);
+    }
+
     // Use function that sets all uniforms
     void Use(Object* obj) {
-        shader->Use();
+        Use(obj, shader);
+    }
+
+    // Same with another program built from the material's shaders, e.g. instancedShader
+    void Use(Object* obj, ShaderProgram* program) {
+        program->Use();
         for (const auto& uniform : uniforms) {
-            shader->NoTypeSetUniform(uniform.name, uniform.getValue(obj, shader));
+            program->NoTypeSetUniform(uniform.name, uniform.getValue(obj, program));
         }
     }
 
@@ -53,4 +80,9 @@ public:
       ShaderProgram::UnBind();
       Texture::UnBind();
     }
+
+private:
+    static uint32_t nextSortId;
 };
+
+uint32_t Material::nextSortId = 1;
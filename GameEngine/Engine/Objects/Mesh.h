@@ -1,23 +1,87 @@
 #pragma once
 #include <memory>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
 #include "Material.h"
 #include "../Core.h"
+#include "../FileSystem/MappedFile.h"
 
 class Mesh {
 public:
+	// A range of the index buffer drawn with its own base vertex (e.g. one glTF primitive)
+	struct SubMesh {
+		GLuint firstIndex = 0;
+		GLsizei indexCount = 0;
+		GLint baseVertex = 0;
+	};
+
+	// A simplified index range over the same vertices (see MeshSimplifier)
+	struct LodLevel {
+		GLuint firstIndex = 0;
+		GLsizei indexCount = 0;
+		float error = 0.0f; // Object space distance from level 0
+	};
+
+	static constexpr size_t MaxLods = 8;
+
+	// A small cluster of consecutive triangles with culling bounds (see MeshletBuilder)
+	struct Meshlet {
+		GLuint firstIndex = 0;
+		GLsizei indexCount = 0;
+		GLint baseVertex = 0;
+		GLuint vertexCount = 0;
+		Vector3f center = Vector3f(0.0f);
+		float radius = 0.0f;
+		Vector3f coneAxis = Vector3f(0.0f);
+		float coneCutoff = 1.0f; // Sine of the cone spread; 1 disables backface culling
+	};
+
 	std::unique_ptr<float[]> vertexData;
 	std::unique_ptr<uint8_t[]> indexData;
-	GLsizeiptr vertexDataSize;
-	GLsizeiptr indexDataSize;
+	GLsizeiptr vertexDataSize = 0;
+	GLsizeiptr indexDataSize = 0;
 	VertexFormat vertexFormat;
-	GLenum usage;
+	GLenum usage = GL_STATIC_DRAW;
+	GLenum indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+
+	// Dequantization for compact position encodings: position = stored * positionScale + positionOffset
+	Vector3f positionScale = Vector3f(1.0f);
+	Vector3f positionOffset = Vector3f(0.0f);
+
+	// Axis aligned bounds of the positions (attribute 0)
+	Vector3f boundsMin = Vector3f(0.0f);
+	Vector3f boundsMax = Vector3f(0.0f);
+	// Radius of the bounding sphere centered on the bounds; at most half their diagonal
+	float boundsRadius = 0.0f;
+
+	// UV units per object space unit over the surface (see ComputeUvDensity); 0 when unknown
+	float uvDensity = 0.0f;
+
+	// Empty means the whole index buffer is drawn as one range
+	std::vector<SubMesh> subMeshes;
+
+	// Level of detail chain, finest first; level 0 is the full mesh. Empty when no chain was built.
+	std::vector<LodLevel> lods;
+
+	// Clusters of level 0 for culling below object granularity. Empty when none were built.
+	std::vector<Meshlet> meshlets;
+
+	// Set when the data lives in a memory mapped file instead of owned buffers.
+	// Vertex and index data are resolved independently, so one may be owned and the other mapped.
+	std::shared_ptr<const MappedFile> mappedStorage;
+	const void* mappedVertexData = nullptr;
+	const void* mappedIndexData = nullptr;
 
 	Mesh() : vertexFormat(VertexFormat::PositionUvNormal) {}
 
 	void SetVertexData(const void* VertexData, GLsizeiptr VertexDataSize,
 					   const void* IndexData, GLsizeiptr IndexDataSize,
 					   VertexFormat VertexFormat, GLenum Usage = GL_STATIC_DRAW) {
-		vertexData = std::make_unique<float[]>(VertexDataSize);
+		vertexData = std::make_unique<float[]>((VertexDataSize + sizeof(float) - 1) / sizeof(float));
 		std::memcpy(vertexData.get(), VertexData, VertexDataSize);
 
 		indexData = std::make_unique<uint8_t[]>(IndexDataSize);
@@ -27,5 +91,216 @@ public:
 		indexDataSize = IndexDataSize;
 		vertexFormat = VertexFormat;
 		usage = Usage;
+		indexType = GL_UNSIGNED_INT;
+		positionScale = Vector3f(1.0f);
+		positionOffset = Vector3f(0.0f);
+		lods.clear();
+		meshlets.clear();
+
+		mappedStorage.reset();
+		mappedVertexData = nullptr;
+		mappedIndexData = nullptr;
+
+		ComputeBounds();
+	}
+
+	// Points the mesh at blobs inside a mapping without copying them; the mapping is kept alive by the mesh
+	void SetMappedData(std::shared_ptr<const MappedFile> Storage,
+					   const void* VertexData, GLsizeiptr VertexDataSize,
+					   const void* IndexData, GLsizeiptr IndexDataSize,
+					   VertexFormat VertexFormat, Vector3f BoundsMin, Vector3f BoundsMax,
+					   GLenum Usage = GL_STATIC_DRAW) {
+		vertexData.reset();
+		indexData.reset();
+
+		mappedStorage = std::move(Storage);
+		mappedVertexData = VertexData;
+		mappedIndexData = IndexData;
+
+		vertexDataSize = VertexDataSize;
+		indexDataSize = IndexDataSize;
+		vertexFormat = VertexFormat;
+		usage = Usage;
+		boundsMin = BoundsMin;
+		boundsMax = BoundsMax;
+		boundsRadius = glm::length(BoundsMax - BoundsMin) * 0.5f;
+		lods.clear();
+		meshlets.clear();
+	}
+
+	const void* GetVertexData() const {
+		return vertexData ? static_cast<const void*>(vertexData.get()) : mappedVertexData;
+	}
+
+	const void* GetIndexData() const {
+		return indexData ? static_cast<const void*>(indexData.get()) : mappedIndexData;
+	}
+
+	static size_t IndexSize(GLenum type) {
+		return type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	}
+
+	size_t GetIndexCount() const {
+		return static_cast<size_t>(indexDataSize) / IndexSize(indexType);
+	}
+
+	// Switches to 16-bit indices when every index fits; returns true if the mesh now uses them
+	bool CompactIndices() {
+		if (indexType == GL_UNSIGNED_SHORT) return true;
+
+		size_t count = GetIndexCount();
+		const GLuint* indices = static_cast<const GLuint*>(GetIndexData());
+		for (size_t i = 0; i < count; ++i) {
+			if (indices[i] > 0xFFFF) return false;
+		}
+
+		auto compact = std::make_unique<uint8_t[]>(count * sizeof(GLushort));
+		GLushort* out = reinterpret_cast<GLushort*>(compact.get());
+		for (size_t i = 0; i < count; ++i) out[i] = static_cast<GLushort>(indices[i]);
+
+		indexData = std::move(compact);
+		mappedIndexData = nullptr;
+		indexDataSize = static_cast<GLsizeiptr>(count * sizeof(GLushort));
+		indexType = GL_UNSIGNED_SHORT;
+		return true;
+	}
+
+	// Back to owned 32-bit indices, for processing passes that expect GLuint
+	void WidenIndices() {
+		size_t count = GetIndexCount();
+		if (indexType == GL_UNSIGNED_INT) {
+			if (!indexData && count > 0) {
+				indexData = std::make_unique<uint8_t[]>(indexDataSize);
+				std::memcpy(indexData.get(), GetIndexData(), indexDataSize);
+				mappedIndexData = nullptr;
+			}
+			return;
+		}
+
+		const GLushort* indices = static_cast<const GLushort*>(GetIndexData());
+		auto wide = std::make_unique<uint8_t[]>(count * sizeof(GLuint));
+		GLuint* out = reinterpret_cast<GLuint*>(wide.get());
+		for (size_t i = 0; i < count; ++i) out[i] = indices[i];
+
+		indexData = std::move(wide);
+		mappedIndexData = nullptr;
+		indexDataSize = static_cast<GLsizeiptr>(count * sizeof(GLuint));
+		indexType = GL_UNSIGNED_INT;
+	}
+
+	// Recomputes boundsMin/boundsMax and boundsRadius from the position attribute (float3 at attribute 0)
+	void ComputeBounds() {
+		boundsMin = Vector3f(0.0f);
+		boundsMax = Vector3f(0.0f);
+
+		const auto& attributes = vertexFormat.getAttributes();
+		if (attributes.empty() || attributes[0].type != GL_FLOAT || attributes[0].count < 3) return;
+
+		size_t stride = attributes[0].stride;
+		size_t offset = reinterpret_cast<size_t>(attributes[0].pointer);
+		if (stride == 0 || vertexDataSize < static_cast<GLsizeiptr>(offset + 3 * sizeof(float))) return;
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(GetVertexData());
+		size_t count = (vertexDataSize - offset) / stride;
+		Vector3f minimum(std::numeric_limits<float>::max());
+		Vector3f maximum(std::numeric_limits<float>::lowest());
+		for (size_t i = 0; i < count; ++i) {
+			Vector3f position;
+			std::memcpy(&position, bytes + i * stride + offset, sizeof(Vector3f));
+			minimum = glm::min(minimum, position);
+			maximum = glm::max(maximum, position);
+		}
+		if (count > 0) {
+			boundsMin = minimum;
+			boundsMax = maximum;
+		}
+		ComputeBoundingRadius();
+	}
+
+	// Sets boundsRadius to the distance from the center of the bounds to the farthest position, which is
+	// tighter than half the diagonal for round shapes. Falls back to half the diagonal without float positions.
+	void ComputeBoundingRadius() {
+		boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+		const auto& attributes = vertexFormat.getAttributes();
+		if (attributes.empty() || attributes[0].type != GL_FLOAT || attributes[0].count < 3) return;
+
+		size_t stride = attributes[0].stride;
+		size_t offset = reinterpret_cast<size_t>(attributes[0].pointer);
+		if (stride == 0 || vertexDataSize < static_cast<GLsizeiptr>(offset + 3 * sizeof(float))) return;
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(GetVertexData());
+		size_t count = (vertexDataSize - offset) / stride;
+		Vector3f center = (boundsMin + boundsMax) * 0.5f;
+		float farthest = 0.0f;
+		for (size_t i = 0; i < count; ++i) {
+			Vector3f position;
+			std::memcpy(&position, bytes + i * stride + offset, sizeof(Vector3f));
+			Vector3f offsetFromCenter = position - center;
+			farthest = std::max(farthest, glm::dot(offsetFromCenter, offsetFromCenter));
+		}
+		if (count > 0) boundsRadius = std::min(boundsRadius, std::sqrt(farthest));
+	}
+
+	// Sets uvDensity to sqrt(UV area / surface area) over the triangles of level 0, from the positions (attribute 0)
+	// and UVs (attribute 1). Reads float, half float and snorm16 attributes, so compact encodings work too.
+	// Walks every triangle, so it runs at import time and cooked meshes store the result.
+	void ComputeUvDensity() {
+		uvDensity = 0.0f;
+		const auto& attributes = vertexFormat.getAttributes();
+		if (attributes.size() < 2 || attributes[0].count < 3 || attributes[1].count < 2) return;
+		if (!GetVertexData() || !GetIndexData() || indexDataSize == 0) return;
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(GetVertexData());
+		size_t stride = attributes[0].stride;
+		if (stride == 0) return;
+		size_t vertexCount = static_cast<size_t>(vertexDataSize) / stride;
+		auto read = [&](size_t vertex, const VertexFormat::Attribute& attribute, float* out, int count) {
+			const uint8_t* p = bytes + vertex * stride + reinterpret_cast<size_t>(attribute.pointer);
+			for (int c = 0; c < count; ++c) {
+				switch (attribute.type) {
+					case GL_FLOAT: std::memcpy(&out[c], p + c * sizeof(float), sizeof(float)); break;
+					case GL_HALF_FLOAT: { uint16_t v; std::memcpy(&v, p + c * 2, 2); out[c] = glm::unpackHalf1x16(v); break; }
+					case GL_SHORT: { uint16_t v; std::memcpy(&v, p + c * 2, 2); out[c] = glm::unpackSnorm1x16(v); break; }
+					default: out[c] = 0.0f; break;
+				}
+			}
+		};
+
+		std::vector<SubMesh> ranges = subMeshes;
+		if (ranges.empty()) {
+			SubMesh whole;
+			whole.indexCount = static_cast<GLsizei>(lods.empty() ? GetIndexCount() : lods[0].indexCount);
+			ranges.push_back(whole);
+		}
+
+		double uvArea = 0.0, surfaceArea = 0.0;
+		size_t indexCount = GetIndexCount();
+		for (const SubMesh& range : ranges) {
+			size_t end = std::min(indexCount, static_cast<size_t>(range.firstIndex) + static_cast<size_t>(range.indexCount));
+			for (size_t i = range.firstIndex; i + 2 < end; i += 3) {
+				Vector3f position[3];
+				Vector2f uv[3];
+				bool valid = true;
+				for (int k = 0; k < 3; ++k) {
+					size_t index = indexType == GL_UNSIGNED_SHORT ? static_cast<const GLushort*>(GetIndexData())[i + k]
+					                                              : static_cast<const GLuint*>(GetIndexData())[i + k];
+					int64_t vertex = static_cast<int64_t>(index) + range.baseVertex;
+					if (vertex < 0 || static_cast<size_t>(vertex) >= vertexCount) { valid = false; break; }
+					float p[3];
+					read(static_cast<size_t>(vertex), attributes[0], p, 3);
+					position[k] = Vector3f(p[0], p[1], p[2]) * positionScale + positionOffset;
+					read(static_cast<size_t>(vertex), attributes[1], &uv[k].x, 2);
+				}
+				if (valid) AddUvArea(position, uv, surfaceArea, uvArea);
+			}
+		}
+		if (surfaceArea > 0.0 && uvArea > 0.0) uvDensity = static_cast<float>(std::sqrt(uvArea / surfaceArea));
+	}
+
+	// Adds the surface and UV areas of a triangle, the terms of uvDensity
+	static void AddUvArea(const Vector3f position[3], const Vector2f uv[3], double& surfaceArea, double& uvArea) {
+		surfaceArea += 0.5 * glm::length(glm::cross(position[1] - position[0], position[2] - position[0]));
+		uvArea += 0.5 * std::abs((uv[1].x - uv[0].x) * (uv[2].y - uv[0].y) - (uv[2].x - uv[0].x) * (uv[1].y - uv[0].y));
 	}
-};
+};
\ No newline at end of file
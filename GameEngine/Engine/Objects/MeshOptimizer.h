@@ -0,0 +1,345 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+// Post-transform vertex cache statistics of an index buffer
+struct VertexCacheStats {
+	float acmr = 0.0f; // Average cache misses per triangle (lower bound 0.5, 3.0 = no reuse)
+	float atvr = 0.0f; // Average transformed vertices per referenced vertex (1.0 = ideal)
+};
+
+struct MeshOptimizationStats {
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+// Reorders Mesh index and vertex data for the GPU:
+//  1. Triangles are reordered for post-transform vertex cache locality (Tipsify, Sander et al. 2007)
+//  2. The resulting clusters are sorted so outward facing ones draw first, reducing overdraw
+//  3. Vertices are reordered by first use so vertex fetch walks memory linearly
+// 16-bit indices are widened to 32 bits first. The overdraw pass needs float positions at attribute 0.
+// Submeshes and levels of detail are optimized per index range.
+class MeshOptimizer {
+public:
+	static constexpr unsigned CacheSize = 16;
+
+	// Simulates a FIFO post-transform cache over a triangle list
+	static VertexCacheStats AnalyzeVertexCache(const GLuint* indices, size_t indexCount, unsigned cacheSize = CacheSize) {
+		VertexCacheStats stats;
+		if (indexCount < 3) return stats;
+
+		GLuint maxIndex = *std::max_element(indices, indices + indexCount);
+		std::vector<uint32_t> timestamps(static_cast<size_t>(maxIndex) + 1, 0);
+		std::vector<uint8_t> referenced(static_cast<size_t>(maxIndex) + 1, 0);
+
+		uint32_t time = cacheSize + 1;
+		size_t misses = 0, unique = 0;
+		for (size_t i = 0; i < indexCount; ++i) {
+			GLuint v = indices[i];
+			if (time - timestamps[v] > cacheSize) {
+				timestamps[v] = time++;
+				++misses;
+			}
+			if (!referenced[v]) {
+				referenced[v] = 1;
+				++unique;
+			}
+		}
+
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+		stats.atvr = unique ? static_cast<float>(misses) / static_cast<float>(unique) : 0.0f;
+		return stats;
+	}
+
+	// Runs all three passes on a mesh in place. Mapped meshes are copied into owned buffers first.
+	static MeshOptimizationStats Optimize(Mesh& mesh, float overdrawThreshold = 1.05f) {
+		MeshOptimizationStats stats;
+		if (mesh.indexDataSize < static_cast<GLsizeiptr>(3 * sizeof(GLuint)) || mesh.vertexFormat.getAttributes().empty()) {
+			return stats;
+		}
+
+		MakeOwned(mesh);
+		mesh.meshlets.clear(); // Triangle order changes, meshlets must be rebuilt afterwards
+		GLuint* indices = reinterpret_cast<GLuint*>(mesh.indexData.get());
+		size_t indexCount = mesh.indexDataSize / sizeof(GLuint);
+		size_t stride = mesh.vertexFormat.getAttributes()[0].stride;
+		size_t vertexCount = stride ? mesh.vertexDataSize / stride : 0;
+
+		stats.before = AnalyzeVertexCache(indices, indexCount);
+
+		// Ranges that must stay separate (each submesh, each level of detail, or the whole buffer)
+		std::vector<Mesh::SubMesh> ranges = mesh.subMeshes;
+		if (ranges.empty()) {
+			for (const auto& lod : mesh.lods) {
+				Mesh::SubMesh range;
+				range.firstIndex = lod.firstIndex;
+				range.indexCount = lod.indexCount;
+				ranges.push_back(range);
+			}
+		}
+		if (ranges.empty()) {
+			Mesh::SubMesh whole;
+			whole.indexCount = static_cast<GLsizei>(indexCount);
+			ranges.push_back(whole);
+		}
+
+		for (const auto& range : ranges) {
+			GLuint* rangeIndices = indices + range.firstIndex;
+			size_t rangeCount = static_cast<size_t>(range.indexCount) / 3 * 3;
+			if (rangeCount < 3) continue;
+
+			// Submesh indices are relative to their base vertex
+			size_t rangeVertices = 0;
+			for (size_t i = 0; i < rangeCount; ++i) rangeVertices = std::max<size_t>(rangeVertices, rangeIndices[i] + 1);
+			if (range.baseVertex + rangeVertices > vertexCount) continue;
+
+			std::vector<uint32_t> clusters;
+			std::vector<GLuint> ordered = Tipsify(rangeIndices, rangeCount, rangeVertices, CacheSize, clusters);
+			SortClustersForOverdraw(mesh, range.baseVertex, ordered, clusters, overdrawThreshold);
+			std::copy(ordered.begin(), ordered.end(), rangeIndices);
+		}
+
+		// Vertex fetch order only when all ranges index the whole vertex buffer directly
+		if (mesh.subMeshes.empty()) {
+			OptimizeVertexFetch(mesh);
+			indices = reinterpret_cast<GLuint*>(mesh.indexData.get());
+		}
+
+		stats.after = AnalyzeVertexCache(indices, indexCount);
+		return stats;
+	}
+
+private:
+	static void MakeOwned(Mesh& mesh) {
+		mesh.WidenIndices();
+		if (!mesh.vertexData) {
+			auto owned = std::make_unique<float[]>((mesh.vertexDataSize + sizeof(float) - 1) / sizeof(float));
+			std::memcpy(owned.get(), mesh.GetVertexData(), mesh.vertexDataSize);
+			mesh.vertexData = std::move(owned);
+		}
+		if (!mesh.indexData) {
+			auto owned = std::make_unique<uint8_t[]>(mesh.indexDataSize);
+			std::memcpy(owned.get(), mesh.GetIndexData(), mesh.indexDataSize);
+			mesh.indexData = std::move(owned);
+		}
+		mesh.mappedStorage.reset();
+		mesh.mappedVertexData = nullptr;
+		mesh.mappedIndexData = nullptr;
+	}
+
+	// Tipsify: fans around vertices that are still in the cache, falling back to recently used
+	// ("dead-end") vertices. Cluster starts are recorded whenever the fan has to jump.
+	static std::vector<GLuint> Tipsify(const GLuint* indices, size_t indexCount, size_t vertexCount,
+	                                   unsigned cacheSize, std::vector<uint32_t>& clusterStarts) {
+		size_t triangleCount = indexCount / 3;
+
+		// Vertex -> triangle adjacency in compressed rows
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; ++i) liveTriangles[indices[i]]++;
+
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + liveTriangles[v];
+		std::vector<uint32_t> adjacency(indexCount);
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (int k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+		}
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		std::vector<GLuint> deadEnd;
+		deadEnd.reserve(indexCount);
+		std::vector<GLuint> candidates;
+		std::vector<GLuint> output;
+		output.reserve(indexCount);
+
+		uint32_t time = cacheSize + 1;
+		size_t cursor = 0;
+		int64_t fanning = 0;
+		while (fanning < static_cast<int64_t>(vertexCount) && liveTriangles[fanning] == 0) ++fanning;
+		if (fanning == static_cast<int64_t>(vertexCount)) return output;
+		clusterStarts.assign(1, 0);
+
+		while (fanning >= 0) {
+			candidates.clear();
+
+			for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+				uint32_t t = adjacency[a];
+				if (emitted[t]) continue;
+				emitted[t] = 1;
+				for (int k = 0; k < 3; ++k) {
+					GLuint v = indices[t * 3 + k];
+					output.push_back(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					liveTriangles[v]--;
+					if (time - cacheTime[v] > cacheSize) cacheTime[v] = time++;
+				}
+			}
+
+			// **Pick the next fanning vertex: the oldest candidate that survives the next fan**
+			int64_t next = -1;
+			int64_t bestPriority = -1;
+			for (GLuint v : candidates) {
+				if (liveTriangles[v] == 0) continue;
+				int64_t priority = 0;
+				if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) priority = time - cacheTime[v];
+				if (priority > bestPriority) {
+					bestPriority = priority;
+					next = v;
+				}
+			}
+
+			if (next == -1) {
+				// Dead end: restart from the most recent vertex with live triangles, else scan forward
+				while (!deadEnd.empty()) {
+					GLuint v = deadEnd.back();
+					deadEnd.pop_back();
+					if (liveTriangles[v] > 0) {
+						next = v;
+						break;
+					}
+				}
+				while (next == -1 && cursor < vertexCount) {
+					if (liveTriangles[cursor] > 0) next = static_cast<int64_t>(cursor);
+					++cursor;
+				}
+				if (next != -1) clusterStarts.push_back(static_cast<uint32_t>(output.size() / 3));
+			}
+			fanning = next;
+		}
+		return output;
+	}
+
+	// Splits the Tipsify clusters further wherever restarting costs little cache efficiency, then
+	// sorts clusters so those facing away from the mesh centre (likely occluders) draw first.
+	static void SortClustersForOverdraw(const Mesh& mesh, GLint baseVertex, std::vector<GLuint>& indices,
+	                                    const std::vector<uint32_t>& hardClusters, float threshold) {
+		const auto& position = mesh.vertexFormat.getAttributes()[0];
+		if (position.type != GL_FLOAT || position.count < 3 || hardClusters.empty()) return;
+
+		size_t triangleCount = indices.size() / 3;
+		size_t stride = position.stride;
+		const uint8_t* vertices = reinterpret_cast<const uint8_t*>(mesh.GetVertexData()) +
+		                          reinterpret_cast<uintptr_t>(position.pointer) + static_cast<size_t>(baseVertex) * stride;
+		auto positionOf = [&](GLuint v) {
+			glm::vec3 p;
+			std::memcpy(&p, vertices + static_cast<size_t>(v) * stride, sizeof(p));
+			return p;
+		};
+
+		// **Soft boundaries: split when the running ACMR after a cache flush stays near the cluster's ACMR**
+		std::vector<uint32_t> clusters;
+		for (size_t c = 0; c < hardClusters.size(); ++c) {
+			uint32_t begin = hardClusters[c];
+			uint32_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : static_cast<uint32_t>(triangleCount);
+			float clusterAcmr = AnalyzeVertexCache(&indices[begin * 3], (end - begin) * 3).acmr;
+
+			clusters.push_back(begin);
+			std::vector<uint32_t> timestamps;
+			uint32_t time = CacheSize + 1;
+			size_t misses = 0;
+			uint32_t start = begin;
+			for (uint32_t t = begin; t < end; ++t) {
+				for (int k = 0; k < 3; ++k) {
+					GLuint v = indices[t * 3 + k];
+					if (v >= timestamps.size()) timestamps.resize(v + 1, 0);
+					if (time - timestamps[v] > CacheSize) {
+						timestamps[v] = time++;
+						++misses;
+					}
+				}
+				uint32_t done = t + 1 - start;
+				if (t + 1 < end && done >= 8 && static_cast<float>(misses) / done <= threshold * clusterAcmr) {
+					clusters.push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+					time += CacheSize + 1; // Flush
+				}
+			}
+		}
+
+		// **Cluster centroid and normal, weighted by triangle area**
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+		struct Cluster { uint32_t begin, end; float sortKey; };
+		std::vector<Cluster> sorted;
+		sorted.reserve(clusters.size());
+		std::vector<glm::vec3> centroids(clusters.size());
+		std::vector<glm::vec3> normals(clusters.size());
+
+		for (size_t c = 0; c < clusters.size(); ++c) {
+			uint32_t begin = clusters[c];
+			uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+			glm::vec3 centroid(0.0f), normal(0.0f);
+			float area = 0.0f;
+			for (uint32_t t = begin; t < end; ++t) {
+				glm::vec3 a = positionOf(indices[t * 3]);
+				glm::vec3 b = positionOf(indices[t * 3 + 1]);
+				glm::vec3 d = positionOf(indices[t * 3 + 2]);
+				glm::vec3 cross = glm::cross(b - a, d - a);
+				float triangleArea = glm::length(cross);
+				centroid += (a + b + d) * (triangleArea / 3.0f);
+				normal += cross;
+				area += triangleArea;
+			}
+			meshCentroid += centroid;
+			meshArea += area;
+			centroids[c] = area > 0.0f ? centroid / area : centroid;
+			normals[c] = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+			sorted.push_back(Cluster{begin, end, 0.0f});
+		}
+		if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+		for (size_t c = 0; c < sorted.size(); ++c) {
+			sorted[c].sortKey = glm::dot(centroids[c] - meshCentroid, normals[c]);
+		}
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+			return a.sortKey > b.sortKey;
+		});
+
+		std::vector<GLuint> reordered;
+		reordered.reserve(indices.size());
+		for (const auto& cluster : sorted) {
+			reordered.insert(reordered.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+		}
+		indices.swap(reordered);
+	}
+
+	// Renumbers vertices in order of first use and drops unreferenced ones
+	static void OptimizeVertexFetch(Mesh& mesh) {
+		size_t stride = mesh.vertexFormat.getAttributes()[0].stride;
+		size_t vertexCount = mesh.vertexDataSize / stride;
+		GLuint* indices = reinterpret_cast<GLuint*>(mesh.indexData.get());
+		size_t indexCount = mesh.indexDataSize / sizeof(GLuint);
+
+		for (size_t i = 0; i < indexCount; ++i) {
+			if (indices[i] >= vertexCount) return;
+		}
+
+		constexpr GLuint Unused = 0xFFFFFFFFu;
+		std::vector<GLuint> remap(vertexCount, Unused);
+		GLuint next = 0;
+		for (size_t i = 0; i < indexCount; ++i) {
+			GLuint& target = remap[indices[i]];
+			if (target == Unused) target = next++;
+			indices[i] = target;
+		}
+
+		size_t newSize = static_cast<size_t>(next) * stride;
+		auto reordered = std::make_unique<float[]>((newSize + sizeof(float) - 1) / sizeof(float));
+		const uint8_t* source = reinterpret_cast<const uint8_t*>(mesh.vertexData.get());
+		uint8_t* destination = reinterpret_cast<uint8_t*>(reordered.get());
+		for (size_t v = 0; v < vertexCount; ++v) {
+			if (remap[v] != Unused) std::memcpy(destination + remap[v] * stride, source + v * stride, stride);
+		}
+
+		mesh.vertexData = std::move(reordered);
+		mesh.vertexDataSize = static_cast<GLsizeiptr>(newSize);
+	}
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include "Mesh.h"
+
+// Converts float PositionUvNormal meshes into the 16 byte vertex encodings:
+//  - PositionUvNormalQuantized: snorm16 positions relative to the mesh bounds
+//  - PositionUvNormalHalf: half float positions relative to the mesh bounds
+// Both store half float UVs and octahedral normals in a 2_10_10_10 value.
+// Positions are stored as (p - positionOffset) / positionScale so they fill [-1, 1] on every axis;
+// Object::SetPositionDequantization passes the inverse to the shader as the positionScale/positionOffset uniforms
+// (multi draws fold it into each object's model matrix instead).
+class MeshQuantizer {
+public:
+	static bool IsQuantized(const VertexFormat& format) {
+		return format == VertexFormat::PositionUvNormalQuantized || format == VertexFormat::PositionUvNormalHalf;
+	}
+
+	// The float format a compact format is built from; other formats map to themselves
+	static const VertexFormat& GetSourceFormat(const VertexFormat& format) {
+		return IsQuantized(format) ? VertexFormat::PositionUvNormal : format;
+	}
+
+	// Re-encodes a float PositionUvNormal mesh in place. Returns false if the mesh has another layout.
+	static bool Quantize(Mesh& mesh, const VertexFormat& target) {
+		if (!IsQuantized(target) || !(mesh.vertexFormat == VertexFormat::PositionUvNormal)) return false;
+
+		size_t vertexCount = static_cast<size_t>(mesh.vertexDataSize) / (SourceStride * sizeof(float));
+		const float* source = static_cast<const float*>(mesh.GetVertexData());
+
+		Vector3f offset, scale;
+		GetDequantization(mesh.boundsMin, mesh.boundsMax, offset, scale);
+		bool half = target == VertexFormat::PositionUvNormalHalf;
+
+		std::vector<uint8_t> packed(vertexCount * TargetStride);
+		for (size_t i = 0; i < vertexCount; ++i) {
+			EncodeVertex(source + i * SourceStride, packed.data() + i * TargetStride, offset, scale, half);
+		}
+
+		auto vertexData = std::make_unique<float[]>(packed.size() / sizeof(float));
+		std::memcpy(vertexData.get(), packed.data(), packed.size());
+		mesh.vertexData = std::move(vertexData);
+		mesh.mappedVertexData = nullptr;
+		mesh.vertexDataSize = static_cast<GLsizeiptr>(packed.size());
+		mesh.vertexFormat = target;
+
+		// boundsMin/boundsMax keep describing the dequantized positions
+		mesh.positionScale = scale;
+		mesh.positionOffset = offset;
+		return true;
+	}
+
+	static constexpr size_t SourceStride = 8;  // Floats per PositionUvNormal vertex
+	static constexpr size_t TargetStride = 16; // Bytes per compact vertex
+
+	// Offset and scale that map the bounds onto [-1, 1] on every axis
+	static void GetDequantization(Vector3f boundsMin, Vector3f boundsMax, Vector3f& offset, Vector3f& scale) {
+		offset = (boundsMin + boundsMax) * 0.5f;
+		scale = glm::max((boundsMax - boundsMin) * 0.5f, Vector3f(1e-6f));
+	}
+
+	// Encodes one PositionUvNormal vertex (8 floats) into TargetStride bytes
+	static void EncodeVertex(const float* v, uint8_t* out, Vector3f offset, Vector3f scale, bool half) {
+		Vector3f position = (Vector3f(v[0], v[1], v[2]) - offset) / scale;
+		uint16_t p[4] = {};
+		for (int c = 0; c < 3; ++c) {
+			float value = glm::clamp(position[c], -1.0f, 1.0f);
+			p[c] = half ? glm::packHalf1x16(value) : glm::packSnorm1x16(value);
+		}
+		uint16_t uv[2] = { glm::packHalf1x16(v[3]), glm::packHalf1x16(v[4]) };
+		uint32_t normal = PackOctahedral(Vector3f(v[5], v[6], v[7]));
+
+		std::memcpy(out, p, sizeof(p));
+		std::memcpy(out + 8, uv, sizeof(uv));
+		std::memcpy(out + 12, &normal, sizeof(normal));
+	}
+
+	// Octahedral encoding of a unit vector as two signed 10-bit values (x in bits 0-9, y in 10-19)
+	static uint32_t PackOctahedral(Vector3f n) {
+		float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		if (length <= 0.0f) return 0;
+		n /= length;
+
+		float x = n.x;
+		float y = n.y;
+		if (n.z < 0.0f) {
+			x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+			y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		auto snorm10 = [](float value) {
+			int32_t q = static_cast<int32_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 511.0f));
+			return static_cast<uint32_t>(q) & 0x3FF;
+		};
+		return snorm10(x) | (snorm10(y) << 10);
+	}
+};
@@ -0,0 +1,431 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+// Builds level of detail chains with quadric error metric simplification (Garland & Heckbert 1997).
+// Edges are removed by half-edge collapses, so every level reuses the vertices of the source mesh and
+// only adds an index range (Mesh::lods). Vertices that share a position but not their attributes
+// (UV or normal seams) are moved together along the seam, open borders only collapse along the border
+// and anything more complex stays locked, so seams and silhouettes survive simplification.
+// Each level stores its error as an object space distance, for screen space error based selection.
+class MeshSimplifier {
+public:
+	// Removes edges until indexCount drops to targetIndexCount, no collapse is possible, or the next
+	// collapse would exceed targetError (object space distance). Positions must be float3 at attribute 0.
+	static std::vector<GLuint> Simplify(const Mesh& mesh, const GLuint* indices, size_t indexCount,
+	                                    size_t targetIndexCount, float targetError = std::numeric_limits<float>::max(),
+	                                    float* resultError = nullptr) {
+		std::vector<GLuint> result(indices, indices + indexCount / 3 * 3);
+		if (resultError) *resultError = 0.0f;
+
+		const auto& attributes = mesh.vertexFormat.getAttributes();
+		if (attributes.empty() || attributes[0].type != GL_FLOAT || attributes[0].count < 3) return result;
+
+		size_t stride = attributes[0].stride;
+		size_t vertexCount = stride ? static_cast<size_t>(mesh.vertexDataSize) / stride : 0;
+		for (GLuint index : result) {
+			if (index >= vertexCount) return result;
+		}
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(mesh.GetVertexData()) + reinterpret_cast<uintptr_t>(attributes[0].pointer);
+		std::vector<glm::vec3> positions(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v) std::memcpy(&positions[v], bytes + v * stride, sizeof(glm::vec3));
+
+		std::vector<GLuint> remap, wedge;
+		BuildWedges(positions, remap, wedge);
+
+		// **Quadrics per welded position: triangle planes plus planes that pin open edges in place**
+		std::vector<Quadric> quadrics(vertexCount);
+		{
+			Topology topology;
+			topology.Build(result, vertexCount);
+			for (size_t t = 0; t < result.size(); t += 3) {
+				for (int k = 0; k < 3; ++k) {
+					GLuint a = result[t + k];
+					GLuint b = result[t + (k + 1) % 3];
+					GLuint c = result[t + (k + 2) % 3];
+					if (k == 0) quadrics[remap[a]].AddTriangle(positions[a], positions[b], positions[c], quadrics[remap[b]], quadrics[remap[c]]);
+					if (!topology.HasEdge(b, a)) {
+						Quadric edge = Quadric::FromEdge(positions[a], positions[b], positions[c], EdgeWeight);
+						quadrics[remap[a]] += edge;
+						quadrics[remap[b]] += edge;
+					}
+				}
+			}
+		}
+
+		targetIndexCount = targetIndexCount / 3 * 3;
+		float maxError = 0.0f; // Squared
+		float limit = targetError < std::sqrt(std::numeric_limits<float>::max()) ? targetError * targetError : std::numeric_limits<float>::max();
+
+		std::vector<GLuint> collapse(vertexCount);
+		std::vector<uint8_t> locked(vertexCount);
+		std::vector<Collapse> candidates;
+		while (result.size() > targetIndexCount) {
+			Topology topology;
+			topology.Build(result, vertexCount);
+			std::vector<Kind> kinds = Classify(topology, remap, wedge, vertexCount);
+
+			// **Candidate collapses in both directions of every edge, cheapest first**
+			candidates.clear();
+			for (size_t t = 0; t < result.size(); t += 3) {
+				for (int k = 0; k < 3; ++k) {
+					GLuint a = result[t + k];
+					GLuint b = result[t + (k + 1) % 3];
+					if (remap[a] == remap[b]) continue;
+					for (int direction = 0; direction < 2; ++direction) {
+						GLuint v0 = direction ? b : a;
+						GLuint v1 = direction ? a : b;
+						GLuint s0 = 0, s1 = 0;
+						if (!CanCollapse(topology, kinds, wedge, v0, v1, s0, s1)) continue;
+						Quadric q = quadrics[remap[v0]];
+						q += quadrics[remap[v1]];
+						candidates.push_back(Collapse{v0, v1, s0, s1, q.Evaluate(positions[v1])});
+					}
+				}
+			}
+			if (candidates.empty()) break;
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) {
+				return x.error < y.error;
+			});
+
+			// Each collapse removes about two triangles; positions touched this pass are locked so the
+			// flip test below always sees up to date neighbours
+			size_t goal = (result.size() - targetIndexCount) / 6 + 1;
+			size_t collapses = 0;
+			for (size_t v = 0; v < vertexCount; ++v) collapse[v] = static_cast<GLuint>(v);
+			std::fill(locked.begin(), locked.end(), 0);
+
+			for (const Collapse& candidate : candidates) {
+				if (candidate.error > limit) break;
+				GLuint r0 = remap[candidate.v0];
+				GLuint r1 = remap[candidate.v1];
+				if (locked[r0] || locked[r1]) continue;
+				if (Flips(topology, result, positions, remap, wedge, candidate.v0, positions[candidate.v1], r1)) continue;
+
+				collapse[candidate.v0] = candidate.v1;
+				if (candidate.s0 != candidate.v0) collapse[candidate.s0] = candidate.s1;
+				quadrics[r1] += quadrics[r0];
+
+				// Lock the one ring of the moved position
+				GLuint w = candidate.v0;
+				do {
+					for (uint32_t i = topology.triangleOffsets[w]; i < topology.triangleOffsets[w + 1]; ++i) {
+						size_t t = topology.triangles[i] * 3;
+						for (int k = 0; k < 3; ++k) locked[remap[result[t + k]]] = 1;
+					}
+					w = wedge[w];
+				} while (w != candidate.v0);
+
+				maxError = std::max(maxError, candidate.error);
+				if (++collapses >= goal) break;
+			}
+			if (collapses == 0) break;
+
+			// **Apply the collapses and drop triangles that became degenerate**
+			size_t write = 0;
+			for (size_t t = 0; t < result.size(); t += 3) {
+				GLuint a = collapse[result[t]];
+				GLuint b = collapse[result[t + 1]];
+				GLuint c = collapse[result[t + 2]];
+				if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) continue;
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+		}
+
+		if (resultError) *resultError = std::sqrt(maxError);
+		return result;
+	}
+
+	// Appends one simplified index range per ratio (fraction of the source triangles) to the mesh.
+	// Level 0 is the source mesh. Levels that fail to remove at least 10% of the previous level's
+	// triangles end the chain. Meshes with submeshes are left alone.
+	static bool BuildLodChain(Mesh& mesh, const std::vector<float>& ratios) {
+		const auto& attributes = mesh.vertexFormat.getAttributes();
+		if (!mesh.subMeshes.empty() || ratios.empty() || attributes.empty() || attributes[0].type != GL_FLOAT) return false;
+
+		mesh.WidenIndices();
+		size_t indexCount = mesh.GetIndexCount();
+		if (indexCount < 3) return false;
+
+		std::vector<GLuint> all(reinterpret_cast<const GLuint*>(mesh.indexData.get()),
+		                        reinterpret_cast<const GLuint*>(mesh.indexData.get()) + indexCount);
+		std::vector<Mesh::LodLevel> lods(1);
+		lods[0].indexCount = static_cast<GLsizei>(indexCount);
+
+		float previousError = 0.0f;
+		for (float ratio : ratios) {
+			if (lods.size() >= Mesh::MaxLods) break;
+			size_t target = static_cast<size_t>(static_cast<double>(indexCount) * ratio) / 3 * 3;
+			if (target < 3) break;
+
+			float error = 0.0f;
+			std::vector<GLuint> level = Simplify(mesh, all.data(), indexCount, target, std::numeric_limits<float>::max(), &error);
+			if (static_cast<double>(level.size()) > 0.9 * static_cast<double>(lods.back().indexCount) || level.empty()) break;
+
+			Mesh::LodLevel lod;
+			lod.firstIndex = static_cast<GLuint>(all.size());
+			lod.indexCount = static_cast<GLsizei>(level.size());
+			lod.error = previousError = std::max(previousError, error);
+			all.insert(all.end(), level.begin(), level.end());
+			lods.push_back(lod);
+		}
+		if (lods.size() < 2) return false;
+
+		auto indexData = std::make_unique<uint8_t[]>(all.size() * sizeof(GLuint));
+		std::memcpy(indexData.get(), all.data(), all.size() * sizeof(GLuint));
+		mesh.indexData = std::move(indexData);
+		mesh.indexDataSize = static_cast<GLsizeiptr>(all.size() * sizeof(GLuint));
+		mesh.lods = std::move(lods);
+		return true;
+	}
+
+	// Builds the chains of many meshes on a pool of threads (one mesh per task)
+	static void BuildLodChains(const std::vector<Mesh*>& meshes, const std::vector<float>& ratios, unsigned maxThreads = 0) {
+		unsigned threadCount = maxThreads ? maxThreads : std::max(1u, std::thread::hardware_concurrency());
+		threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, meshes.size()));
+
+		std::atomic<size_t> next{0};
+		auto worker = [&]() {
+			for (size_t i = next++; i < meshes.size(); i = next++) {
+				if (meshes[i]) BuildLodChain(*meshes[i], ratios);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < threadCount; ++i) threads.emplace_back(worker);
+		worker();
+		for (auto& thread : threads) thread.join();
+	}
+
+private:
+	static constexpr float EdgeWeight = 10.0f;
+
+	enum class Kind : uint8_t { Manifold, Border, Seam, Locked };
+
+	struct Collapse {
+		GLuint v0, v1; // v0 moves onto v1
+		GLuint s0, s1; // Seam sibling moved along with v0 (s0 == v0 when there is none)
+		float error;
+	};
+
+	struct Quadric {
+		float a00 = 0, a11 = 0, a22 = 0, a10 = 0, a20 = 0, a21 = 0;
+		float b0 = 0, b1 = 0, b2 = 0, c = 0;
+		float w = 0;
+
+		static Quadric FromPlane(glm::vec3 n, float d, float weight) {
+			Quadric q;
+			q.a00 = n.x * n.x * weight; q.a11 = n.y * n.y * weight; q.a22 = n.z * n.z * weight;
+			q.a10 = n.y * n.x * weight; q.a20 = n.z * n.x * weight; q.a21 = n.z * n.y * weight;
+			q.b0 = n.x * d * weight; q.b1 = n.y * d * weight; q.b2 = n.z * d * weight;
+			q.c = d * d * weight;
+			q.w = weight;
+			return q;
+		}
+
+		// Plane through edge ab perpendicular to triangle abc
+		static Quadric FromEdge(glm::vec3 a, glm::vec3 b, glm::vec3 c, float weight) {
+			glm::vec3 edge = b - a;
+			float length = glm::length(edge);
+			glm::vec3 normal = glm::cross(edge, c - a);
+			glm::vec3 perpendicular = glm::cross(edge, normal);
+			float perpendicularLength = glm::length(perpendicular);
+			if (length <= 0.0f || perpendicularLength <= 0.0f) return Quadric();
+			perpendicular /= perpendicularLength;
+			return FromPlane(perpendicular, -glm::dot(perpendicular, a), length * length * weight);
+		}
+
+		// Area weighted plane of triangle abc, added to all three corners
+		void AddTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, Quadric& qb, Quadric& qc) {
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float area = glm::length(normal);
+			if (area <= 0.0f) return;
+			normal /= area;
+			Quadric q = FromPlane(normal, -glm::dot(normal, a), area);
+			*this += q;
+			if (&qb != this) qb += q;
+			if (&qc != this && &qc != &qb) qc += q;
+		}
+
+		Quadric& operator+=(const Quadric& q) {
+			a00 += q.a00; a11 += q.a11; a22 += q.a22; a10 += q.a10; a20 += q.a20; a21 += q.a21;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c; w += q.w;
+			return *this;
+		}
+
+		// Weighted mean squared distance of p to the accumulated planes
+		float Evaluate(glm::vec3 p) const {
+			float rx = a00 * p.x + a10 * p.y + a20 * p.z + b0;
+			float ry = a10 * p.x + a11 * p.y + a21 * p.z + b1;
+			float rz = a20 * p.x + a21 * p.y + a22 * p.z + b2;
+			float r = rx * p.x + ry * p.y + rz * p.z + b0 * p.x + b1 * p.y + b2 * p.z + c;
+			return w > 0.0f ? std::abs(r) / w : 0.0f;
+		}
+	};
+
+	// Directed edges and incident triangles of the current index list, in compressed rows
+	struct Topology {
+		std::vector<uint32_t> edgeOffsets, edges;
+		std::vector<uint32_t> triangleOffsets, triangles;
+
+		void Build(const std::vector<GLuint>& indices, size_t vertexCount) {
+			edgeOffsets.assign(vertexCount + 1, 0);
+			for (GLuint index : indices) edgeOffsets[index + 1]++;
+			for (size_t v = 0; v < vertexCount; ++v) edgeOffsets[v + 1] += edgeOffsets[v];
+			triangleOffsets = edgeOffsets;
+
+			edges.resize(indices.size());
+			triangles.resize(indices.size());
+			std::vector<uint32_t> fill(edgeOffsets.begin(), edgeOffsets.end() - 1);
+			for (size_t t = 0; t < indices.size(); t += 3) {
+				for (int k = 0; k < 3; ++k) {
+					uint32_t slot = fill[indices[t + k]]++;
+					edges[slot] = indices[t + (k + 1) % 3];
+					triangles[slot] = static_cast<uint32_t>(t / 3);
+				}
+			}
+		}
+
+		bool HasEdge(GLuint a, GLuint b) const {
+			for (uint32_t i = edgeOffsets[a]; i < edgeOffsets[a + 1]; ++i) {
+				if (edges[i] == b) return true;
+			}
+			return false;
+		}
+
+		// Edge in either direction that has no opposite half edge (a border or seam edge)
+		bool IsOpenEdge(GLuint a, GLuint b) const {
+			return HasEdge(a, b) != HasEdge(b, a);
+		}
+	};
+
+	// remap: first vertex with the same position; wedge: circular list of vertices sharing a position
+	static void BuildWedges(const std::vector<glm::vec3>& positions, std::vector<GLuint>& remap, std::vector<GLuint>& wedge) {
+		struct PositionHash {
+			size_t operator()(const glm::vec3& p) const {
+				uint32_t bits[3];
+				std::memcpy(bits, &p, sizeof(bits));
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+		};
+
+		std::unordered_map<glm::vec3, GLuint, PositionHash> first;
+		first.reserve(positions.size());
+		remap.resize(positions.size());
+		wedge.resize(positions.size());
+		for (size_t v = 0; v < positions.size(); ++v) {
+			GLuint r = first.emplace(positions[v], static_cast<GLuint>(v)).first->second;
+			remap[v] = r;
+			if (r == v) {
+				wedge[v] = static_cast<GLuint>(v);
+			} else {
+				wedge[v] = wedge[r];
+				wedge[r] = static_cast<GLuint>(v);
+			}
+		}
+	}
+
+	static std::vector<Kind> Classify(const Topology& topology, const std::vector<GLuint>& remap,
+	                                  const std::vector<GLuint>& wedge, size_t vertexCount) {
+		std::vector<uint8_t> openIn(vertexCount, 0), openOut(vertexCount, 0), positionOpen(vertexCount, 0);
+		for (GLuint a = 0; a < vertexCount; ++a) {
+			for (uint32_t i = topology.edgeOffsets[a]; i < topology.edgeOffsets[a + 1]; ++i) {
+				GLuint b = topology.edges[i];
+				if (topology.HasEdge(b, a)) continue;
+				openOut[a] = static_cast<uint8_t>(std::min(openOut[a] + 1, 2));
+				openIn[b] = static_cast<uint8_t>(std::min(openIn[b] + 1, 2));
+
+				// Open in position space too, unless another wedge of b links back to a wedge of a
+				bool closed = false;
+				GLuint wb = b;
+				do {
+					GLuint wa = a;
+					do {
+						closed = closed || topology.HasEdge(wb, wa);
+						wa = wedge[wa];
+					} while (wa != a);
+					wb = wedge[wb];
+				} while (wb != b);
+				if (!closed) positionOpen[remap[a]] = positionOpen[remap[b]] = 1;
+			}
+		}
+
+		std::vector<Kind> kinds(vertexCount, Kind::Locked);
+		for (size_t v = 0; v < vertexCount; ++v) {
+			bool singleOpen = openIn[v] == 1 && openOut[v] == 1;
+			if (wedge[v] == v) {
+				if (openIn[v] == 0 && openOut[v] == 0) kinds[v] = Kind::Manifold;
+				else if (singleOpen) kinds[v] = Kind::Border;
+			} else if (wedge[wedge[v]] == v) {
+				GLuint s = wedge[v];
+				if (singleOpen && openIn[s] == 1 && openOut[s] == 1 && !positionOpen[remap[v]]) kinds[v] = Kind::Seam;
+			}
+		}
+		return kinds;
+	}
+
+	static bool CanCollapse(const Topology& topology, const std::vector<Kind>& kinds, const std::vector<GLuint>& wedge,
+	                        GLuint v0, GLuint v1, GLuint& s0, GLuint& s1) {
+		s0 = s1 = v0;
+		switch (kinds[v0]) {
+			case Kind::Manifold:
+				return true;
+			case Kind::Border:
+				return (kinds[v1] == Kind::Border || kinds[v1] == Kind::Locked) && topology.IsOpenEdge(v0, v1);
+			case Kind::Seam: {
+				if ((kinds[v1] != Kind::Seam && kinds[v1] != Kind::Locked) || !topology.IsOpenEdge(v0, v1)) return false;
+				// The sibling follows along the matching seam edge on the other side
+				s0 = wedge[v0];
+				for (GLuint w = wedge[v1]; w != v1; w = wedge[w]) {
+					if (topology.IsOpenEdge(s0, w)) {
+						s1 = w;
+						return true;
+					}
+				}
+				return false;
+			}
+			default:
+				return false;
+		}
+	}
+
+	// True if moving every wedge of v0 to target would flip or collapse one of the surviving triangles
+	static bool Flips(const Topology& topology, const std::vector<GLuint>& indices, const std::vector<glm::vec3>& positions,
+	                  const std::vector<GLuint>& remap, const std::vector<GLuint>& wedge,
+	                  GLuint v0, glm::vec3 target, GLuint targetPosition) {
+		GLuint w = v0;
+		do {
+			for (uint32_t i = topology.triangleOffsets[w]; i < topology.triangleOffsets[w + 1]; ++i) {
+				size_t t = topology.triangles[i] * 3;
+				glm::vec3 corners[3], moved[3];
+				bool removed = false;
+				for (int k = 0; k < 3; ++k) {
+					GLuint index = indices[t + k];
+					corners[k] = positions[index];
+					moved[k] = remap[index] == remap[v0] ? target : corners[k];
+					removed = removed || remap[index] == targetPosition;
+				}
+				if (removed) continue;
+
+				glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+				glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				if (glm::dot(before, after) <= 0.0f) return true;
+			}
+			w = wedge[w];
+		} while (w != v0);
+		return false;
+	}
+};
@@ -0,0 +1,226 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+// Splits a mesh into meshlets: connected groups of triangles that touch at most MaxVertices vertices
+// and hold at most MaxTriangles triangles. Triangles are regrouped in place so every meshlet is a range
+// of the existing index buffer and needs no extra GPU data.
+// Each meshlet gets a bounding sphere and a normal cone for frustum and backface culling (see ClusterCuller).
+class MeshletBuilder {
+public:
+	static constexpr size_t MaxVertices = 64;
+	static constexpr size_t MaxTriangles = 124;
+
+	// Builds Mesh::meshlets for every submesh, or for level 0 (the whole mesh when there is no LOD chain).
+	// Triangles inside each range are regrouped so every meshlet is contiguous. Positions must be float3
+	// at attribute 0. Returns the number of meshlets.
+	static size_t Build(Mesh& mesh, size_t maxVertices = MaxVertices, size_t maxTriangles = MaxTriangles) {
+		mesh.meshlets.clear();
+		const auto& attributes = mesh.vertexFormat.getAttributes();
+		if (attributes.empty() || attributes[0].type != GL_FLOAT || attributes[0].count < 3 || maxVertices < 3 || maxTriangles < 1) {
+			return 0;
+		}
+		mesh.WidenIndices();
+
+		size_t stride = attributes[0].stride;
+		size_t vertexCount = stride ? static_cast<size_t>(mesh.vertexDataSize) / stride : 0;
+		const uint8_t* positions = static_cast<const uint8_t*>(mesh.GetVertexData()) + reinterpret_cast<uintptr_t>(attributes[0].pointer);
+		GLuint* indices = reinterpret_cast<GLuint*>(mesh.indexData.get());
+
+		std::vector<Mesh::SubMesh> ranges = mesh.subMeshes;
+		if (ranges.empty()) {
+			Mesh::SubMesh whole;
+			whole.indexCount = static_cast<GLsizei>(mesh.lods.empty() ? mesh.GetIndexCount() : mesh.lods[0].indexCount);
+			ranges.push_back(whole);
+		}
+
+		for (const auto& range : ranges) {
+			GLuint* rangeIndices = indices + range.firstIndex;
+			size_t count = static_cast<size_t>(range.indexCount) / 3 * 3;
+			for (size_t i = 0; i < count; ++i) {
+				if (range.baseVertex + static_cast<size_t>(rangeIndices[i]) >= vertexCount) {
+					mesh.meshlets.clear();
+					return 0;
+				}
+			}
+
+			std::vector<GLuint> ordered;
+			std::vector<Mesh::Meshlet> meshlets = Group(rangeIndices, count,
+			                                            positions + static_cast<size_t>(range.baseVertex) * stride, stride,
+			                                            maxVertices, maxTriangles, ordered);
+			std::copy(ordered.begin(), ordered.end(), rangeIndices);
+
+			std::vector<glm::vec3> corners;
+			for (auto& meshlet : meshlets) {
+				corners.clear();
+				for (GLsizei i = 0; i < meshlet.indexCount; ++i) {
+					corners.push_back(PositionOf(positions, stride, range.baseVertex + static_cast<size_t>(ordered[meshlet.firstIndex + i])));
+				}
+				Mesh::Meshlet bounds = ComputeBounds(corners);
+				bounds.firstIndex = range.firstIndex + meshlet.firstIndex;
+				bounds.indexCount = meshlet.indexCount;
+				bounds.baseVertex = range.baseVertex;
+				bounds.vertexCount = meshlet.vertexCount;
+				mesh.meshlets.push_back(bounds);
+			}
+		}
+		return mesh.meshlets.size();
+	}
+
+	// Bounding sphere and normal cone of a triangle list given as corner positions
+	static Mesh::Meshlet ComputeBounds(const std::vector<glm::vec3>& corners) {
+		Mesh::Meshlet meshlet;
+		if (corners.empty()) return meshlet;
+
+		// **Sphere: Ritter's approximation seeded with the extremal points**
+		glm::vec3 a = corners[0];
+		glm::vec3 b = a;
+		float best = -1.0f;
+		for (const auto& p : corners) {
+			float d = glm::dot(p - a, p - a);
+			if (d > best) { best = d; b = p; }
+		}
+		glm::vec3 c = b;
+		best = -1.0f;
+		for (const auto& p : corners) {
+			float d = glm::dot(p - b, p - b);
+			if (d > best) { best = d; c = p; }
+		}
+		glm::vec3 center = (b + c) * 0.5f;
+		float radius = glm::length(c - b) * 0.5f;
+		for (const auto& p : corners) {
+			float d = glm::length(p - center);
+			if (d > radius) {
+				float grown = (radius + d) * 0.5f;
+				center += (p - center) * ((grown - radius) / d);
+				radius = grown;
+			}
+		}
+		meshlet.center = center;
+		meshlet.radius = radius;
+
+		// **Cone: average face normal; the cutoff is the sine of the widest deviation from it**
+		std::vector<glm::vec3> normals;
+		normals.reserve(corners.size() / 3);
+		glm::vec3 axis(0.0f);
+		for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+			glm::vec3 n = glm::cross(corners[i + 1] - corners[i], corners[i + 2] - corners[i]);
+			float length = glm::length(n);
+			if (length <= 0.0f) continue;
+			normals.push_back(n / length);
+			axis += normals.back();
+		}
+		float axisLength = glm::length(axis);
+		if (normals.empty() || axisLength <= 0.0f) return meshlet; // Degenerate cone: never backface culled
+
+		axis /= axisLength;
+		float minDot = 1.0f;
+		for (const auto& n : normals) minDot = std::min(minDot, glm::dot(axis, n));
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = minDot > 0.0f ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+		return meshlet;
+	}
+
+private:
+	static constexpr float ConeWeight = 4.0f;
+
+	static glm::vec3 PositionOf(const uint8_t* positions, size_t stride, size_t vertex) {
+		glm::vec3 p;
+		std::memcpy(&p, positions + vertex * stride, sizeof(p));
+		return p;
+	}
+
+	// Greedy growth over shared vertices: the next triangle is the neighbour that adds the fewest new
+	// vertices and deviates least from the meshlet's average normal, which keeps normal cones tight.
+	// When no neighbour fits, the meshlet is closed and the next one starts at the first unused triangle.
+	static std::vector<Mesh::Meshlet> Group(const GLuint* indices, size_t indexCount, const uint8_t* positions, size_t stride,
+	                                        size_t maxVertices, size_t maxTriangles, std::vector<GLuint>& ordered) {
+		size_t triangleCount = indexCount / 3;
+		size_t vertexCount = 0;
+		for (size_t i = 0; i < indexCount; ++i) vertexCount = std::max<size_t>(vertexCount, indices[i] + 1);
+
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i) offsets[indices[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] += offsets[v];
+		std::vector<uint32_t> adjacency(indexCount);
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (int k = 0; k < 3; ++k) adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+		}
+
+		std::vector<glm::vec3> normals(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			glm::vec3 a = PositionOf(positions, stride, indices[t * 3]);
+			glm::vec3 n = glm::cross(PositionOf(positions, stride, indices[t * 3 + 1]) - a, PositionOf(positions, stride, indices[t * 3 + 2]) - a);
+			float length = glm::length(n);
+			normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+		}
+
+		std::vector<uint8_t> used(triangleCount, 0);
+		std::vector<uint32_t> stamp(vertexCount, std::numeric_limits<uint32_t>::max());
+		std::vector<GLuint> vertices;
+		std::vector<Mesh::Meshlet> meshlets;
+		ordered.clear();
+		ordered.reserve(indexCount);
+
+		size_t cursor = 0;
+		uint32_t current = 0;
+		while (true) {
+			while (cursor < triangleCount && used[cursor]) ++cursor;
+			if (cursor == triangleCount) break;
+
+			Mesh::Meshlet meshlet;
+			meshlet.firstIndex = static_cast<GLuint>(ordered.size());
+			vertices.clear();
+			glm::vec3 normalSum(0.0f);
+
+			size_t next = cursor;
+			while (true) {
+				used[next] = 1;
+				for (int k = 0; k < 3; ++k) {
+					GLuint v = indices[next * 3 + k];
+					ordered.push_back(v);
+					if (stamp[v] != current) {
+						stamp[v] = current;
+						vertices.push_back(v);
+					}
+				}
+				normalSum += normals[next];
+				meshlet.indexCount += 3;
+				if (static_cast<size_t>(meshlet.indexCount) / 3 >= maxTriangles) break;
+
+				float normalLength = glm::length(normalSum);
+				glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f);
+				float bestScore = std::numeric_limits<float>::max();
+				size_t best = triangleCount;
+				for (GLuint v : vertices) {
+					for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a) {
+						uint32_t t = adjacency[a];
+						if (used[t]) continue;
+						size_t added = 0;
+						for (int k = 0; k < 3; ++k) added += stamp[indices[t * 3 + k]] != current;
+						if (vertices.size() + added > maxVertices) continue;
+						float score = static_cast<float>(added) + ConeWeight * (1.0f - glm::dot(normals[t], axis));
+						if (score < bestScore) {
+							bestScore = score;
+							best = t;
+						}
+					}
+				}
+				if (best == triangleCount) break;
+				next = best;
+			}
+
+			meshlet.vertexCount = static_cast<GLuint>(vertices.size());
+			meshlets.push_back(meshlet);
+			++current;
+		}
+		return meshlets;
+	}
+};
\ No newline at end of file
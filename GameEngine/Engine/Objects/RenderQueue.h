@@ -0,0 +1,245 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include "../Core.h"
+#include "Instance.h"
+
+// One draw submitted for a frame: the instance to render and the key it is ordered by.
+// Consecutive packets with the same nonzero batch value are rendered together by the first one's
+// Instance::RenderBatch, e.g. as one instanced draw.
+struct RenderPacket {
+	uint64_t key;
+	Instance* instance;
+	uint64_t batch;
+};
+
+// Work done by the last RenderQueue::Execute
+struct RenderQueueStats {
+	size_t packets = 0;
+	size_t draws = 0;             // Render and RenderBatch calls; an instance may issue several GL draws
+	size_t batches = 0;           // RenderBatch calls
+	size_t batchedInstances = 0;  // Packets rendered by them
+};
+
+// Buffer written anew each frame. Uploads are appended; the store is replaced on the first upload of a
+// frame and whenever it fills up, so draws issued before keep reading the old one.
+template <typename BufferType>
+class StreamBuffer {
+public:
+	void BeginFrame() {
+		used = 0;
+		fresh = false;
+	}
+
+	// Copies data into the buffer, leaving it bound to its target, and returns its offset in bytes,
+	// a multiple of alignment
+	size_t Upload(const void* data, size_t size, size_t alignment) {
+		if (!buffer) buffer = std::make_unique<BufferType>(); // Not in the constructor, which may run before GL is loaded
+		size_t offset = (used + alignment - 1) / alignment * alignment;
+		size_t capacity = static_cast<size_t>(buffer->bufferSize);
+		if (!fresh || offset + size > capacity) {
+			if (size > capacity) capacity = std::max({ capacity * 2, size, size_t(64) << 10 });
+			buffer->SetData(nullptr, static_cast<GLsizeiptr>(capacity), GL_STREAM_DRAW);
+			fresh = true;
+			offset = 0;
+		}
+		buffer->SetSubData(static_cast<GLintptr>(offset), data, static_cast<GLsizeiptr>(size));
+		used = offset + size;
+		return offset;
+	}
+
+	const BufferType& GetBuffer() const { return *buffer; }
+
+	// Deletes the GL buffer; the next upload creates a new one
+	void Release() {
+		buffer.reset();
+		BeginFrame();
+	}
+
+private:
+	std::unique_ptr<BufferType> buffer;
+	size_t used = 0;
+	bool fresh = false;
+};
+
+// Draws submitted by the visible instances, ordered by a 64 bit key before they run.
+// From the top bit down the key holds the pass, whether the draw is transparent, and then
+//  - opaque:      shader, material, mesh, depth, so draws sharing state run together, nearest first;
+//  - transparent: inverted depth, shader, material, mesh, so they blend farthest first.
+// Shader, material and mesh are 12 bit IDs; IDs equal in their low bits only cost a state change.
+// Depth is the top 23 bits of a non negative float, which order like the float itself with precision
+// relative to the distance. Keys are sorted with an LSD radix sort of 8 bit digits, skipping digits
+// all keys share (most of the top bits in a typical frame).
+// Batches upload their per instance data and indirect draw commands into buffers streamed anew each frame.
+class RenderQueue {
+public:
+	// Shader storage binding of the instance buffer, see Instancing.glsl
+	static constexpr GLuint InstanceDataBinding = 0;
+
+	static constexpr int PassBits = 4;
+	static constexpr int IdBits = 12;
+	static constexpr int DepthBits = 23;
+	static constexpr uint64_t IdMask = (uint64_t(1) << IdBits) - 1;
+	static constexpr uint64_t DepthMask = (uint64_t(1) << DepthBits) - 1;
+	static constexpr int TransparentShift = 64 - PassBits - 1;
+	static constexpr uint8_t MaxPass = (1 << PassBits) - 1;
+
+	// Builds the key of a draw. depth may be any non negative measure growing with the distance to the
+	// camera, e.g. the squared distance.
+	static uint64_t MakeKey(uint8_t pass, bool transparent, uint32_t shader, uint32_t material, uint32_t mesh, float depth) {
+		uint64_t key = uint64_t(std::min(pass, MaxPass)) << (64 - PassBits);
+		uint64_t state = (uint64_t(shader & IdMask) << (2 * IdBits)) | (uint64_t(material & IdMask) << IdBits) | (mesh & IdMask);
+		uint64_t quantized = QuantizeDepth(depth);
+		if (transparent) {
+			key |= uint64_t(1) << TransparentShift;
+			key |= (DepthMask - quantized) << (3 * IdBits);
+			key |= state;
+		} else {
+			key |= state << DepthBits;
+			key |= quantized;
+		}
+		return key;
+	}
+
+	static uint32_t QuantizeDepth(float depth) {
+		if (!(depth > 0.0f)) depth = 0.0f; // Also catches NaN
+		uint32_t bits;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return bits >> (31 - DepthBits);
+	}
+
+	static bool IsTransparent(uint64_t key) {
+		return (key >> TransparentShift) & 1;
+	}
+
+	static uint8_t PassOf(uint64_t key) {
+		return static_cast<uint8_t>(key >> (64 - PassBits));
+	}
+
+	void Clear() {
+		packets.clear();
+	}
+
+	void Submit(uint64_t key, Instance* instance, uint64_t batch = 0) {
+		packets.push_back({ key, instance, batch });
+	}
+
+	size_t size() const { return packets.size(); }
+	const std::vector<RenderPacket>& GetPackets() const { return packets; }
+	const RenderQueueStats& GetStats() const { return stats; }
+
+	// Orders the packets by key; packets with equal keys keep their submission order
+	void Sort() {
+		size_t count = packets.size();
+		if (count < 2) return;
+
+		// Histograms of all eight digits in one pass
+		uint32_t histograms[8][256] = {};
+		for (const RenderPacket& packet : packets) {
+			for (int digit = 0; digit < 8; ++digit) ++histograms[digit][(packet.key >> (digit * 8)) & 0xFF];
+		}
+
+		scratch.resize(count);
+		for (int digit = 0; digit < 8; ++digit) {
+			uint32_t* histogram = histograms[digit];
+			if (histogram[(packets[0].key >> (digit * 8)) & 0xFF] == count) continue; // Every key has this digit
+
+			uint32_t offset = 0;
+			for (int value = 0; value < 256; ++value) {
+				uint32_t bucket = histogram[value];
+				histogram[value] = offset;
+				offset += bucket;
+			}
+			for (const RenderPacket& packet : packets) {
+				scratch[histogram[(packet.key >> (digit * 8)) & 0xFF]++] = packet;
+			}
+			packets.swap(scratch);
+		}
+	}
+
+	// Renders the packets in their current order, with alpha blending and without depth writes for the
+	// transparent ones. Runs of packets sharing a batch value go to RenderBatch.
+	void Execute() {
+		stats = RenderQueueStats();
+		stats.packets = packets.size();
+		instanceData.BeginFrame();
+		drawCommands.BeginFrame();
+
+		bool blending = false;
+		for (size_t i = 0; i < packets.size();) {
+			const RenderPacket& packet = packets[i];
+			size_t end = i + 1;
+			if (packet.batch != 0) {
+				while (end < packets.size() && packets[end].batch == packet.batch) ++end;
+			}
+
+			bool transparent = IsTransparent(packet.key);
+			if (transparent != blending) {
+				SetBlending(transparent);
+				blending = transparent;
+			}
+			if (end - i > 1) {
+				packet.instance->RenderBatch(&packets[i], end - i, *this);
+				stats.batches++;
+				stats.batchedInstances += end - i;
+			} else {
+				packet.instance->Render();
+			}
+			stats.draws++;
+			i = end;
+		}
+		if (blending) SetBlending(false);
+	}
+
+	// Copies the per instance data of a batch into the frame's instance buffer, binds it to InstanceDataBinding
+	// and returns the index of the batch's first element in it
+	GLint UploadInstanceData(const void* data, size_t size, size_t elementSize) {
+		size_t offset = instanceData.Upload(data, size, elementSize);
+		instanceData.GetBuffer().BindBase(InstanceDataBinding);
+		return static_cast<GLint>(offset / elementSize);
+	}
+
+	// Copies draw commands into the frame's indirect buffer, leaves it bound to GL_DRAW_INDIRECT_BUFFER and
+	// returns the byte offset to pass to glMultiDrawElementsIndirect
+	size_t UploadDrawCommands(const DrawElementsIndirectCommand* commands, size_t count) {
+		return drawCommands.Upload(commands, count * sizeof(DrawElementsIndirectCommand), sizeof(DrawElementsIndirectCommand));
+	}
+
+	// Drops the packets and deletes the streamed buffers. Call before the GL context is destroyed.
+	void Release() {
+		packets.clear();
+		scratch.clear();
+		instanceData.Release();
+		drawCommands.Release();
+	}
+
+private:
+	static void SetBlending(bool enabled) {
+		if (enabled) {
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glDepthMask(GL_FALSE);
+		} else {
+			glDisable(GL_BLEND);
+			glDepthMask(GL_TRUE);
+		}
+	}
+
+	std::vector<RenderPacket> packets;
+	std::vector<RenderPacket> scratch;
+	RenderQueueStats stats;
+
+	StreamBuffer<ShaderStorageBuffer> instanceData;
+	StreamBuffer<DrawIndirectBuffer> drawCommands;
+};
+
+void Instance::Submit(RenderQueue& queue, const Vector3f& /*viewPosition*/) {
+	queue.Submit(RenderQueue::MakeKey(0, false, 0, 0, 0, 0.0f), this);
+}
+
+void Instance::RenderBatch(const RenderPacket* packets, size_t count, RenderQueue& /*queue*/) {
+	for (size_t i = 0; i < count; ++i) packets[i].instance->Render();
+}
@@ -3,14 +3,32 @@
 #include <unordered_map>
 #include <memory>
 #include <string>
+#include <algorithm>
+#include <chrono>
 #include "Instance.h"
+#include "Bvh.h"
+#include "FrustumCuller.h"
 
 class Scene {
 private:
 	std::vector<std::unique_ptr<Instance>> instances;  // Stores all instances
 	std::unordered_map<std::string, Instance*> instanceMap;  // Fast lookup by ID
 
+	// Spatial index over the world bounds of the instances
+	Bvh<Instance*> bvh;
+	std::vector<Instance*> dirtyInstances;  // Refit on the next Update, see Instance::MarkDirty
+	std::vector<Instance*> unbounded;  // Instances not in the index, e.g. with their mesh still loading; retried on every Update
+
+	// Scratch of QueryFrustum
+	FrustumCuller culler;
+	std::vector<Instance*> candidates;
+	std::vector<uint8_t> candidateResults;
+
 public:
+	// Dynamic instances are stored with their box grown by this fraction of its largest half extent, so they can
+	// move that far before their leaf is re-inserted
+	float boundsMargin = 0.1f;
+
 	Scene() = default;
 
 	/**
@@ -22,6 +40,7 @@ public:
 		instance->OnCreation();
 		std::string id = instance->getId();
 		instanceMap[id] = instance.get();
+		MarkDirty(instance.get());
 		instances.push_back(std::move(instance));
 	}
 
@@ -34,6 +53,13 @@ public:
 		auto it = instanceMap.find(id);
 		if (it == instanceMap.end()) return false;
 
+		// Remove from the spatial index
+		Instance* instance = it->second;
+		if (instance->spatialProxy != -1) bvh.Remove(instance->spatialProxy);
+		for (auto* list : { &dirtyInstances, &unbounded }) {
+			list->erase(std::remove(list->begin(), list->end(), instance), list->end());
+		}
+
 		// Remove from vector
 		auto vecIt = std::find_if(instances.begin(), instances.end(),
 								  [&](const std::unique_ptr<Instance>& inst) { return inst->getId() == id; });
@@ -62,6 +88,207 @@ public:
 	const std::vector<std::unique_ptr<Instance>>& getInstances() const {
 		return instances;
 	}
+
+	/**
+	 * @brief Brings the spatial index up to date with the instances marked dirty since the last call. Called by
+	 * Renderer::Render before culling.
+	 *
+	 * Costs one GetWorldBounds call per dirty instance and per instance still without bounds, so a scene that
+	 * does not move costs nothing. Dynamic instances moving less than boundsMargin leave the tree untouched,
+	 * the others are re-inserted.
+	 */
+	void Update() {
+		for (Instance* instance : dirtyInstances) {
+			instance->dirty = false;
+			Refit(*instance, false);
+		}
+		dirtyInstances.clear();
+		unbounded.erase(std::remove_if(unbounded.begin(), unbounded.end(), [&](Instance* instance) {
+			if (instance->spatialProxy == -1) Refit(*instance, false);
+			if (instance->spatialProxy == -1) return false;
+			instance->unboundedListed = false;
+			return true;
+		}), unbounded.end());
+	}
+
+	/**
+	 * @brief Has an instance refit on the next Update; see Instance::MarkDirty.
+	 * @param instance An instance of this scene.
+	 */
+	void MarkDirty(Instance* instance) {
+		if (instance->dirty) return;
+		instance->dirty = true;
+		dirtyInstances.push_back(instance);
+	}
+
+	/**
+	 * @brief Marks an instance as static or dynamic.
+	 *
+	 * Static instances are stored with tight bounds, which culls better but re-inserts them on every move; mark
+	 * the instances that rarely or never move. Both kinds are refit only when marked dirty.
+	 * @param instance An instance of this scene.
+	 * @param isStatic True for static, false for dynamic (the default of new instances).
+	 */
+	void SetStatic(Instance* instance, bool isStatic) {
+		if (instance->isStatic == isStatic) return;
+		instance->isStatic = isStatic;
+		// The margin of a static instance is dropped right away; a dynamic one gains it when it next leaves its box
+		if (isStatic) Refit(*instance, true);
+	}
+
+	/**
+	 * @brief Refits one instance in the spatial index right away, without waiting for the next Update.
+	 * @param instance An instance of this scene.
+	 */
+	void UpdateInstance(Instance* instance) {
+		Refit(*instance, true);
+	}
+
+	/**
+	 * @brief Rebuilds the spatial index from scratch with the surface area heuristic.
+	 *
+	 * Insertions one at a time give a tree a little worse than a full build; call this after loading a level
+	 * or placing many static instances.
+	 */
+	void RebuildSpatialIndex() {
+		Update();
+		bvh.Rebuild();
+	}
+
+	/**
+	 * @brief Finds the instances inside or crossing a frustum.
+	 *
+	 * Subtrees entirely inside are taken whole; the instances in subtrees crossing a plane are tested against their
+	 * own bounds with FrustumCuller. Instances without bounds are not reported, see getUnboundedInstances.
+	 * @param frustum The frustum, e.g. of the camera.
+	 * @param visible Receives the instances.
+	 * @param stats If given, receives the counts and the time of the query.
+	 */
+	void QueryFrustum(const FrustumCuller::Frustum& frustum, std::vector<Instance*>& visible, FrustumCullStats* stats = nullptr) {
+		auto start = std::chrono::steady_clock::now();
+		size_t first = visible.size();
+		culler.Clear();
+		candidates.clear();
+		size_t nodesVisited = bvh.QueryFrustum(frustum, [&](Instance* instance, bool inside) {
+			if (inside) {
+				visible.push_back(instance);
+			} else {
+				candidates.push_back(instance);
+				culler.Add(instance->worldBounds);
+			}
+		});
+		bool simd = culler.Cull(frustum, candidateResults);
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			if (candidateResults[i]) visible.push_back(candidates[i]);
+		}
+
+		if (!stats) return;
+		stats->tested = candidates.size();
+		stats->visible = visible.size() - first;
+		stats->culled = bvh.size() - stats->visible;
+		stats->nodesVisited = nodesVisited;
+		stats->simd = simd;
+		stats->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/**
+	 * @brief Finds the instances whose bounds overlap a sphere.
+	 * @param center Center of the sphere in world space.
+	 * @param radius Radius of the sphere.
+	 * @param results Receives the instances.
+	 */
+	void QuerySphere(const Vector3f& center, float radius, std::vector<Instance*>& results) const {
+		bvh.QuerySphere(center, radius, [&](Instance* instance) {
+			const Bounds& bounds = instance->worldBounds;
+			Vector3f closest = glm::clamp(center, bounds.center - bounds.extent, bounds.center + bounds.extent);
+			float reach = radius + bounds.radius;
+			if (glm::dot(closest - center, closest - center) <= radius * radius &&
+			    glm::dot(bounds.center - center, bounds.center - center) <= reach * reach) {
+				results.push_back(instance);
+			}
+		});
+	}
+
+	/**
+	 * @brief Finds the instances whose bounding box overlaps a box.
+	 * @param min Minimum corner of the box in world space.
+	 * @param max Maximum corner of the box in world space.
+	 * @param results Receives the instances.
+	 */
+	void QueryBox(const Vector3f& min, const Vector3f& max, std::vector<Instance*>& results) const {
+		bvh.QueryAabb(min, max, [&](Instance* instance) {
+			const Bounds& bounds = instance->worldBounds;
+			if (glm::all(glm::lessThanEqual(bounds.center - bounds.extent, max)) &&
+			    glm::all(glm::lessThanEqual(min, bounds.center + bounds.extent))) {
+				results.push_back(instance);
+			}
+		});
+	}
+
+	/**
+	 * @brief Finds the first instance whose bounding box a ray hits.
+	 * @param origin Start of the ray in world space.
+	 * @param direction Direction of the ray; distances are in multiples of it.
+	 * @param maxDistance Length of the ray.
+	 * @param distance If given, receives the distance at which the ray enters the box of the instance hit.
+	 * @return The instance hit, or nullptr.
+	 */
+	Instance* Raycast(const Vector3f& origin, const Vector3f& direction, float maxDistance, float* distance = nullptr) const {
+		Vector3f inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		Instance* closest = nullptr;
+		float closestDistance = maxDistance;
+		bvh.Raycast(origin, direction, maxDistance, [&](Instance* instance, float) {
+			const Bounds& bounds = instance->worldBounds;
+			float entry;
+			if (Bvh<Instance*>::RayHitsBox(origin, inverse, bounds.center - bounds.extent, bounds.center + bounds.extent, closestDistance, entry) &&
+			    (!closest || entry < closestDistance)) {
+				closest = instance;
+				closestDistance = entry;
+			}
+			return closestDistance;
+		});
+		if (closest && distance) *distance = closestDistance;
+		return closest;
+	}
+
+	/**
+	 * @brief Gets the instances without bounds as of the last Update, which queries do not report.
+	 */
+	const std::vector<Instance*>& getUnboundedInstances() const {
+		return unbounded;
+	}
+
+	/**
+	 * @brief Gets the spatial index, e.g. to run queries with a custom callback.
+	 */
+	const Bvh<Instance*>& getSpatialIndex() const {
+		return bvh;
+	}
+
+private:
+	// Stores the current world bounds of an instance in the index, or takes it out if it has none. Dynamic
+	// instances keep their leaf while the bounds stay within it, unless forced.
+	void Refit(Instance& instance, bool force) {
+		Bounds bounds;
+		if (!instance.GetWorldBounds(bounds)) {
+			if (instance.spatialProxy != -1) bvh.Remove(instance.spatialProxy);
+			instance.spatialProxy = -1;
+			// Retried by every Update until it has bounds
+			if (!instance.unboundedListed) unbounded.push_back(&instance);
+			instance.unboundedListed = true;
+			return;
+		}
+		instance.worldBounds = bounds;
+		Vector3f min = bounds.center - bounds.extent;
+		Vector3f max = bounds.center + bounds.extent;
+		float margin = instance.isStatic ? 0.0f : boundsMargin * std::max(bounds.extent.x, std::max(bounds.extent.y, bounds.extent.z));
+		if (instance.spatialProxy != -1 && !force) {
+			bvh.Move(instance.spatialProxy, min, max, margin);
+			return;
+		}
+		if (instance.spatialProxy != -1) bvh.Remove(instance.spatialProxy);
+		instance.spatialProxy = bvh.Insert(min, max, &instance, margin);
+	}
 };
 
 template<typename T, typename... Args>
@@ -71,3 +298,7 @@ T *Instance::Create(Scene &targetScene, const std::string &instanceName, Args &&
 	targetScene.addInstance(std::move(instance));
 	return rawPtr;
 }
+
+void Instance::MarkDirty() {
+	if (scene) scene->MarkDirty(this);
+}
@@ -4,6 +4,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/constants.hpp>
 #include <cmath>
+#include <functional>
 
 class Transform {
 public:
@@ -11,6 +12,10 @@ public:
 	Vector3f rotation; // In Euler angles (pitch, yaw, roll)
 	Vector3f scale;
 
+	// Called by the setters and by assignment, e.g. so the scene refits the owner's bounds; after changing the
+	// fields directly, call Changed
+	std::function<void()> onChanged;
+
 	Transform(Vector3f position, Vector3f rotation, Vector3f scale)
 		: position(position), rotation(rotation), scale(scale) {}
 	Transform() {
@@ -19,6 +24,25 @@ public:
 		scale = Vector3f(1.0f, 1.0f, 1.0f);
 	}
 
+	// The listener belongs to the owner, so copies start without one and assignment keeps it
+	Transform(const Transform& other) : position(other.position), rotation(other.rotation), scale(other.scale) {}
+	Transform& operator=(const Transform& other) {
+		position = other.position;
+		rotation = other.rotation;
+		scale = other.scale;
+		Changed();
+		return *this;
+	}
+
+	void SetPosition(const Vector3f& value) { position = value; Changed(); }
+	void SetRotation(const Vector3f& value) { rotation = value; Changed(); }
+	void SetScale(const Vector3f& value) { scale = value; Changed(); }
+	void Translate(const Vector3f& offset) { position += offset; Changed(); }
+
+	void Changed() const {
+		if (onChanged) onChanged();
+	}
+
 	// Function to return the model matrix (Matrix4d)
 	Matrix4f GetModelMatrix() const {
 		// Create the transformation matrix (identity matrix)
@@ -5,6 +5,7 @@
 #include "Device.h"
 #include "Objects.h"
 #include "Core.h"
+#include "Assets.h"
 
 class Renderer {
 public:
@@ -13,34 +14,92 @@ public:
   static Event<> BeforeRender;
   static Event<> AfterRender;
 
+  // Camera of the frame being rendered, used by objects to pick their level of detail
+  static const Camera* activeCamera;
+
+  // Largest on screen error in pixels a level of detail may have
+  static float lodPixelError;
+
+  // Skips instances whose bounds lie outside the camera frustum
+  static bool frustumCulling;
+  static FrustumCullStats lastCullStats;
+  static RenderQueueStats lastQueueStats;
+
 
   static void Setup(GLFWwindow* Window) {
     window = Window;
   };
 
+  // Deletes the GL objects the renderer owns. Call before the GL context is destroyed.
+  static void Shutdown() {
+    renderQueue.Release();
+    visibleInstances.clear();
+    activeCamera = nullptr;
+  }
+
   static void Render(Scene* scene, const Camera* camera) {
     glfwPollEvents();
     Screen::Update(window);
     Time::Update();
 
+    // Finish assets loaded in the background, without blowing the frame budget
+    AssetService::ProcessUploads(AssetService::uploadBudgetMs);
+    TextureStreamer::Update();
+    ShaderVariants::Update();
+
     BeforeRender.Fire();
+    activeCamera = camera;
 
     glClearColor(0.0f, 0.5f, 0.5f, 1.0f);
     glViewport(0, 0, Screen::width, Screen::height);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    const auto& instances = scene->getInstances();
-
-    for (const auto& instance : instances) {
-      instance->Render();
-    }
+    CullInstances(*scene, camera);
+    Vector3f viewPosition = camera ? camera->transform.position : Vector3f(0.0f);
+    renderQueue.Clear();
+    for (Instance* instance : visibleInstances) instance->Submit(renderQueue, viewPosition);
+    renderQueue.Sort();
+    renderQueue.Execute();
+    lastQueueStats = renderQueue.GetStats();
 
     glfwSwapBuffers(window);
     AfterRender.Fire();
   }
+
+private:
+  static std::vector<Instance*> visibleInstances;  // Instances to render this frame
+  static RenderQueue renderQueue;
+
+  // Refits the scene's spatial index and fills visibleInstances from it
+  static void CullInstances(Scene& scene, const Camera* camera) {
+    auto start = std::chrono::steady_clock::now();
+    lastCullStats = FrustumCullStats();
+    visibleInstances.clear();
+    scene.Update();
+    if (!frustumCulling || !camera) {
+      for (const auto& instance : scene.getInstances()) visibleInstances.push_back(instance.get());
+      return;
+    }
+
+    auto frustum = FrustumCuller::Frustum::FromMatrix(camera->GetProjectionMatrix() * camera->GetViewMatrix());
+    scene.QueryFrustum(frustum, visibleInstances, &lastCullStats);
+    const auto& unbounded = scene.getUnboundedInstances();
+    visibleInstances.insert(visibleInstances.end(), unbounded.begin(), unbounded.end());
+    lastCullStats.unbounded = unbounded.size();
+    lastCullStats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
 };
 
 GLFWwindow* Renderer::window = nullptr;
 
 Event<> Renderer::BeforeRender;
-Event<> Renderer::AfterRender;
\ No newline at end of file
+Event<> Renderer::AfterRender;
+
+const Camera* Renderer::activeCamera = nullptr;
+float Renderer::lodPixelError = 1.0f;
+bool Renderer::frustumCulling = true;
+FrustumCullStats Renderer::lastCullStats;
+RenderQueueStats Renderer::lastQueueStats;
+
+std::vector<Instance*> Renderer::visibleInstances;
+RenderQueue Renderer::renderQueue;
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "Engine/Objects.h"
 #include "Engine/Device.h"
 #include "Engine/Renderer.h"
+#include "Engine/Assets.h"
 #include "Scripts/ScriptBehaviour.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -111,19 +112,32 @@ int main() {
 		return WINDOW_INITIALIZATION_FAIL;
 	}
 
-	File* TestFragmentShaderFile = File::find("Assets/Shaders/Test.frag");
-	Shader* TestFragmentShader = new Shader(GL_FRAGMENT_SHADER, *TestFragmentShaderFile);
-
-	File* TestVertexShaderFile = File::find("Assets/Shaders/Test.vert");
-	Shader* TestVertexShader = new Shader(GL_VERTEX_SHADER, *TestVertexShaderFile);
-
-	ShaderProgram TestProgram;
-	TestProgram.AttachShader(*TestVertexShader);
-	TestProgram.AttachShader(*TestFragmentShader);
-	TestProgram.LinkProgram();
-
-	File* textureFile = File::find("Assets/Textures/Test.jpg");
-	Texture* texture = new Texture(*textureFile, GL_TEXTURE0);
+	// Packed assets (see the pack_assets target) take precedence over the loose copies
+	if (std::filesystem::exists("Assets.pak")) PakArchive::Mount("Assets.pak");
+
+	// Independent assets load in parallel on the asset workers; only the GL uploads run here
+	MeshLoader::optimizeMeshes = true;
+	MeshLoader::lodRatios = { 0.5f, 0.25f, 0.125f };
+	MeshLoader::buildMeshlets = true;
+	// Edited shaders, textures and meshes are reloaded in place while the engine runs
+	AssetService::hotReload = true;
+	// Uploaded meshes are also copied into the GeometryArena of their vertex format for multi draw indirect
+	GeometryArena::enabled = true;
+	AssetHandle<ShaderProgram> programHandle = AssetService::LoadProgramAsync("Assets/Shaders/Test.vert", "Assets/Shaders/Test.frag", IoPriority::Critical);
+	// Usable right away as a placeholder; the normal map is BC5 encoded once, cached as KTX2, and its mips stream in smallest first
+	AssetHandle<Texture> textureHandle = AssetService::LoadTextureCompressed("Assets/Textures/Test.jpg", TextureCompression::BC5, GL_TEXTURE0);
+	AssetHandle<GeometryContainer> geometryHandle = AssetService::LoadGeometryAsync("Assets/Models/Test.obj", MeshFormat::OBJ, VertexFormat::PositionUvNormal, IoPriority::Critical);
+
+	// The material needs its shader up front; the mesh is attached when it arrives
+	ShaderProgram* TestProgram = AssetService::Wait(programHandle);
+	ProgramCache::PrintReport();
+	Texture* texture = textureHandle.Get();
+	if (!TestProgram || !texture) {
+		AssetService::Shutdown();
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return ASSET_LOADING_FAIL;
+	}
 
 	Camera camera;
 	camera.transform.position = Vector3f(-5, 0, 0);
@@ -144,24 +158,34 @@ int main() {
 		texture->bind();
 		return (GLuint) 0;
 	});
-	Material material(&TestProgram, perspectiveMatrix, viewMatrix, modelMatrix, sampleTexture);
+	Material material(TestProgram, perspectiveMatrix, viewMatrix, modelMatrix, sampleTexture);
+	material.AddTexture(texture);
+	// Objects sharing the material and a mesh are drawn with one instanced draw per level of detail
+	// Released before the GL context at the end of main, like the other GL objects
+	auto testVariants = std::make_unique<ShaderVariants>("Assets/Shaders/Test.vert", "Assets/Shaders/Test.frag");
+	material.instancedShader = testVariants->Wait({ "INSTANCED" });
+	// Takes precedence: with the meshes in a GeometryArena, all objects of the material go out in one indirect multi draw
+	material.multiDrawShader = testVariants->Wait({ "MULTI_DRAW" });
 
 
 	Scene scene;
 
-	File* meshFile = File::find("Assets/Models/Test.obj");
-	Mesh mesh = MeshLoader::LoadMesh(meshFile, MeshFormat::OBJ, VertexFormat::PositionUvNormal);
-
 	Object* object = Instance::Create<Object>(scene, "TestObject", &material);
-	object->SetMesh(&mesh);
 
 	Object* object1 = Instance::Create<Object>(scene, "TestObject1", &material);
-	object1->transform.position = Vector3f(3.0f, 0, 0);
-	object1->SetMesh(&mesh);
+	object1->transform.SetPosition(Vector3f(3.0f, 0, 0));
 
 	Object* object2 = Instance::Create<Object>(scene, "TestObject2", &material);
-	object2->transform.position = Vector3f(6.0f, 0, 0);
-	object2->SetMesh(&mesh);
+	object2->transform.SetPosition(Vector3f(6.0f, 0, 0));
+
+	// All three objects draw the same uploaded buffers
+	geometryHandle.OnReady([object, object1, object2, geometryHandle](GeometryContainer&) {
+		object->SetGeometry(geometryHandle.Share());
+		object1->SetGeometry(geometryHandle.Share());
+		object2->SetGeometry(geometryHandle.Share());
+		AssetRegistry::PrintMemoryReport();
+		MeshLoader::PrintOptimizationReport();
+	});
 
 
 
@@ -195,6 +219,10 @@ int main() {
 		}
 	}
 
+	Renderer::Shutdown();
+	ShaderVariants::Shutdown();
+	testVariants.reset();
+	AssetService::Shutdown();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
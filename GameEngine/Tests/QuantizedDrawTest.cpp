@@ -0,0 +1,140 @@
+// Draws a quantized mesh through Object::Render and Object::RenderBatch with the GL entry points replaced
+// by recorders, and checks that the positionScale/positionOffset uniforms the draws set turn the stored
+// snorm16 positions back into the source positions. Needs no window or GL context.
+#define STB_IMAGE_IMPLEMENTATION
+#include "../Utilities.h"
+#include <iostream>
+#include <cmath>
+#include <glad/glad.h>
+#include "../Engine/Core.h"
+#include "../Engine/FileSystem.h"
+#include "../Engine/Objects.h"
+#include "../Engine/Renderer.h"
+#include "../Engine/Assets.h"
+
+namespace {
+	GLuint nextId = 1;
+	std::vector<uint8_t> vertexStore;
+	GLenum boundTarget = 0;
+	Vector3f positionScale(0.0f), positionOffset(0.0f);
+	int scaleSets = 0, offsetSets = 0, draws = 0;
+
+	enum : GLint { ScaleLocation = 1, OffsetLocation = 2, OtherLocation = 3 };
+
+	void APIENTRY GenNames(GLsizei n, GLuint* ids) { for (GLsizei i = 0; i < n; ++i) ids[i] = nextId++; }
+	void APIENTRY DeleteNames(GLsizei, const GLuint*) {}
+	void APIENTRY BindBuffer(GLenum target, GLuint) { boundTarget = target; }
+	void APIENTRY BindVertexArray(GLuint) {}
+	void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum) {
+		if (target == GL_ARRAY_BUFFER && data) vertexStore.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+	}
+	void APIENTRY BufferSubData(GLenum, GLintptr, GLsizeiptr, const void*) {}
+	void APIENTRY BindBufferBase(GLenum, GLuint, GLuint) {}
+	void APIENTRY VertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+	void APIENTRY VertexAttribIPointer(GLuint, GLint, GLenum, GLsizei, const void*) {}
+	void APIENTRY EnableVertexAttribArray(GLuint) {}
+	GLuint APIENTRY CreateProgram() { return nextId++; }
+	void APIENTRY DeleteProgram(GLuint) {}
+	void APIENTRY UseProgram(GLuint) {}
+	GLint APIENTRY GetUniformLocation(GLuint, const GLchar* name) {
+		std::string uniform = name;
+		if (uniform == "positionScale") return ScaleLocation;
+		if (uniform == "positionOffset") return OffsetLocation;
+		return OtherLocation;
+	}
+	void APIENTRY Uniform1i(GLint, GLint) {}
+	void APIENTRY Uniform3fv(GLint location, GLsizei, const GLfloat* value) {
+		if (location == ScaleLocation) { positionScale = Vector3f(value[0], value[1], value[2]); ++scaleSets; }
+		if (location == OffsetLocation) { positionOffset = Vector3f(value[0], value[1], value[2]); ++offsetSets; }
+	}
+	void APIENTRY UniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) {}
+	void APIENTRY DrawElements(GLenum, GLsizei, GLenum, const void*) { ++draws; }
+	void APIENTRY DrawElementsInstanced(GLenum, GLsizei, GLenum, const void*, GLsizei) { ++draws; }
+	void APIENTRY Toggle(GLenum) {}
+	void APIENTRY BlendFunc(GLenum, GLenum) {}
+	void APIENTRY DepthMask(GLboolean) {}
+
+	void InstallRecorders() {
+		glad_glGenBuffers = GenNames; glad_glGenVertexArrays = GenNames;
+		glad_glDeleteBuffers = DeleteNames; glad_glDeleteVertexArrays = DeleteNames;
+		glad_glBindBuffer = BindBuffer; glad_glBindVertexArray = BindVertexArray;
+		glad_glBufferData = BufferData; glad_glBufferSubData = BufferSubData; glad_glBindBufferBase = BindBufferBase;
+		glad_glVertexAttribPointer = VertexAttribPointer; glad_glVertexAttribIPointer = VertexAttribIPointer;
+		glad_glEnableVertexAttribArray = EnableVertexAttribArray;
+		glad_glCreateProgram = CreateProgram; glad_glDeleteProgram = DeleteProgram; glad_glUseProgram = UseProgram;
+		glad_glGetUniformLocation = GetUniformLocation; glad_glUniform1i = Uniform1i;
+		glad_glUniform3fv = Uniform3fv; glad_glUniformMatrix4fv = UniformMatrix4fv;
+		glad_glDrawElements = DrawElements; glad_glDrawElementsInstanced = DrawElementsInstanced;
+		glad_glEnable = Toggle; glad_glDisable = Toggle; glad_glBlendFunc = BlendFunc; glad_glDepthMask = DepthMask;
+	}
+
+	// Largest distance between a source position and the uploaded one decoded with the recorded uniforms
+	float DecodeError(const std::vector<Vector3f>& expected, const VertexFormat& format) {
+		const auto& position = format.getAttributes()[0];
+		size_t stride = static_cast<size_t>(position.stride);
+		float error = 0.0f;
+		for (size_t i = 0; i < expected.size(); ++i) {
+			const uint8_t* element = vertexStore.data() + i * stride + reinterpret_cast<uintptr_t>(position.pointer);
+			int16_t stored[3];
+			std::memcpy(stored, element, sizeof(stored));
+			Vector3f decoded = Vector3f(glm::max(stored[0] / 32767.0f, -1.0f), glm::max(stored[1] / 32767.0f, -1.0f),
+			                            glm::max(stored[2] / 32767.0f, -1.0f)) * positionScale + positionOffset;
+			error = glm::max(error, glm::length(decoded - expected[i]));
+		}
+		return error;
+	}
+
+	bool Check(bool condition, const std::string& what) {
+		if (!condition) std::cerr << "FAILED: " << what << std::endl;
+		return condition;
+	}
+}
+
+int main() {
+	InstallRecorders();
+
+	// A triangle far from the origin, so a missing offset or scale cannot pass unnoticed
+	std::vector<Vector3f> positions = { Vector3f(100.0f, 20.0f, -5.0f), Vector3f(104.0f, 20.0f, -5.0f), Vector3f(100.0f, 26.0f, -3.0f) };
+	std::vector<float> vertices;
+	for (const Vector3f& p : positions) vertices.insert(vertices.end(), { p.x, p.y, p.z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f });
+	GLuint indices[] = { 0, 1, 2 };
+
+	Mesh mesh;
+	mesh.SetVertexData(vertices.data(), vertices.size() * sizeof(float), indices, sizeof(indices), VertexFormat::PositionUvNormal);
+	if (!Check(MeshQuantizer::Quantize(mesh, VertexFormat::PositionUvNormalQuantized), "quantize the mesh")) return 1;
+	auto geometry = std::make_shared<GeometryContainer>();
+	geometry->SetVertexData(mesh);
+
+	ShaderProgram program, instancedProgram;
+	UniformValue modelMatrix("modelMatrix", [](Object* object, ShaderProgram*) { return object->transform.GetModelMatrix(); });
+	Material material(&program, modelMatrix);
+	Scene scene;
+	Object* object = Instance::Create<Object>(scene, "Quantized", &material);
+	object->SetGeometry(geometry);
+
+	bool passed = true;
+	const float tolerance = 1e-3f;
+
+	object->Render();
+	passed &= Check(draws == 1 && scaleSets == 1 && offsetSets == 1, "Render sets positionScale and positionOffset");
+	passed &= Check(DecodeError(positions, VertexFormat::PositionUvNormalQuantized) < tolerance, "Render decodes the source positions");
+
+	// Two objects of the same mesh and material make an instanced batch
+	material.instancedShader = &instancedProgram;
+	Object* other = Instance::Create<Object>(scene, "QuantizedCopy", &material);
+	other->SetGeometry(geometry);
+	positionScale = positionOffset = Vector3f(0.0f);
+	draws = scaleSets = offsetSets = 0;
+	RenderQueue queue;
+	object->Submit(queue, Vector3f(0.0f));
+	other->Submit(queue, Vector3f(0.0f));
+	queue.Sort();
+	queue.Execute();
+	passed &= Check(queue.GetStats().batches == 1 && draws == 1, "both objects draw as one instanced batch");
+	passed &= Check(scaleSets == 1 && offsetSets == 1, "RenderBatch sets positionScale and positionOffset");
+	passed &= Check(DecodeError(positions, VertexFormat::PositionUvNormalQuantized) < tolerance, "RenderBatch decodes the source positions");
+	queue.Release();
+
+	std::cout << (passed ? "Quantized draw test passed" : "Quantized draw test failed") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+// Packs a directory into an asset archive mounted by PakArchive::Mount.
+// Usage: PakTool <archive> <directory> [none|lz4|zstd]
+// Run it from the directory the game loads assets relative to, so the entry paths match.
+#include <iostream>
+#include <string>
+#include "../Engine/FileSystem/PakArchive.h"
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cerr << "Usage: PakTool <archive> <directory> [none|lz4|zstd]" << std::endl;
+		return 1;
+	}
+
+	std::string mode = argc > 3 ? argv[3] : "lz4";
+	PakCompression compression = PakCompression::LZ4;
+	if (mode == "none") {
+		compression = PakCompression::None;
+	} else if (mode == "zstd") {
+		compression = PakCompression::Zstd;
+	} else if (mode != "lz4") {
+		std::cerr << "ERROR: Unknown compression: " << mode << std::endl;
+		return 1;
+	}
+
+	return PakArchive::Build(argv[1], argv[2], compression) ? 0 : 1;
+}
@@ -12,6 +12,7 @@ typedef glm::mat4x4 Matrix4d;
 enum ApplicationStatusCode {
 	SUCCESS = 0,
 	WINDOW_INITIALIZATION_FAIL = 1,
+	ASSET_LOADING_FAIL = 2,
 
 	UNKNOWN_ERROR = -1
 };